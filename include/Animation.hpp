@@ -0,0 +1,88 @@
+#pragma once
+
+#include "math.hpp"
+#include "Hierarchy.hpp"
+
+#include <string>
+#include <vector>
+#include <memory>
+#include <cstdint>
+
+namespace nogl
+{
+  class Scene;
+
+  // A glTF animation, keyframed node transforms and morph target weights. `Apply()` samples all of its channels at once.
+  class Animation
+  {
+    friend class Scene;
+
+    public:
+    // What a channel animates.
+    enum class Path : uint8_t
+    {
+      kTranslation,
+      kRotation,
+      kScale,
+      // The node's `Scene::weights()`, all of them per key.
+      kWeights,
+    };
+
+    enum class Interpolation : uint8_t
+    {
+      kStep,
+      kLinear,
+      kCubicSpline,
+    };
+
+    // Keyframes, any number of channels may share them.
+    struct Sampler
+    {
+      // Seconds, increasing.
+      std::vector<float> times;
+      // One per key, 3 for `kCubicSpline`(in tangent, value, out tangent). Rotations are quaternions, x, y, z, w like `Q4`.
+      // For `kWeights` each of those is one per target instead, in x.
+      std::vector<V4> values;
+      Interpolation interpolation = Interpolation::kLinear;
+    };
+
+    struct Channel
+    {
+      unsigned sampler;
+      // Index of the animated node, in the scene's `Hierarchy`.
+      unsigned node;
+      Path path;
+      // The key it was last sampled at. The search goes on from it, so playing forward is O(1) per frame instead of a binary search.
+      unsigned key = 0;
+    };
+
+    const std::string& name() const { return name_; }
+    const std::vector<Sampler>& samplers() const { return samplers_; }
+    const std::vector<Channel>& channels() const { return channels_; }
+    // The time of the last key, in seconds.
+    float duration() const { return duration_; }
+
+    // Samples every channel at `time`(seconds, clamped to the keys, loop it over `duration()` if you want) into the transforms of their nodes in `scene.hierarchy()`, and their `Scene::weights()`. Call `Hierarchy::Update()` after.
+    // The rotations that are not cubic splines, usually most of the channels, are interpolated together in one `VOV4::Slerp()`.
+    void Apply(float time, Scene& scene);
+
+    private:
+    std::string name_;
+    std::vector<Sampler> samplers_;
+    std::vector<Channel> channels_;
+    float duration_ = 0.0f;
+
+    // Scratch of `Apply()`, a slot for each channel `Slerp()` handles, in the order of `channels_`.
+    std::vector<unsigned> slerp_channels_;
+    VOV4 slerp_from_, slerp_to_, slerp_out_;
+    // Padded to `VOV4::kBatch`.
+    std::unique_ptr<float[]> slerp_t_;
+
+    // Moves `channel.key` to the last key at or before `time`, returns how far `time` is from it to the next one, 0 to 1.
+    float Seek(Channel& channel, float time);
+    // Element `i` of `sampler` between `key` and `next` at `t`, where every key has `stride` elements.
+    static V4 Interpolate(const Sampler& sampler, unsigned key, unsigned next, float t, unsigned stride, unsigned i);
+    // Allocates the scratch, once the channels are in.
+    void Prepare();
+  };
+}
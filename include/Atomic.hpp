@@ -64,7 +64,7 @@ namespace nogl
 
     bool CompareExchange(T* expected, T desired, bool weak, Order success_order, Order fail_order)
     {
-      return __atomic_compare_exchange_n(&data, expected, desired, weak, success_order, fail_order);
+      return __atomic_compare_exchange_n(&data, expected, desired, weak, static_cast<int>(success_order), static_cast<int>(fail_order));
     }
     bool CompareExchange(T expected, T desired, bool weak, Order success_order, Order fail_order)
     {
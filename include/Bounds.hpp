@@ -0,0 +1,77 @@
+#pragma once
+
+#include "math.hpp"
+
+#include <cstdint>
+
+namespace nogl
+{
+  // Axis aligned bounding box, only the x, y and z of `min` and `max` mean anything.
+  class AABB
+  {
+    public:
+    V4 min, max;
+
+    // A point at the origin.
+    AABB() : min(0.0f), max(0.0f) {}
+    AABB(const V4& min, const V4& max) : min(min), max(max) {}
+
+    // The box around all vectors of `vov`, a point at the origin if it's empty.
+    static AABB Of(const VOV4& vov) noexcept;
+    // Only around the `n` vectors of `vov` at `indices`, or the first `n` if it's `nullptr`.
+    static AABB Of(const VOV4& vov, const unsigned* indices, unsigned n) noexcept;
+
+    V4 center() const noexcept;
+    // Half of the size on each axis.
+    V4 extents() const noexcept;
+
+    // The box around this box after `m`(affine), still axis aligned so it's looser than the transformed box itself, but never too small.
+    // Arvo's method, the extents go through the absolute values of `m`, no need for the 8 corners.
+    AABB Transformed(const M4x4& m) const noexcept;
+  };
+
+  class Sphere
+  {
+    public:
+    // Only the x, y and z mean anything, like `AABB`.
+    V4 center;
+    float radius;
+
+    // A point at the origin.
+    Sphere() : center(0.0f), radius(0.0f) {}
+    Sphere(const V4& center, float radius) : center(center), radius(radius) {}
+
+    // Centered on `bounds`(should be `AABB::Of(vov)`), as wide as the farthest vector of `vov`, which is usually way tighter than the sphere around the box.
+    static Sphere Of(const VOV4& vov, const AABB& bounds) noexcept;
+    // Only the `n` vectors at `indices`, like `AABB::Of()`.
+    static Sphere Of(const VOV4& vov, const unsigned* indices, unsigned n, const AABB& bounds) noexcept;
+
+    // The radius is scaled by the biggest axis scale of `m`(affine), so it never gets too small under non-uniform scales.
+    Sphere Transformed(const M4x4& m) const noexcept;
+  };
+
+  // The 6 planes of a camera's view volume, all facing inwards.
+  class Frustum
+  {
+    public:
+    static constexpr unsigned kPlanes = 6;
+
+    // Extracted straight from the rows of `view_projection`, which has the viewport baked in like `Camera::matrix()`, so the volume is the same one `VOV4::Project()` clips against.
+    // `width` and `height` are that viewport's.
+    Frustum(const M4x4& view_projection, float width, float height) noexcept;
+
+    // Whether any part may be inside, some things just outside a corner pass too, so it's conservative.
+    bool Intersects(const AABB& box) const noexcept;
+    bool Intersects(const Sphere& sphere) const noexcept;
+
+    // `Intersects()` for many boxes at once, 8 per instruction with AVX2. The boxes are given as `centers` and `extents`(see `AABB`), which must have the same `n()`.
+    // `visible[i]` is set to 1 if box `i` may be inside, 0 if it surely is not, it must be padded to `SOV4::kBatch`.
+    void Cull(uint8_t* visible, const SOV4& centers, const SOV4& extents) const noexcept;
+
+    // Plane `i` is `planes()[i*4]` to `planes()[i*4 + 3]`, [a,b,c,d], a point is inside if a*x + b*y + c*z + d >= 0. (a,b,c) are unit vectors, so it's the distance.
+    const float* planes() const noexcept { return planes_[0]; }
+
+    private:
+    alignas(16) float planes_[kPlanes][4];
+  };
+}
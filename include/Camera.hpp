@@ -1,6 +1,6 @@
 #pragma once
 
-#include "Context.hpp"
+#include "RenderTarget.hpp"
 #include "math.hpp"
 
 namespace nogl
@@ -22,6 +22,9 @@ namespace nogl
     // Type type();
 
     const M4x4& matrix() { return matrix_; }
+    // The viewport size baked into `matrix()`.
+    float width() const { return width_; }
+    float height() const { return height_; }
 
     void set_zfar(float zfar);
     void set_znear(float znear);
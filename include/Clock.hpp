@@ -18,6 +18,8 @@ namespace nogl
 
     // Returns an implementation specific "now" in milliseconds, 
     static unsigned long long global_now();
+    // Same as `global_now()` but in nanoseconds, for profiling.
+    static unsigned long long global_now_ns();
 
     // Returns the time in milliseconds that this Clock object has been up and running.
     unsigned now();
@@ -26,10 +28,14 @@ namespace nogl
     // Resets where the frame began, should be put right before loop to avoid possibly not sleeping on first frame. But not a major issue.
     void BeginLoop();
 
-    static void BeginMeasure() { measure_ = global_now(); }
-    static unsigned EndMeasure() { return global_now() - measure_; }
+    static void BeginMeasure() { measure_ = global_now_ns(); }
+    // Milliseconds since `BeginMeasure()` on this thread.
+    static unsigned EndMeasure() { return EndMeasureNs() / 1'000'000; }
+    // Nanoseconds since `BeginMeasure()` on this thread.
+    static unsigned long long EndMeasureNs() { return global_now_ns() - measure_; }
 
     private:
+    // In nanoseconds.
     static thread_local unsigned long long measure_;
 
     // `global_now()` when the object was constructed.
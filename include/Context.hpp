@@ -10,12 +10,13 @@
 #include <memory>
 #include <cstdint>
 
-#include "Image.hpp"
+#include "RenderTarget.hpp"
 #include "Exception.hpp"
 
 namespace nogl
 {
-  class Context
+  // The window, drawing into it is done through `RenderTarget`, where `data()` is the back buffer.
+  class Context : public RenderTarget
   {
     public:
 
@@ -68,36 +69,7 @@ namespace nogl
       event_handler_ = (cb == nullptr ? DefaultEventHandler : cb);
     }
 
-    // Clear the screen with the clear color.
-    void Clear() noexcept;
-    void set_clear_color(uint8_t b, uint8_t g, uint8_t r) noexcept;
-    // Sets the z buffer to 1!
-    void ClearZ() noexcept;
-
-    // Returns a pointer to the data.
-    // A flat array of BGRX components(X being reserved for 32-bit padding), it's essentially the back buffer.
-    inline uint8_t* data() const { return data_; }
-    // z-buffer, `0` means as front as it can get, and `1` means farthest it can be.
-    // The z-buffer is aligned to __m256!
-    inline float* zdata() const { return zdata_.get(); }
-
-    inline unsigned width() const { return width_; }
-    inline unsigned height() const { return height_; }
-
-    void PutImage(const Image& i, int x, int y);
-    // Float may be in any range, however:
-    // 0,0 <= x,y <= w-1.0f,h-1.0f are considered in bounds.
-    // 0 <= z <= 1 is considered in bounds.
-    void PutTriangle(
-      float ax, float ay, float az,
-      float bx, float by, float bz,
-      float cx, float cy, float cz
-    );
-
     private:
-    // Essentially has 4 copies in BGRX format. Cached.
-    alignas(__m256i) uint8_t clear_color_c256_[32];
-
     #ifdef _WIN32
       HWND hwnd_ = nullptr;
       HDC hdc_ = nullptr;
@@ -108,12 +80,7 @@ namespace nogl
       MSG msg_;
     #endif
 
-    unsigned width_, height_;
     Event event_;
-    // See `data()`.
-    uint8_t* data_;
-    // See `zdata()`.
-    std::unique_ptr<float[]> zdata_;
 
     // Cannot logically be `nullptr`.
     void (*event_handler_) (Context&, const Event&) = DefaultEventHandler;
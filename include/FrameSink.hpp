@@ -0,0 +1,131 @@
+#pragma once
+
+#include "Thread.hpp"
+#include "Bell.hpp"
+#include "Mutex.hpp"
+#include "RenderTarget.hpp"
+#include "Exception.hpp"
+
+#include <cstdint>
+#include <cstdio>
+#include <memory>
+#include <vector>
+#include <string>
+
+namespace nogl
+{
+  // Dumps finished frames for offline rendering, without the render loop ever touching the disk.
+  // `Push()` copies the frame into one of a few recycled buffers and queues it for a writer thread that encodes and writes it.
+  // The render loop only ever blocks if every buffer is still queued, meaning the disk can't keep up.
+  class FrameSink
+  {
+    public:
+    enum class Format : uint8_t
+    {
+      kRaw, // The BGRX bytes exactly like `RenderTarget::data()`, no header, good for piping into ffmpeg.
+      kPPM, // Binary(P6) PPM, RGB.
+      kQOI, // "Quite OK Image" format, RGB, very fast to encode.
+      kPNG, // RGB PNG, the deflate is split between the writer and `deflaters_n` helper threads.
+    };
+
+    enum class Target : uint8_t
+    {
+      kFiles, // A file per frame, `path` is a printf format with a single `%u` for the frame index, e.g "frames/%05u.png".
+      kStream, // All frames are appended to the single file at `path`.
+      kPipe, // `path` is a shell command, frames are written into its stdin.
+    };
+
+    // `width` and `height` are of the frames that will be pushed, and can't change.
+    // `buffers_n` is the max number of frames queued before `Push()` starts blocking.
+    // `deflaters_n` is how many extra threads help the writer compress PNGs, ignored for other formats.
+    // Can throw `OpenException` if the stream or pipe targets fail to open.
+    FrameSink(const char* path, Target target, Format format, unsigned width, unsigned height, unsigned buffers_n = 4, unsigned deflaters_n = 0);
+    // Writes whatever is still queued before returning.
+    ~FrameSink();
+
+    FrameSink(const FrameSink&) = delete;
+    void operator =(const FrameSink&) = delete;
+
+    // Copies `width*height` BGRX pixels and queues them. Blocks only if all the buffers are queued.
+    // Throws `WriteException` if a previous frame failed to be written.
+    void Push(const uint8_t* data);
+    void Push(const RenderTarget& target) { Push(target.data()); }
+    // Blocks until every frame pushed so far is written.
+    void Flush();
+
+    unsigned frames_pushed() const { return frames_pushed_; }
+
+    private:
+    // A helper thread that deflates a segment of the filtered PNG data, see `FrameSink::Format::kPNG`.
+    struct Deflater
+    {
+      Thread thread;
+      FrameSink* sink;
+      // Set by the writer before ringing the begin bell.
+      const uint8_t* in;
+      unsigned in_n;
+      bool last;
+      // Output of the segment and the adler32 of the input.
+      std::vector<uint8_t> out;
+      uint32_t adler;
+    };
+
+    std::string path_;
+    Target target_;
+    Format format_;
+    unsigned width_, height_;
+    unsigned frame_size_; // In bytes.
+
+    // Used by `kStream` and `kPipe`, `kFiles` opens a file per frame.
+    FILE* file_ = nullptr;
+
+    // `buffers_n_` frames of `frame_size_` bytes, aligned to 32 bytes.
+    std::unique_ptr<uint8_t[]> buffers_;
+    unsigned buffers_n_;
+
+    // All below are protected by `mutex_`.
+    Mutex mutex_;
+    // The buffer that the next `Push()` fills, and the buffer the writer writes next.
+    unsigned push_i_ = 0, write_i_ = 0;
+    // How many buffers are waiting to be written, or being written.
+    unsigned queued_n_ = 0;
+    bool alive_ = true;
+    bool failed_ = false;
+
+    // Writer waits for it when nothing is queued.
+    Bell queued_bell_;
+    // `Push()` and `Flush()` wait for it when the queue is full.
+    Bell written_bell_;
+
+    unsigned frames_pushed_ = 0;
+    unsigned frames_written_ = 0; // Only touched by the writer.
+
+    // Reused between frames to avoid allocating on every frame.
+    std::vector<uint8_t> encoded_;
+    // PNG only, the scanlines after filtering and the zlib stream of them.
+    std::vector<uint8_t> filtered_;
+    std::vector<uint8_t> deflated_;
+
+    std::unique_ptr<Deflater[]> deflaters_;
+    unsigned deflaters_n_;
+    bool deflaters_alive_ = true;
+    // SoA so the writer can `Bell::MultiWait()` on done.
+    std::unique_ptr<Bell[]> deflate_begin_bells_;
+    std::unique_ptr<Bell[]> deflate_done_bells_;
+
+    // Opened last, so everything above is ready for it.
+    Thread writer_;
+
+    // Returns false if failed to write.
+    bool Write(const uint8_t* frame);
+    void EncodePPM(const uint8_t* frame);
+    void EncodeQOI(const uint8_t* frame);
+    void EncodePNG(const uint8_t* frame);
+
+    int StartWriter();
+    int StartDeflater(unsigned i);
+
+    static int _StartWriter(FrameSink*& s) { return s->StartWriter(); }
+    static int _StartDeflater(Deflater*& d) { return d->sink->StartDeflater(d - d->sink->deflaters_.get()); }
+  };
+}
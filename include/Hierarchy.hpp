@@ -0,0 +1,65 @@
+#pragma once
+
+#include "math.hpp"
+
+#include <vector>
+#include <cstdint>
+
+namespace nogl
+{
+  // The transforms of all nodes of a scene, flattened into arrays(one per property) indexed by node, instead of a pointer tree.
+  // Nodes are stored topologically, a parent always comes before its children, so the world matrices are computed in one linear sweep, and only for the subtrees that changed.
+  class Hierarchy
+  {
+    public:
+    static constexpr unsigned kNoParent = ~0u;
+
+    Hierarchy() = default;
+    ~Hierarchy() = default;
+
+    // Adds a node with an identity transform, `parent` must have been added before(or be `kNoParent`), returns its index.
+    unsigned Add(unsigned parent);
+
+    // Setting any of these marks the node, and so its subtree, as dirty.
+    void set_translation(unsigned i, const V4& translation) { translations_[i] = translation; dirty_[i] |= kLocalDirty; any_dirty_ = true; }
+    void set_rotation(unsigned i, const Q4& rotation) { rotations_[i] = rotation; dirty_[i] |= kLocalDirty; any_dirty_ = true; }
+    void set_scale(unsigned i, const V4& scale) { scales_[i] = scale; dirty_[i] |= kLocalDirty; any_dirty_ = true; }
+    // Overrides the local matrix directly(glTF nodes may have a `matrix` instead of TRS), until one of the TRS setters is called again.
+    void set_local(unsigned i, const M4x4& local) { locals_[i] = local; dirty_[i] |= kWorldDirty; any_dirty_ = true; }
+
+    const V4& translation(unsigned i) const { return translations_[i]; }
+    const Q4& rotation(unsigned i) const { return rotations_[i]; }
+    const V4& scale(unsigned i) const { return scales_[i]; }
+    unsigned parent(unsigned i) const { return parents_[i]; }
+    // The number of nodes.
+    unsigned n() const { return parents_.size(); }
+
+    // From the node's space to its parent's.
+    const M4x4& local(unsigned i) const { return locals_[i]; }
+    // From the node's space to the world's, valid after `Update()`.
+    const M4x4& world(unsigned i) const { return worlds_[i]; }
+
+    // Recomputes the local and world matrices of everything that was marked dirty since the last call, and their subtrees.
+    // Must not be called while someone reads `world()`(e.g the minions are working).
+    void Update();
+
+    private:
+    // The TRS changed so the local matrix needs to be recomposed.
+    static constexpr uint8_t kLocalDirty = 1 << 0;
+    // Only the world matrix needs to be recomputed, e.g the parent moved.
+    static constexpr uint8_t kWorldDirty = 1 << 1;
+
+    std::vector<unsigned> parents_;
+
+    std::vector<V4> translations_;
+    std::vector<Q4> rotations_;
+    std::vector<V4> scales_;
+
+    std::vector<M4x4> locals_;
+    std::vector<M4x4> worlds_;
+
+    std::vector<uint8_t> dirty_;
+    // So a frame where nothing moved doesn't even sweep the flags.
+    bool any_dirty_ = false;
+  };
+}
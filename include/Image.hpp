@@ -15,6 +15,8 @@ namespace nogl
     protected:
     // For allowing both G and BGRA formats.
     void Open(const char* path, bool bgra);
+    // Allocates a zeroed `data_` for `width_*height_` pixels of `bpp` bytes each, aligned to 32 bytes and padded to a multiple of 32 bytes.
+    void Allocate(unsigned bpp);
     _Image() = default;
 
     // Read `data()`
@@ -27,11 +29,19 @@ namespace nogl
   {
     public:
     Image(const char* path) { Open(path, true); }
+    // A blank(all zero) image, meant to be rendered into via a `RenderTarget`.
+    Image(unsigned width, unsigned height)
+    {
+      width_ = width;
+      height_ = height;
+      Allocate(4);
+    }
     ~Image() = default;
 
-    // Stored in `BGRA` format, to be compatible with `Context`.
+    // Stored in `BGRA` format, to be compatible with `RenderTarget`.
     // Aligned to 32 bytes to be SIMD-friendly.
     const uint8_t* data() const { return data_.get(); }
+    uint8_t* data() { return data_.get(); }
   };
   
   // An alias for Image, to be more idiomatic.
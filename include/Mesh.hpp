@@ -5,42 +5,211 @@
 #include <string>
 #include <list>
 #include <memory>
+#include <cstdint>
+#include <variant>
 
 #include "math.hpp"
+#include "Bounds.hpp"
 
 namespace nogl
 {
   class Node;
   class Scene;
-  class Minion;
+
+  // A cluster of neighbouring triangles of a mesh, the unit `Scene::Cull()` works in below whole meshes.
+  struct Meshlet
+  {
+    static constexpr unsigned kMaxVertices = 64;
+    static constexpr unsigned kMaxTriangles = 124;
+
+    // The range of its level's `Mesh::Lod::indices` it covers.
+    unsigned first_triangle;
+    unsigned triangles_n;
+    // The range of `Mesh::Lod::meshlet_vertices`, every vertex the triangles use, once.
+    unsigned first_vertex;
+    unsigned vertices_n;
+
+    // Model space, like everything below.
+    Sphere sphere;
+    // The normal cone, every triangle faces away from a viewer at `v` if dot(normalize(`apex` - `v`), `axis`) >= `cutoff`.
+    // The cutoff is above 1 if the triangles face too many ways for that to ever be true.
+    V4 apex;
+    V4 axis;
+    float cutoff;
+  };
+
   // Right about now a "mesh" diverges from glTF format, a mesh is defined as a set of various buffers and information that help represent a complete 3D model.
   class Mesh
   {
     friend class Scene;
     friend class Node;
-    friend class Minion;
+    friend class Skin;
 
     public:
 
+    // Triangles, as flattened+packed triplets of either width.
+    using Indices = std::variant<std::vector<std::array<uint16_t, 3>>, std::vector<std::array<uint32_t, 3>>>;
+
+    // A level of detail, they all share the vertices, the simpler ones just use fewer of them.
+    struct Lod
+    {
+      // Stored in CCW, note that glTF requires it. 16-bit whenever the vertices fit, `std::visit()` it so the triangle loop is compiled for the width it has.
+      Indices indices;
+      // Every triangle of `indices` is in exactly one, the triangles are ordered so each has a range of them.
+      std::vector<Meshlet> meshlets;
+      // The vertex lists of all `meshlets`, one after another.
+      std::vector<unsigned> meshlet_vertices;
+      // About how far(model space) the surface strays from the full mesh's, 0 for the full mesh.
+      float error = 0.0f;
+    };
+
+    static constexpr unsigned kMaxLods = 8;
+    // `Instance::skin` of nodes without one.
+    static constexpr unsigned kNoSkin = ~0u;
+
+    // A morph target, what it adds to the vertices at a weight of 1.
+    struct Target
+    {
+      // The deltas of the positions and normals, either may be empty if the target doesn't move them.
+      // Dense, one per vertex, if `indices` is empty. Otherwise sparse, delta `i` is of vertex `indices[i]`, and the rest don't move.
+      VOV4 positions;
+      VOV4 normals;
+      // Sorted.
+      std::vector<unsigned> indices;
+      // The longest of the position deltas, how far it can move a vertex at a weight of 1.
+      float reach = 0.0f;
+    };
+
+    // A node drawing the mesh, everything that depends on where it is. They share all the rest.
+    struct Instance
+    {
+      // Index of the node, in the scene's `Hierarchy`.
+      unsigned node;
+      // Index of the node's `Skin` in `Scene::skins()`, or `kNoSkin`. Skinned instances are deformed by the minions right before they are projected, into `vertices_skinned()`.
+      unsigned skin = kNoSkin;
+      // The `targets()` whose weights(`Scene::weights()`) were not 0 at the last `Scene::Cull()`, the only ones the minions add.
+      std::vector<unsigned> active_targets;
+      // Which of `lods()` the last `Scene::Cull()` picked.
+      unsigned lod = 0;
+      // Indices into that level's meshlets that passed the last `Scene::Cull()`, only their vertices were projected so only they can be drawn.
+      std::vector<unsigned> visible_meshlets;
+      // Indices of the `VOV4::kBatch` sized batches of vertices the visible meshlets use, what the minions project. Sorted.
+      std::vector<unsigned> batches;
+    };
+
     Mesh() = default;
+    // The scratch is move only, and without saying so `std::vector<Mesh>` would try to copy it.
+    Mesh(const Mesh&) = delete;
+    Mesh(Mesh&&) = default;
+    Mesh& operator=(Mesh&&) = default;
 
-    const VOV4& vertices_projected() const { return vertices_projected_; }
+    // Every node that draws this mesh.
+    const std::vector<Instance>& instances() const { return instances_; }
+    // Indices into `instances()` of the ones that passed the last `Scene::Cull()`, the `i`th of them is projected into `vertices_projected(i)`.
+    const std::vector<unsigned>& visible_instances() const { return visible_instances_; }
+    const VOV4& vertices_projected(unsigned i) const { return projected_[i].vertices; }
+    // `VOV4::Outcode` bits of each of `vertices_projected(i)`, updated along with it.
+    const uint8_t* outcodes(unsigned i) const { return projected_[i].outcodes.get(); }
+    // The world space positions and normals of the `i`th visible instance after skinning, empty if the mesh is not `skinned()`(or has no normals).
+    // Only the batches that were projected are up to date.
+    const VOV4& vertices_skinned(unsigned i) const { return projected_[i].skinned_vertices; }
+    const VOV4& normals_skinned(unsigned i) const { return projected_[i].skinned_normals; }
+    // Same for the model space ones after the morph targets, only up to date if the instance had `Instance::active_targets`.
+    const VOV4& vertices_morphed(unsigned i) const { return projected_[i].morphed_vertices; }
+    const VOV4& normals_morphed(unsigned i) const { return projected_[i].morphed_normals; }
+    // Of whichever of `vertices()` and `vertices_quantized()` has them.
+    unsigned vertices_n() const { return quantized() ? vertices_quantized_.n() : vertices_.n(); }
+    // Empty if the scene was loaded with `Scene::kQuantizedPositions`, then it's `vertices_quantized()`.
     const VOV4& vertices() const { return vertices_; }
+    const SOVQ& vertices_quantized() const { return vertices_quantized_; }
+    // Brings `vertices_quantized()` back to model space, see `SOVQ::Quantize()`.
+    const M4x4& dequantization() const { return dequantization_; }
+    bool quantized() const { return vertices_quantized_.n() > 0; }
+    // Empty if the scene was loaded with `Scene::kHalfAttributes`, then it's `normals_half()`, and the other way around.
     const VOV4& normals() const { return normals_; }
-    const std::vector<std::array<unsigned, 3>>& indices() const { return indices_; }
+    const SOVH& normals_half() const { return normals_half_; }
+    // The w is the handedness of the bitangent, like in glTF. Same deal as `normals()`.
+    const VOV4& tangents() const { return tangents_; }
+    const SOVH& tangents_half() const { return tangents_half_; }
+    // `TEXCOORD_n` is `texcoords()[n]`, empty if the mesh has none.
+    const std::vector<VOV2>& texcoords() const { return texcoords_; }
+    // Whether it has `JOINTS_0` and `WEIGHTS_0`. Skinned and morphed meshes always keep full float positions and normals, whatever the `Scene::Storage`, they are deformed from those.
+    bool skinned() const { return weights_.n() > 0; }
+    // `WEIGHTS_0`, how much each of the 4 `joints()` of a vertex pulls it, they add up to 1.
+    const SOV4& weights() const { return weights_; }
+    // `JOINTS_0` stream `c`, indices into the joints of the node's `Skin`, padded like `weights()` and as far apart.
+    const uint16_t* joints(unsigned c) const { return joints_.get() + c * weights_.capacity(); }
+    // The morph targets of the primitive, empty if it has none.
+    const std::vector<Target>& targets() const { return targets_; }
+    // The weights of `targets()` of nodes that don't set their own, from the glTF mesh, 0s if it has none.
+    const std::vector<float>& default_weights() const { return default_weights_; }
+    // From the full mesh down, each has about half the triangles of the one before, and a bigger `Lod::error`. Every instance picks its own.
+    const std::vector<Lod>& lods() const { return lods_; }
+    // Model space bounds of the positions, from the accessor's min and max when glTF gives them.
+    const AABB& bounds() const { return bounds_; }
+    const Sphere& sphere() const { return sphere_; }
 
     private:
     std::string name_;
 
     VOV4 vertices_;
+    SOVQ vertices_quantized_;
+    M4x4 dequantization_;
     VOV4 normals_;
     VOV4 tangents_;
-    // This vov stores all the vertices after projection
-    VOV4 vertices_projected_;
-    // TODO: Gotta make VOV2 first...
-    // VOV2 texcoords_;
+    // 3 components, see `normals()`.
+    SOVH normals_half_;
+    // 4 components, see `tangents()`.
+    SOVH tangents_half_;
+    // Every set of texture coordinates, see `texcoords()`.
+    std::vector<VOV2> texcoords_;
+    SOV4 weights_;
+    // The 4 streams one after another, `weights_.capacity()` apart. MUST BE ALIGNED TO `VOV4::kAlign`
+    std::unique_ptr<uint16_t[]> joints_;
+    // The highest joint any vertex uses plus 1, a skin must have at least that many.
+    unsigned joints_n_ = 0;
+    std::vector<Target> targets_;
+    std::vector<float> default_weights_;
     
-    // Stored as flattened+packed triplets. Stored in CCW, note that glTF requires it.
-    std::vector<std::array<unsigned, 3>> indices_;
+    AABB bounds_;
+    Sphere sphere_;
+
+    // `lods_[0]` is the full mesh, loaded in the width of the file.
+    std::vector<Lod> lods_;
+
+    std::vector<Instance> instances_;
+    std::vector<unsigned> visible_instances_;
+    // The model-view-projection of each of `visible_instances_`, with `dequantization_` on the right if `quantized()`. What the minions project with.
+    std::vector<M4x4> instance_matrices_;
+    // The output of a visible instance.
+    struct Projected
+    {
+      VOV4 vertices;
+      // Padded to `VOV4::kBatch`, just like the VOVs.
+      std::unique_ptr<uint8_t[]> outcodes;
+      // Only allocated for `skinned()` meshes.
+      VOV4 skinned_vertices;
+      VOV4 skinned_normals;
+      // Only allocated if the mesh has `targets()`.
+      VOV4 morphed_vertices;
+      VOV4 morphed_normals;
+    };
+    // Per frame scratch, only as many as were visible at once so far, no matter how many instances there are.
+    std::vector<Projected> projected_;
+    // One per batch, for building `Instance::batches`, all 0 between culls.
+    std::vector<uint8_t> batch_marks_;
+
+    // Builds the meshlets of `lods_[0]`, and reorders the triangles within each, then the vertices(`positions` too) for locality.
+    // Returns where each vertex went, so the other attributes can be put in the same order, `remap[old] = new`.
+    // Also narrows 32-bit indices to 16-bit if they fit, and then simplifies the full mesh into the other `lods_`.
+    std::vector<unsigned> Optimize(VOV4& positions);
+    // Fills `instance.visible_meshlets` and `instance.batches` from the meshlets of its `Instance::lod`, with `frustum` and `eye` in model space.
+    // `cones` is false if the model matrix mirrors, then the windings flip and normal cones mean nothing.
+    // A `nullptr` `frustum` keeps every meshlet, for skinned instances, whose bind pose spheres and cones say nothing about where the triangles end up.
+    // The spheres are grown by `grow`, how far the morph targets may move the vertices, the cones are skipped if it's not 0.
+    void CullMeshlets(Instance& instance, const Frustum* frustum, const V4& eye, bool cones, float grow = 0.0f);
+    // Adds the `instance.active_targets` at `weights` to the vertices from `from` to `to`, into `positions`, and `normals`(renormalized) if it isn't `nullptr` and the mesh has normals.
+    // Huge note: `from` must be a multiple of `VOV4::kBatch`, `to` may be anything up to `vertices_n()`.
+    void Morph(const Instance& instance, const float* weights, VOV4& positions, VOV4* normals, unsigned from, unsigned to) const noexcept;
   };
 }
@@ -4,12 +4,13 @@
 #include "Thread.hpp"
 #include "Bell.hpp"
 #include "Atomic.hpp"
-#include "math.hpp"
-#include "Scene.hpp"
 
 #include <cstdint>
 #include <memory>
 #include <list>
+#include <vector>
+#include <functional>
+#include <initializer_list>
 
 namespace nogl
 {
@@ -17,7 +18,7 @@ namespace nogl
 
   // A minion is a sub-thread of the main thread, does the evil bidding of the main thread >:).
   // For instance it multiplies VOVs by matrices, runs shaders, anything that needs to be done fast, and can be split into threads, it does.
-  // A minion only knows how many other minions there are, and its own index, it is all it needs to figure out which portions it works on during runtime.
+  // It knows nothing about what it runs, every frame it pulls the jobs the main thread `Wizard::Submit()`ed until they are all done.
   class Minion
   {
     friend class Wizard;
@@ -51,8 +52,29 @@ namespace nogl
     // Must only be interfaced with when the minions are not working.
     static bool alive;
 
-    // Information in scene must remain untouched until the minions have rung their done bells.
-    static Scene* scene;
+    // What the minions run, `function(data, from, to)` over pieces of the range from 0 to `n`, in any order and on any minion.
+    using Function = void (*)(void* data, unsigned from, unsigned to);
+
+    // How many bytes a chunk of a job should touch, about half of a core's L2, so what a minion works on stays in its own cache, while there are still plenty of chunks to steal.
+    static constexpr unsigned kChunkBytes = 64 * 1024;
+    // The `grain` for items that each touch `item_bytes` bytes, so a chunk is `kChunkBytes`.
+    static constexpr unsigned Grain(unsigned item_bytes) { return item_bytes < kChunkBytes ? kChunkBytes / item_bytes : 1; }
+
+    // Adds a job to the next `RingBegin()`, and returns its id, which later jobs can put in their `after`.
+    // The range is cut into chunks of `grain` items(see `Grain()`), and those are dealt out evenly, each minion gets a consecutive run of them.
+    // A minion that runs out of its own steals half of what is left of the busiest one's, so no one waits for a slow(or preempted) minion in `WaitDone()`.
+    // None of it starts before every job in `after` is done, those must have been submitted before it(so no cycles).
+    // Only call it while the minions are not working, between `WaitDone()` and `RingBegin()`. Whatever `data` points to must stay untouched until `WaitDone()`.
+    static unsigned Submit(Function function, void* data, unsigned n, unsigned grain = 1, std::initializer_list<unsigned> after = {});
+    // Typed `Submit()`, `kFunction` is called as `std::invoke(kFunction, data, from, to)`, so it can be a member function of `T`, e.g `Submit<&Scene::Project>(scene, n)`.
+    template <auto kFunction, typename T>
+    static unsigned Submit(T& data, unsigned n, unsigned grain = 1, std::initializer_list<unsigned> after = {})
+    {
+      return Submit(
+        [](void* data, unsigned from, unsigned to) { std::invoke(kFunction, *static_cast<T*>(data), from, to); },
+        &data, n, grain, after
+      );
+    }
 
     // You have control over the minions, but be cautious.
     static UniqueArray SpawnMinions(unsigned n);
@@ -61,6 +83,7 @@ namespace nogl
     static UniqueArray SpawnMinions() { return SpawnMinions(Thread::logical_cores() - 1); }
     // Wait for all minions to ring done_bell, and reset them it too because if they reset it leads to unexpected behaviour. Must not be called in the minion thread, will lead to deadlock.
     // Essentially, this function allows you to wait for the minions to finish what they were assigned. After this function, it is expected you use `RingBegin()` when you are ready for minions to keep going.
+    // All the submitted jobs are done by then, and forgotten, so the ids start from 0 again.
     // MUST be called after calling `RingBegin()` in the loop, otherwise main and minions get out of sync on `begin_bells_`.
     static void WaitDone();
     // Rings appropriate `begin_bell`, has internal logic that takes care of switching bells.
@@ -69,7 +92,34 @@ namespace nogl
     static unsigned RingBegin();
 
     private:
+    // The chunks of a job a minion still has, [begin, end) packed as `begin | end << 32`, so the minion can take from the front, and thieves from the back, each with one compare-exchange.
+    // On its own cache line, the minions hammer their own ones.
+    struct alignas(64) Slice
+    {
+      Atomic<uint64_t> chunks;
+    };
+
+    struct Job
+    {
+      Function function;
+      void* data;
+      unsigned n;
+      unsigned grain;
+      std::vector<unsigned> after;
+      // One per minion.
+      std::unique_ptr<Slice[]> slices;
+      // Items not done yet, the job is done at 0.
+      Atomic<unsigned> left;
+    };
+
     static uint8_t minions_n_;
+    // Of this frame, in the order they were submitted.
+    static std::vector<Job> jobs_;
+
+    // What every minion does between the bells, runs chunks of whatever jobs are ready until all are done. `self` is the minion's index, and its slice in every job.
+    static void Work(unsigned self);
+    // Takes a chunk of `job` into `chunk`, from the front of `self`'s slice, or else stolen from the busiest other slice. False if there is nothing left to take.
+    static bool Take(Job& job, unsigned self, unsigned& chunk);
 
     // A bell from the main thread to all threads to begin work.
     // Double bell design because otherwise no way to deterministically stop minions from accidentally beginning again.
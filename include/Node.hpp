@@ -1,7 +1,6 @@
 #pragma once
 
 #include <string>
-#include <list>
 #include <variant>
 
 #include "Camera.hpp"
@@ -12,6 +11,7 @@ namespace nogl
 {
   class Scene;
   // A general object that can hold different types of entities.
+  // Its transform lives in the scene's `Hierarchy`, at `index()`.
   class Node
   {
     friend class Scene;
@@ -22,14 +22,15 @@ namespace nogl
     Node() = default;
 
     const Variant& data() { return data_; }
+    const Variant& data() const { return data_; }
+
+    // Index into the scene's `Hierarchy`.
+    unsigned index() const { return index_; }
 
     private:
     std::string name_;
-
-    V4 position;
-    Q4 rotation;
+    unsigned index_ = 0;
 
     Variant data_;
-    std::list<Node> children_;
   };
 }
@@ -0,0 +1,69 @@
+#pragma once
+
+#include "Atomic.hpp"
+#include "Clock.hpp"
+
+#include <cstdint>
+#include <memory>
+
+namespace nogl
+{
+  // Per stage frame profiler, scoped nanosecond timers that can be exported as Chrome trace-event JSON(chrome://tracing or ui.perfetto.dev).
+  // Every thread records into its own ring buffer, so recording never locks, and never waits on other threads.
+  // Example: `{ Profiler::Scope scope("raster"); ... }`
+  class Profiler
+  {
+    public:
+    struct Event
+    {
+      // Must be a string literal, or otherwise outlive the profiler.
+      const char* name;
+      // In `Clock::global_now_ns()` time.
+      unsigned long long begin, end;
+    };
+
+    // Events kept per thread, older ones are overwritten.
+    static constexpr unsigned kEventsN = 1 << 14;
+    // Threads with a `Thread::index()` above this are not recorded.
+    static constexpr unsigned kThreadsN = 64;
+
+    // Measures from construction to destruction.
+    class Scope
+    {
+      public:
+      Scope(const char* name) : name_(name), begin_(Clock::global_now_ns()) {}
+      ~Scope() { Record(name_, begin_, Clock::global_now_ns()); }
+
+      Scope(Scope&) = delete;
+      void operator =(const Scope&) = delete;
+
+      private:
+      const char* name_;
+      unsigned long long begin_;
+    };
+
+    // Can be flipped at any time, when false `Record()` returns right away.
+    static bool enabled;
+
+    // Records into the calling thread's buffer.
+    static void Record(const char* name, unsigned long long begin, unsigned long long end);
+
+    // Writes every recorded event of every thread into `path`.
+    // Best called when threads are not recording(e.g between frames), otherwise the newest events of busy threads may be torn.
+    // Throws `OpenException` if the file can't be opened.
+    static void ExportChromeTrace(const char* path);
+
+    private:
+    struct Buffer
+    {
+      // Total events ever recorded, the ring index is `n % kEventsN`. Only the owning thread writes it.
+      Atomic<unsigned> n = 0;
+      Event events[kEventsN];
+    };
+
+    // Indexed by `Thread::index()`, allocated by the owning thread on its first record.
+    static Atomic<Buffer*> buffers_[kThreadsN];
+    // What frees `buffers_` at exit, they outlive their threads so a trace can still be exported after a thread is gone.
+    static std::unique_ptr<Buffer> owned_[kThreadsN];
+  };
+}
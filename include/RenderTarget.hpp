@@ -0,0 +1,84 @@
+#pragma once
+
+#include <immintrin.h>
+#include <memory>
+#include <cstdint>
+
+#include "Image.hpp"
+#include "Exception.hpp"
+
+namespace nogl
+{
+  class V4;
+
+  // Anything that can be drawn into, a color buffer and an optional z-buffer.
+  // `Context` is one, with the window's back buffer as the color, but a target can also be offscreen, for shadow maps, reflections and post processing chains, rendering to a texture essentially.
+  // All drawing goes through here, so offscreen targets take the exact same paths as the window.
+  class RenderTarget
+  {
+    public:
+    // An offscreen target that owns its buffers, no present step, just use `data()`.
+    // `depth` decides whether to allocate a z-buffer.
+    RenderTarget(unsigned width, unsigned height, bool depth = true);
+    // Renders straight into the pixels of `image`, so it can be used as a texture right after, no copies.
+    // `image` must outlive the target.
+    RenderTarget(Image& image, bool depth = false);
+    ~RenderTarget() = default;
+
+    RenderTarget(RenderTarget&) = delete;
+    void operator =(const RenderTarget&) = delete;
+
+    // Clear the color buffer with the clear color.
+    void Clear() noexcept;
+    void set_clear_color(uint8_t b, uint8_t g, uint8_t r) noexcept;
+    // Sets the z buffer to 1! Does nothing without a z-buffer.
+    void ClearZ() noexcept;
+
+    // Returns a pointer to the data.
+    // A flat array of BGRX components(X being reserved for 32-bit padding), the same layout as `Image`.
+    inline uint8_t* data() const { return data_; }
+    // z-buffer, `0` means as front as it can get, and `1` means farthest it can be.
+    // The z-buffer is aligned to __m256! May be `nullptr` if the target was made without depth.
+    inline float* zdata() const { return zdata_.get(); }
+
+    inline unsigned width() const { return width_; }
+    inline unsigned height() const { return height_; }
+
+    void PutImage(const Image& i, int x, int y);
+    // Float may be in any range, however:
+    // 0,0 <= x,y <= w-1.0f,h-1.0f are considered in bounds.
+    // 0 <= z <= 1 is considered in bounds.
+    // Without a z-buffer the triangle is drawn over whatever is there.
+    void PutTriangle(
+      float ax, float ay, float az,
+      float bx, float by, float bz,
+      float cx, float cy, float cz
+    );
+    // Textured `PutTriangle()`, `a`-`c` are projected vertices the way `VOV4::Project()` writes them, [x/w, y/w, z/w, 1/w], and `uv_a`-`uv_c` are their texture coordinates.
+    // u/w, v/w and 1/w are what's linear on the screen, not u and v, so those are interpolated and u and v are recovered per pixel, perspective correct.
+    // Nearest sampling, and the coordinates repeat outside 0-1, glTF's default. Depth is interpolated too, unlike the flat one.
+    void PutTriangle(
+      const V4& a, const V4& b, const V4& c,
+      const float uv_a[2], const float uv_b[2], const float uv_c[2],
+      const Image& texture
+    );
+
+    protected:
+    // For targets that set up `data_` themselves, like `Context`.
+    RenderTarget() = default;
+
+    // Allocates the z-buffer for the current `width_` and `height_`.
+    void AllocateZ();
+
+    // A BGRX pixel, ready for `Simd::Kernels::fill32`.
+    uint32_t clear_color_ = 0;
+
+    unsigned width_, height_;
+    // See `data()`, not necessarily owned by us.
+    uint8_t* data_;
+    // Set only if we allocated `data_` ourselves.
+    std::unique_ptr<uint8_t[]> owned_data_;
+    // See `zdata()`.
+    std::unique_ptr<float[]> zdata_;
+  };
+}
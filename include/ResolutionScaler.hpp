@@ -0,0 +1,70 @@
+#pragma once
+
+#include "RenderTarget.hpp"
+
+#include <memory>
+#include <cstdint>
+
+namespace nogl
+{
+  // Dynamic resolution, renders into a smaller offscreen target when frames go over budget, and upscales it to the output.
+  // The render resolution is driven by a feedback controller on measured frame times, so on weak machines we lose resolution instead of frames.
+  class ResolutionScaler
+  {
+    public:
+    // `width` and `height` are the output's(usually `Context`) size, the most we can render at.
+    // `min_scale` is the lowest fraction of the output resolution(on each axis) that we will ever go to.
+    ResolutionScaler(unsigned width, unsigned height, float min_scale = 0.5f);
+    ~ResolutionScaler() = default;
+
+    // What to render into this frame, it is a different object after `Update()` returns true.
+    RenderTarget& target() { return *target_; }
+    // The current fraction of the output resolution on each axis.
+    float scale() const { return scale_; }
+
+    // Remembered, so it survives the target being recreated.
+    void set_clear_color(uint8_t b, uint8_t g, uint8_t r);
+
+    // Feeds the controller with how long the last frame's work took, not counting sleeping, and the budget, both in milliseconds.
+    // Returns true if the resolution changed, if so you need to call `Scene::UpdateCameras()` with the new `target()`.
+    // Must be called when nobody is drawing into `target()`.
+    bool Update(float frame_time, float target_frame_time);
+
+    // Bilinearly upscales `target()` into `output`, which must be the size given in the constructor.
+    void Upscale(RenderTarget& output) const;
+
+    private:
+    // How much of the budget we aim to use, leaving some room for spikes.
+    static constexpr float kHeadroom = 0.85f;
+    // How much of each new frame time goes into the smoothed one.
+    static constexpr float kSmoothing = 0.2f;
+    // Relative errors(in log scale) below this are ignored, avoids flickering between resolutions.
+    static constexpr float kDeadband = 0.05f;
+    static constexpr float kGain = 0.3f;
+    // Frames to wait after a resolution change, so the controller sees the effect before acting again.
+    static constexpr unsigned kCooldown = 15;
+    // Render sizes are rounded to this, so tiny scale changes don't reallocate.
+    static constexpr unsigned kGranularity = 8;
+
+    unsigned width_, height_;
+    float min_scale_;
+
+    // Where the controller wants to be, and where we actually are after rounding.
+    float desired_scale_ = 1.0f, scale_ = 1.0f;
+    float frame_time_ = 0.0f;
+    unsigned cooldown_ = 0;
+
+    uint8_t clear_color_[3] = {0, 0, 0};
+
+    std::unique_ptr<RenderTarget> target_;
+
+    // Per output column: the left source pixel, and the weight of the right one(0-32767, for `_mm_mulhrs_epi16()`).
+    std::unique_ptr<unsigned[]> x0_;
+    std::unique_ptr<int16_t[]> wx_;
+
+    // Render width for `scale`, rounded down to `kGranularity`, except within the last step, which is the output's width.
+    unsigned ScaledWidth(float scale) const;
+    // Recreates `target_` and the column tables for the current `scale_`.
+    void Resize();
+  };
+}
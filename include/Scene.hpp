@@ -5,38 +5,111 @@
 
 #include "Exception.hpp"
 #include "Node.hpp"
+#include "Hierarchy.hpp"
+#include "Skin.hpp"
+#include "Animation.hpp"
 #include "JSON.hpp"
-#include "Context.hpp"
+#include "RenderTarget.hpp"
 
 namespace nogl
 {
-  class Minion;
   // A wrapper for GLB files. Meant to store the full scene state provided by a GLB file.
   // As of now GLTF files are not supported.
   class Scene
   {
-    friend class Minion;
-    
     public:
     // Can be nullptr.
     Node* main_camera_node;
 
+    // Optional storage modes of the meshes, trading precision for memory. Or them into the `storage` of the constructor.
+    enum Storage : unsigned
+    {
+      // Normals and tangents are kept in half precision(`Mesh::normals_half()` and `Mesh::tangents_half()`), instead of full `VOV4`s.
+      kHalfAttributes = 1 << 0,
+      // Positions are kept as 16 bit integers over the mesh's bounding box(`Mesh::vertices_quantized()`), and transformed straight from them.
+      kQuantizedPositions = 1 << 1,
+    };
+
     // Throws `FileException` variant if something fails.
-    // Any subsequent resizing of `ctx` will require a call to `UpdateCameras`.
-    Scene(const char* path, Context& ctx);
+    // Any subsequent resizing of `target` will require a call to `UpdateCameras`.
+    Scene(const char* path, RenderTarget& target, unsigned storage = 0);
     ~Scene();
 
     const std::vector<Mesh>& meshes() const { return meshes_; }
+    // Indexed by `Mesh::Instance::skin`.
+    const std::vector<Skin>& skins() const { return skins_; }
+    // `Animation::Apply()` them into `hierarchy()`, before its `Hierarchy::Update()`.
+    std::vector<Animation>& animations() { return animations_; }
+    const std::vector<Animation>& animations() const { return animations_; }
+    // In the same order as `hierarchy()`, so `nodes()[i].index() == i`.
     const std::vector<Node>& nodes() const { return nodes_; }
+    // The weights of the morph targets(`Mesh::targets()`) of node `i`'s mesh, from the node or the mesh's `Mesh::default_weights()`, empty if it has none.
+    // Set them(or let `animations()` do it) before `Cull()`, the targets at 0 cost nothing.
+    std::vector<float>& weights(unsigned i) { return weights_[i]; }
+    const std::vector<float>& weights(unsigned i) const { return weights_[i]; }
+    // The transforms of all nodes, set them there, then call `Hierarchy::Update()` before the frame's work begins.
+    Hierarchy& hierarchy() { return hierarchy_; }
+    const Hierarchy& hierarchy() const { return hierarchy_; }
+
+    // Loop through the cameras and tie them to `target`, the cameras depend on the width and height of the target for optimization purposes, so this is very important, otherwise rendering will have incorrect screen-space scaling.
+    void UpdateCameras(RenderTarget& target);
+
+    // Tests the world space bounding box of every mesh against the main camera's `Frustum`, all in one `Frustum::Cull()`.
+    // Then the meshlets of the visible meshes by their spheres and normal cones, see `Mesh::Instance::visible_meshlets`, of the level of detail it picks for them(`lod_error()`).
+    // Call it after `hierarchy().Update()`, before the frame's work begins. It also fills `Mesh::visible_instances()`, the only ones the minions project, and so the only ones to draw.
+    // It also updates `Skin::matrices()` from the joints, skinned instances are bounded by the mesh's box under every one of them, and keep all their meshlets.
+    // And `Mesh::Instance::active_targets` from `weights()`, the bounds and meshlet spheres of morphed instances grow by how far those can move the vertices.
+    void Cull();
+    // Submits the projection of the instances the last `Cull()` left visible(morphing and skinning them on the way) to the minions, as one `Wizard::Submit()` range job over their batches of vertices.
+    // Returns its id, so jobs that need the projected vertices can wait for it. Call it after `Cull()`, then `Wizard::RingBegin()`, the scene must be left alone until `Wizard::WaitDone()`.
+    unsigned SubmitProjection();
+    // Whether node `i` passed the last `Cull()`, nodes without meshes always do.
+    bool visible(unsigned i) const { return visible_[i]; }
+    // The world space bounding sphere of node `i`'s mesh, as of the last `Cull()`.
+    const Sphere& sphere(unsigned i) const { return spheres_[i]; }
 
-    // Loop through the cameras and tie them to `ctx`, the cameras depend on the width and height of the context for optimization purposes, so this is very important, otherwise rendering will have incorrect screen-space scaling.
-    void UpdateCameras(Context& ctx);
+    // `Cull()` also picks each instance's `Mesh::Instance::lod`, the simplest one whose `Mesh::Lod::error` is at most this many pixels on screen, measured at the nearest point of the mesh's sphere.
+    float lod_error() const { return lod_error_; }
+    void set_lod_error(float pixels) { lod_error_ = pixels; }
 
     private:
+    // A visible instance in `SubmitProjection()`'s job, its batches are items `first` onwards.
+    struct ProjectRun
+    {
+      Mesh* mesh;
+      // Which of `Mesh::visible_instances()`.
+      unsigned slot;
+      unsigned first;
+    };
+
     std::string name_;
     std::vector<Node> nodes_;
+    Hierarchy hierarchy_;
     std::vector<Mesh> meshes_;
+    std::vector<Skin> skins_;
+    std::vector<Animation> animations_;
     std::vector<Camera> cameras_;
     std::vector<V4> points_;
+
+    // The nodes that have meshes, `mesh_instances_`, `cull_centers_`, `cull_extents_` and `cull_visible_` are indexed like it.
+    std::vector<unsigned> mesh_nodes_;
+    // Which of its mesh's `Mesh::instances()` each is.
+    std::vector<unsigned> mesh_instances_;
+    SOV4 cull_centers_;
+    SOV4 cull_extents_;
+    // Padded to `SOV4::kBatch`.
+    std::unique_ptr<uint8_t[]> cull_visible_;
+    // Indexed by node.
+    std::vector<uint8_t> visible_;
+    std::vector<Sphere> spheres_;
+    std::vector<std::vector<float>> weights_;
+    // How far the active targets of each mesh node may move its vertices, in model space. Indexed like `mesh_nodes_`.
+    std::vector<float> reaches_;
+    // Sorted by `ProjectRun::first`.
+    std::vector<ProjectRun> project_runs_;
+
+    // The job of `SubmitProjection()`, items `from` to `to` of `project_runs_`'s batches.
+    void Project(unsigned from, unsigned to);
+    float lod_error_ = 1.0f;
   };
 }
@@ -0,0 +1,106 @@
+#pragma once
+
+#include <cstdint>
+
+namespace nogl
+{
+  // Runtime SIMD dispatch, so one binary runs on anything with SSE4.1, and still uses AVX2 and AVX-512 where they exist.
+  // The hot kernels are compiled once per `Level`(see src/simd/), and the best level the CPU supports is picked once at startup via cpuid.
+  // Everything else in nogl is compiled for plain SSE4.1.
+  class Simd
+  {
+    public:
+    enum class Level : uint8_t
+    {
+      kSSE4,
+      kAVX2,
+      kAVX512,
+    };
+
+    // The kernels, every level has its own version.
+    // Vectors(`V4`s) and matrices(`M4x4`s) are passed as their floats, the layouts are the same as in math.hpp.
+    // Ranges of vectors must start at a multiple of `VOV4::kBatch`, and the buffers must be padded to it.
+    struct Kernels
+    {
+      // `VOV4` kernels, see the methods of the same name.
+      void (*multiply)(float* out, const float* in, const float* m, unsigned from, unsigned to);
+      void (*divide_by_w)(float* out, const float* in, unsigned from, unsigned to);
+      void (*add)(float* out, const float* in, const float* v, unsigned from, unsigned to);
+      // `out` = `in` + `v` * `s`, `v` is a whole buffer like `in`.
+      void (*add_scaled)(float* out, const float* in, const float* v, float s, unsigned from, unsigned to);
+      // `out[indices[i]]` += `v[i]` * `s`, `from` and `to` index `indices` and `v`, so they need no alignment or padding.
+      void (*scatter_add_scaled)(float* out, const unsigned* indices, const float* v, float s, unsigned from, unsigned to);
+      void (*rotate)(float* out, const float* in, const float* q, unsigned from, unsigned to);
+      void (*project)(float* out, uint8_t* outcodes, const float* in, const float* m, float width, float height, unsigned from, unsigned to);
+      // `refine` is `VOV4::Precision::kPrecise`.
+      void (*normalize)(float* out, const float* in, bool refine, unsigned from, unsigned to);
+      void (*multiply_normals)(float* out, const float* in, const float* m, bool refine, unsigned from, unsigned to);
+      // `out` gets one float per vector, `dot_vector` is against the single vector `v`.
+      void (*dot)(float* out, const float* a, const float* b, unsigned from, unsigned to);
+      void (*dot_vector)(float* out, const float* a, const float* v, unsigned from, unsigned to);
+      void (*cross)(float* out, const float* a, const float* b, unsigned from, unsigned to);
+      // The vectors are quaternions, `t` has one float per vector.
+      void (*slerp)(float* out, const float* a, const float* b, const float* t, unsigned from, unsigned to);
+
+      // `SOV4` kernels, `streams`/`capacity` describe the SoA buffer, `vov` is the `VOV4` buffer.
+      void (*sov4_from_vov4)(float* streams, unsigned capacity, const float* vov, unsigned n);
+      void (*sov4_to_vov4)(float* vov, const float* streams, unsigned capacity, unsigned n);
+      void (*sov4_multiply)(float* out, const float* in, unsigned capacity, const float* m, unsigned from, unsigned to);
+
+      // `SOVH` kernels, like the `SOV4` ones but the streams are half precision floats, and only the first `components` of them exist, the rest read as 0.
+      void (*sovh_from_vov4)(uint16_t* streams, unsigned capacity, unsigned components, const float* vov, unsigned n);
+      void (*sovh_to_vov4)(float* vov, const uint16_t* streams, unsigned capacity, unsigned components, unsigned n);
+      // Straight into the `VOV4` `out`, the full floats never hit memory in between.
+      void (*sovh_multiply)(float* out, const uint16_t* in, unsigned capacity, unsigned components, const float* m, unsigned from, unsigned to);
+
+      // `SOVQ` kernel, `project` but from the 3 16 bit integer streams of `in`.
+      void (*sovq_project)(float* out, uint8_t* outcodes, const int16_t* in, unsigned capacity, const float* m, float width, float height, unsigned from, unsigned to);
+
+      // `Frustum::Cull()`, `centers` and `extents` are the x, y and z streams of the 2 `SOV4`s, `planes` are the 6 of `Frustum::planes()`.
+      void (*cull_boxes)(uint8_t* visible, const float* centers, const float* extents, unsigned capacity, const float* planes, unsigned n);
+
+      // `Skin::Deform()`, `joints` and `weights` are 4 streams each(see `Mesh::joints()` and `Mesh::weights()`), both `capacity` apart. `matrices` are the skin's `M4x4`s one after another.
+      // `normals` and `out_normals` may be `nullptr`, then only the positions are skinned.
+      void (*skin)(float* out_positions, float* out_normals, const float* positions, const float* normals, const uint16_t* joints, const float* weights, unsigned capacity, const float* matrices, unsigned from, unsigned to);
+
+      // `RenderTarget` kernels.
+      // Sets `n` 32 bit pixels to `value`, no alignment or padding needed.
+      void (*fill32)(uint32_t* dst, uint32_t value, unsigned n);
+      // Sets `n` floats to `value`, no alignment or padding needed.
+      void (*fill_float)(float* dst, float value, unsigned n);
+      // One row of a triangle, `n` pixels from `color`(and `z`, may be `nullptr`).
+      // `f` are the 3 edge functions at the first pixel, stepping by `step` every pixel. Pixels inside all 3 edges, and not behind `z`, get `bgrx` and `depth`.
+      void (*raster_row)(uint32_t* color, float* z, unsigned n, const int f[3], const int step[3], float depth, uint32_t bgrx);
+      // `raster_row` but textured, `linear` are z, 1/w, u/w and v/w at the first pixel, stepping by `linear_step` every pixel.
+      // u and v are recovered per pixel from them, perspective correct, and sample the `texture_width`x`texture_height` `texels` nearest, repeating outside 0-1. The texels' A is not blended.
+      void (*raster_row_textured)(uint32_t* color, float* z, unsigned n, const int f[3], const int step[3], const float linear[4], const float linear_step[4], const uint32_t* texels, unsigned texture_width, unsigned texture_height);
+      // Blends `n` BGRA pixels from `src` over the BGRX pixels of `dst` by the source's alpha, `dst`'s X is left alone.
+      void (*blend_row)(uint8_t* dst, const uint8_t* src, unsigned n);
+    };
+
+    // The best level the CPU(and the OS) supports.
+    static Level supported();
+    // The level `kernels()` are of.
+    static Level level() { return level_; }
+    // Forces a level, for benchmarking the different paths. It is clipped to `supported()`, returns what was actually set.
+    // The `NOGL_SIMD` environment variable(`sse4`, `avx2` or `avx512`) does the same at startup.
+    // Must not be called while anyone uses the kernels(e.g the minions are working).
+    static Level set_level(Level level);
+    static const char* name(Level level);
+
+    static const Kernels& kernels() { return *kernels_; }
+
+    private:
+    // Each defined by its own translation unit in src/simd/, compiled with that level's flags.
+    // A level may leave a kernel `nullptr` if it has nothing better than the level below, it is filled at startup.
+    static const Kernels kSSE4Kernels;
+    static const Kernels kAVX2Kernels;
+    static const Kernels kAVX512Kernels;
+
+    static Level level_;
+    static const Kernels* kernels_;
+
+    // Picks the level at startup.
+    static const Kernels* Initialize();
+  };
+}
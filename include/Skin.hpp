@@ -0,0 +1,35 @@
+#pragma once
+
+#include "math.hpp"
+#include "Mesh.hpp"
+
+#include <vector>
+
+namespace nogl
+{
+  // A glTF skin, the joints(nodes) that deform the meshes of the nodes using it, with linear blend skinning.
+  // Like glTF says, the transform of the node using the skin is ignored, the joints alone place the mesh in the world.
+  class Skin
+  {
+    friend class Scene;
+
+    public:
+    // Indices of the joints in the scene's `Hierarchy`, joint `j` of `Mesh::joints()` is `joints()[j]`.
+    const std::vector<unsigned>& joints() const { return joints_; }
+    // From model space to each joint's space in the bind pose, identities if the file has none.
+    const std::vector<M4x4>& inverse_binds() const { return inverse_binds_; }
+    // The world matrix of each joint times its inverse bind, from model space to the world's in the current pose. Updated by `Scene::Cull()`.
+    const std::vector<M4x4>& matrices() const { return matrices_; }
+
+    // Blends up to 4 of `matrices()` per vertex by `Mesh::weights()` of `mesh`(must be `skinned()`) and deforms `positions` by them into `out_positions`, and `normals` into `out_normals` if neither is `nullptr`.
+    // `positions` and `normals` are the mesh's own, or them after `Mesh::Morph()`.
+    // The normals go through the same blended matrices and are renormalized, which is only exact for uniform scales, but that is what everyone does.
+    // Huge note: `from` must be a multiple of `VOV4::kBatch`, `to` may be anything up to `mesh.vertices_n()`.
+    void Deform(const Mesh& mesh, const VOV4& positions, const VOV4* normals, VOV4& out_positions, VOV4* out_normals, unsigned from, unsigned to) const noexcept;
+
+    private:
+    std::vector<unsigned> joints_;
+    std::vector<M4x4> inverse_binds_;
+    std::vector<M4x4> matrices_;
+  };
+}
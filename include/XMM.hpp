@@ -7,6 +7,7 @@
 
 #include <type_traits>
 #include <cstdint>
+#include <cstring>
 
 namespace nogl
 {
@@ -41,6 +42,7 @@ namespace nogl
   class XMM<float>
   {
     friend class YMM<float>;
+    friend class XMM<int32_t>;
     public:
     XMM() = default;
     // 4 floats will be loaded. `f` must be aligned to 128 bits, if not, use `LoadUnaligned()`.
@@ -73,6 +75,46 @@ namespace nogl
     {
       return _mm_rsqrt_ps(data_);
     }
+    // Approximate 1/x, relative error is at most 1.5*2^-12, refine with a Newton-Raphson step if you need more.
+    XMM Reciprocal() const { return _mm_rcp_ps(data_); }
+
+    // Per component masks, all bits set where the comparison is true, 0 where it's false. Combine with `operator &`.
+    XMM LessThan(const XMM& b) const { return _mm_cmplt_ps(data_, b.data_); }
+    XMM GreaterThan(const XMM& b) const { return _mm_cmpgt_ps(data_, b.data_); }
+    XMM LessOrEqual(const XMM& b) const { return _mm_cmple_ps(data_, b.data_); }
+    XMM operator &(const XMM& other) const { return _mm_and_ps(data_, other.data_); }
+    // Per component, if either is a NaN `b` is picked.
+    XMM Min(const XMM& b) const { return _mm_min_ps(data_, b.data_); }
+    XMM Max(const XMM& b) const { return _mm_max_ps(data_, b.data_); }
+    // Rounds each component down, the result is still a float.
+    XMM Floor() const { return _mm_floor_ps(data_); }
+
+    // Converts to integers, truncating towards 0.
+    XMM<int32_t> ToIntegers() const;
+    // The same bits, but as integers, no conversion. For masks and bit tricks.
+    XMM<int32_t> AsIntegers() const;
+
+    // Truncates each component to an integer, saturates it to 0-255, and stores the 4 bytes to `b`(no alignment needed).
+    void StoreAsBytes(uint8_t* b) const
+    {
+      __m128i i = _mm_cvttps_epi32(data_);
+      __m128i words = _mm_packus_epi32(i, i);
+      int bytes = _mm_cvtsi128_si32(_mm_packus_epi16(words, words));
+      memcpy(b, &bytes, sizeof (bytes));
+    }
+
+    // Transposes the 4x4 matrix whose rows(or columns, does not matter) are `r0`-`r3`, in place.
+    static void Transpose(XMM& r0, XMM& r1, XMM& r2, XMM& r3)
+    {
+      // [r0x,r0y,r1x,r1y], [r0z,r0w,r1z,r1w], same with r2 and r3.
+      XMM t0 = r0.Shuffle(r1, 0,1,0,1), t1 = r0.Shuffle(r1, 2,3,2,3);
+      XMM t2 = r2.Shuffle(r3, 0,1,0,1), t3 = r2.Shuffle(r3, 2,3,2,3);
+
+      r0 = t0.Shuffle(t2, 0,2,0,2);
+      r1 = t0.Shuffle(t2, 1,3,1,3);
+      r2 = t1.Shuffle(t3, 0,2,0,2);
+      r3 = t1.Shuffle(t3, 1,3,1,3);
+    }
     // The `[3]` component is left in the crossfire, the resulting `[3]` in the returned XMM is `0`.
     XMM CrossProduct(const XMM& other) const
     {
@@ -172,25 +214,32 @@ namespace nogl
     __m128 data_;
   };
 
-  // The very basic stuff for simple setting and getting of YMM integral values. Base for YMM<int,unsigned, etc>
+  // The very basic stuff for simple setting and getting of XMM integral values. Base for XMM<int,unsigned, etc>
   template <typename T>
   class _XMMsi128
   {
     public:
     _XMMsi128() = default;
-    // 8 floats will be loaded. `f` must be aligned to 256 bits, if not, use `LoadUnaligned()`.
-    // If you want 4 floats to be broadcast use `Broadcast4Floats()`.
+    // 16 bytes worth of `T` will be loaded. `f` must be aligned to 128 bits, if not, use `LoadUnaligned()`.
     _XMMsi128(const T* f) { data_ = _mm_load_si128(reinterpret_cast<const __m128i*>(f)); }
-    // Sets all 8 components as `f`.
-    _XMMsi128(T f) { data_ = _mm_set1_epi8(f); }
+    // Sets all the components as `f`.
+    _XMMsi128(T f)
+    {
+      if constexpr (sizeof (T) == 1) data_ = _mm_set1_epi8(f);
+      else if constexpr (sizeof (T) == 2) data_ = _mm_set1_epi16(f);
+      else data_ = _mm_set1_epi32(f);
+    }
 
     void LoadUnaligned(const T* f) { data_ = _mm_loadu_si128(reinterpret_cast<const __m128i*>(f)); }
     // Sets all the components to their equivalent 0 value.
     void ZeroOut() { data_ = _mm_setzero_si128(); }
-    // Stores to 256 ALIGNED 8 float array!
+    // Stores to 128 ALIGNED array!
     void Store(T* f) const { _mm_store_si128(reinterpret_cast<__m128i*>(f), data_); }
     void StoreUnaligned(T* f) const { _mm_storeu_si128(reinterpret_cast<__m128i*>(f), data_); }
 
+    // Whether all the bits are 0, e.g a comparison mask where nothing passed, for early outs.
+    bool IsZero() const { return _mm_testz_si128(data_, data_); }
+
     protected:
     _XMMsi128(__m128i data) { data_ = data; }
 
@@ -202,4 +251,90 @@ namespace nogl
   {
     friend class YMM<uint8_t>;
   };
-}
+
+  // 4 signed 32 bit integers, for edge functions, fixed point math and indices.
+  // Comparisons give masks, all bits set where true, like `XMM<float>`.
+  template <>
+  class XMM<int32_t> : public _XMMsi128<int32_t>
+  {
+    friend class XMM<float>;
+    public:
+    XMM() = default;
+    XMM(const int32_t* f) : _XMMsi128(f) {}
+    XMM(int32_t f) : _XMMsi128(f) {}
+    // AVOID CONFUSION: Parameters are in ltr order, like `XMM<float>`.
+    XMM(int32_t x, int32_t y, int32_t z, int32_t w) { data_ = _mm_setr_epi32(x, y, z, w); }
+
+    // SSE has no gather, so these are 4 scalar loads, `base[indices[i]]` goes to `[i]`.
+    static XMM Gather(const int32_t* base, const XMM& indices)
+    {
+      return _mm_setr_epi32(
+        base[_mm_cvtsi128_si32(indices.data_)], base[_mm_extract_epi32(indices.data_, 1)],
+        base[_mm_extract_epi32(indices.data_, 2)], base[_mm_extract_epi32(indices.data_, 3)]
+      );
+    }
+
+    // Loads 4 unsigned 16 bit integers(no alignment needed), each zero extended into its component.
+    static XMM LoadWidened(const uint16_t* h) { return _mm_cvtepu16_epi32(_mm_loadl_epi64(reinterpret_cast<const __m128i*>(h))); }
+    // Same for signed ones, sign extended.
+    static XMM LoadWidened(const int16_t* h) { return _mm_cvtepi16_epi32(_mm_loadl_epi64(reinterpret_cast<const __m128i*>(h))); }
+
+    int32_t x() const { return _mm_cvtsi128_si32(data_); }
+
+    // Converts to floats, rounding like a normal cast.
+    XMM<float> ToFloats() const;
+    // The same bits, but as floats, no conversion.
+    XMM<float> AsFloats() const;
+
+    // Same as `XMM<float>::Shuffle()`.
+    constexpr XMM Shuffle(const uint8_t x, const uint8_t y, const uint8_t z, const uint8_t w) const { return _mm_shuffle_epi32(data_, _MM_SHUFFLE(w,z,y,x)); }
+    // `[a0,b0,a1,b1]`
+    XMM UnpackLow(const XMM& b) const { return _mm_unpacklo_epi32(data_, b.data_); }
+    // `[a2,b2,a3,b3]`
+    XMM UnpackHigh(const XMM& b) const { return _mm_unpackhi_epi32(data_, b.data_); }
+    // Takes the components of `b` where `mask` is set, keeps ours elsewhere. `mask` must be all or nothing per component(like comparisons give).
+    XMM BlendMasked(const XMM& b, const XMM& mask) const { return _mm_blendv_epi8(data_, b.data_, mask.data_); }
+    // A bit per component, the sign bits, lowest bit is `[0]`.
+    int MoveMask() const { return _mm_movemask_ps(_mm_castsi128_ps(data_)); }
+
+    XMM Min(const XMM& b) const { return _mm_min_epi32(data_, b.data_); }
+    XMM Max(const XMM& b) const { return _mm_max_epi32(data_, b.data_); }
+    XMM Abs() const { return _mm_abs_epi32(data_); }
+
+    XMM Equal(const XMM& b) const { return _mm_cmpeq_epi32(data_, b.data_); }
+    XMM LessThan(const XMM& b) const { return _mm_cmplt_epi32(data_, b.data_); }
+    XMM GreaterThan(const XMM& b) const { return _mm_cmpgt_epi32(data_, b.data_); }
+
+    XMM operator &(const XMM& other) const { return _mm_and_si128(data_, other.data_); }
+    XMM operator |(const XMM& other) const { return _mm_or_si128(data_, other.data_); }
+    XMM operator ^(const XMM& other) const { return _mm_xor_si128(data_, other.data_); }
+    // `*this & ~b`
+    XMM AndNot(const XMM& b) const { return _mm_andnot_si128(b.data_, data_); }
+
+    XMM operator <<(int count) const { return _mm_slli_epi32(data_, count); }
+    // Arithmetic, the sign is kept.
+    XMM operator >>(int count) const { return _mm_srai_epi32(data_, count); }
+    // Logical, shifts in zeros.
+    XMM ShiftRightLogical(int count) const { return _mm_srli_epi32(data_, count); }
+
+    XMM operator +(const XMM& other) const { return _mm_add_epi32(data_, other.data_); }
+    XMM& operator +=(const XMM& other) { data_ = _mm_add_epi32(data_, other.data_); return *this; }
+
+    XMM operator -(const XMM& other) const { return _mm_sub_epi32(data_, other.data_); }
+    XMM& operator -=(const XMM& other) { data_ = _mm_sub_epi32(data_, other.data_); return *this; }
+
+    // The low 32 bits of the products.
+    XMM operator *(const XMM& other) const { return _mm_mullo_epi32(data_, other.data_); }
+    XMM& operator *=(const XMM& other) { data_ = _mm_mullo_epi32(data_, other.data_); return *this; }
+
+    XMM operator -() const { return _mm_sub_epi32(_mm_setzero_si128(), data_); }
+
+    private:
+    XMM(__m128i data) : _XMMsi128(data) {}
+  };
+
+  inline XMM<float> XMM<int32_t>::ToFloats() const { return _mm_cvtepi32_ps(data_); }
+  inline XMM<float> XMM<int32_t>::AsFloats() const { return _mm_castsi128_ps(data_); }
+  inline XMM<int32_t> XMM<float>::ToIntegers() const { return _mm_cvttps_epi32(data_); }
+  inline XMM<int32_t> XMM<float>::AsIntegers() const { return _mm_castps_si128(data_); }
+}
\ No newline at end of file
@@ -21,6 +21,7 @@ namespace nogl
   template <>
   class YMM<float>
   {
+    friend class YMM<int32_t>;
     public:
     YMM() = default;
     // Broadcasts `xmm` into both 128 bit lanes of the YMM.
@@ -76,6 +77,8 @@ namespace nogl
     }
     // Broadcasts 4 128 BITS ALIGNED floats.
     void Broadcast4Floats(const float* f) { data_ = _mm256_broadcast_ps(reinterpret_cast<const __m128*>(f)); }
+    // Loads 4 128 BITS ALIGNED floats from `low` into the low lane, and 4 from `high` into the high lane.
+    void Load4Floats(const float* low, const float* high) { data_ = _mm256_insertf128_ps(_mm256_castps128_ps256(_mm_load_ps(low)), _mm_load_ps(high), 1); }
     void LoadUnaligned(const float* f) { data_ = _mm256_loadu_ps(f); }
     // Sets all the components to their equivalent 0 value.
     void ZeroOut() { data_ = _mm256_setzero_ps(); }
@@ -90,6 +93,54 @@ namespace nogl
     constexpr YMM Shuffle(uint8_t x, uint8_t y, uint8_t z, uint8_t w) const { return _mm256_shuffle_ps(data_, data_, _MM_SHUFFLE(w,z,y,x)); }
     // Blending is like inserting but it doesn't actually take one element from the `b`, rather it takes the corresponding element from `b` specified by whether the bits are `1`(copy) or `0`(ignore). Note that the lowest bit is the first element of the first lane, highest is the last element of the second lane.
     constexpr YMM Blend(const YMM& b, const int mask) const { return _mm256_blend_ps(data_, b.data_, mask); }
+    // Interleaves the low halves of each lane, `[a0,b0,a1,b1 , a4,b4,a5,b5]`.
+    constexpr YMM UnpackLow(const YMM& b) const { return _mm256_unpacklo_ps(data_, b.data_); }
+    // Interleaves the high halves of each lane, `[a2,b2,a3,b3 , a6,b6,a7,b7]`.
+    constexpr YMM UnpackHigh(const YMM& b) const { return _mm256_unpackhi_ps(data_, b.data_); }
+    // Picks whole lanes from `*this`(0 low, 1 high) and `b`(2 low, 3 high), `low` goes to the low lane and `high` to the high lane.
+    constexpr YMM PermuteLanes(const YMM& b, const uint8_t low, const uint8_t high) const { return _mm256_permute2f128_ps(data_, b.data_, low | (high << 4)); }
+
+    // Fused `*this * b + c`, one rounding and one instruction.
+    YMM MultiplyAdd(const YMM& b, const YMM& c) const { return _mm256_fmadd_ps(data_, b.data_, c.data_); }
+    // Approximate 1/x, relative error is at most 1.5*2^-12, refine with a Newton-Raphson step if you need more.
+    YMM Reciprocal() const { return _mm256_rcp_ps(data_); }
+    // Approximate 1/sqrt(x), same error as `Reciprocal()`.
+    YMM ISquareRoot() const { return _mm256_rsqrt_ps(data_); }
+
+    // Per component masks, all bits set where the comparison is true, 0 where it's false. Combine with `operator &`.
+    YMM LessThan(const YMM& b) const { return _mm256_cmp_ps(data_, b.data_, _CMP_LT_OQ); }
+    YMM GreaterThan(const YMM& b) const { return _mm256_cmp_ps(data_, b.data_, _CMP_GT_OQ); }
+    YMM LessOrEqual(const YMM& b) const { return _mm256_cmp_ps(data_, b.data_, _CMP_LE_OQ); }
+    YMM operator &(const YMM& other) const { return _mm256_and_ps(data_, other.data_); }
+    // Per component, if either is a NaN `b` is picked.
+    YMM Min(const YMM& b) const { return _mm256_min_ps(data_, b.data_); }
+    YMM Max(const YMM& b) const { return _mm256_max_ps(data_, b.data_); }
+    // Rounds each component down, the result is still a float.
+    YMM Floor() const { return _mm256_floor_ps(data_); }
+
+    // Converts to integers, truncating towards 0.
+    YMM<int32_t> ToIntegers() const;
+    // The same bits, but as integers, no conversion. For masks and bit tricks.
+    YMM<int32_t> AsIntegers() const;
+    // Only loads the components whose `mask` is set, the rest are 0, and their memory is not touched(so it can be past the end of an array).
+    static YMM LoadMasked(const float* f, const YMM<int32_t>& mask);
+    // Only stores the components whose `mask` is set, see `LoadMasked()`.
+    void StoreMasked(float* f, const YMM<int32_t>& mask) const;
+    // `base[indices[i]]` goes to `[i]`, like `YMM<int32_t>::Gather()`.
+    static YMM Gather(const float* base, const YMM<int32_t>& indices);
+
+    // Truncates each component to an integer, saturates it to 0-255, and stores the 8 bytes to `b`(no alignment needed).
+    void StoreAsBytes(uint8_t* b) const
+    {
+      __m256i i = _mm256_cvttps_epi32(data_);
+      __m128i words = _mm_packus_epi32(_mm256_castsi256_si128(i), _mm256_extracti128_si256(i, 1));
+      _mm_storel_epi64(reinterpret_cast<__m128i*>(b), _mm_packus_epi16(words, words));
+    }
+
+    // Loads 8 half precision floats from `h`(aligned to 128 bits), F16C does the conversion.
+    static YMM LoadHalves(const uint16_t* h) { return _mm256_cvtph_ps(_mm_load_si128(reinterpret_cast<const __m128i*>(h))); }
+    // Rounds each component to the nearest half precision float, and stores the 8 of them to `h`(aligned to 128 bits).
+    void StoreAsHalves(uint16_t* h) const { _mm_store_si128(reinterpret_cast<__m128i*>(h), _mm256_cvtps_ph(data_, _MM_FROUND_TO_NEAREST_INT)); }
 
     // Multiplies 2 quaternions stored in this YMM, with the 2 quaternions stored in `b`. Same as `XMM::QMultiply()` but optimized to perform multiplication in bulk.
     YMM QMultiply(const YMM& b) const;
@@ -160,19 +211,26 @@ namespace nogl
   {
     public:
     _YMMsi256() = default;
-    // 8 floats will be loaded. `f` must be aligned to 256 bits, if not, use `LoadUnaligned()`.
-    // If you want 4 floats to be broadcast use `Broadcast4Floats()`.
+    // 32 bytes worth of `T` will be loaded. `f` must be aligned to 256 bits, if not, use `LoadUnaligned()`.
     _YMMsi256(const T* f) { data_ = _mm256_load_si256(reinterpret_cast<const __m256i*>(f)); }
-    // Sets all 8 components as `f`.
-    _YMMsi256(T f) { data_ = _mm256_set1_epi8(f); }
+    // Sets all the components as `f`.
+    _YMMsi256(T f)
+    {
+      if constexpr (sizeof (T) == 1) data_ = _mm256_set1_epi8(f);
+      else if constexpr (sizeof (T) == 2) data_ = _mm256_set1_epi16(f);
+      else data_ = _mm256_set1_epi32(f);
+    }
 
     void LoadUnaligned(const T* f) { data_ = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(f)); }
     // Sets all the components to their equivalent 0 value.
     void ZeroOut() { data_ = _mm256_setzero_si256(); }
-    // Stores to 256 ALIGNED 8 float array!
+    // Stores to 256 ALIGNED array!
     void Store(T* f) const { _mm256_store_si256(reinterpret_cast<__m256i*>(f), data_); }
     void StoreUnaligned(T* f) const { _mm256_storeu_si256(reinterpret_cast<__m256i*>(f), data_); }
 
+    // Whether all the bits are 0, e.g a comparison mask where nothing passed, for early outs.
+    bool IsZero() const { return _mm256_testz_si256(data_, data_); }
+
     protected:
     _YMMsi256(__m256i data) { data_ = data; }
 
@@ -181,5 +239,180 @@ namespace nogl
 
   template <>
   class YMM<uint8_t> : public _YMMsi256<uint8_t>
-  {};
-}
\ No newline at end of file
+  {
+    friend class YMM<uint16_t>;
+    public:
+    YMM() = default;
+    YMM(const uint8_t* f) : _YMMsi256(f) {}
+    YMM(uint8_t f) : _YMMsi256(f) {}
+
+    private:
+    YMM(__m256i data) : _YMMsi256(data) {}
+  };
+
+  // 16 unsigned 16 bit integers, what 8 bit pixel components are widened to, so they can be multiplied without overflowing.
+  // NOTE: Like most AVX2 integer instructions the packs and unpacks work per 128 bit lane, they undo each other, but the order in between is per lane.
+  template <>
+  class YMM<uint16_t> : public _YMMsi256<uint16_t>
+  {
+    friend class YMM<int32_t>;
+    public:
+    YMM() = default;
+    YMM(const uint16_t* f) : _YMMsi256(f) {}
+    YMM(uint16_t f) : _YMMsi256(f) {}
+
+    // Zero extends the low 8 bytes of each lane of `b`, `PackUnsigned()` undoes it.
+    static YMM UnpackBytesLow(const YMM<uint8_t>& b) { return _mm256_unpacklo_epi8(b.data_, _mm256_setzero_si256()); }
+    // Zero extends the high 8 bytes of each lane of `b`.
+    static YMM UnpackBytesHigh(const YMM<uint8_t>& b) { return _mm256_unpackhi_epi8(b.data_, _mm256_setzero_si256()); }
+    // Saturates `*this` and `b` to 0-255 and packs them into bytes, per lane `*this` goes first.
+    YMM<uint8_t> PackUnsigned(const YMM& b) const { return _mm256_packus_epi16(data_, b.data_); }
+
+    // Picks bytes by `indices` within each lane, `-1`(any negative) gives 0. For broadcasting components, e.g a pixel's alpha.
+    YMM ShuffleBytes(const YMM<uint8_t>& indices) const { return _mm256_shuffle_epi8(data_, indices.data_); }
+    // Same as `YMM<float>::Blend()`, but `mask` has 8 bits that are applied to both lanes.
+    constexpr YMM Blend(const YMM& b, const int mask) const { return _mm256_blend_epi16(data_, b.data_, mask); }
+    // Takes the components of `b` where `mask` is set, keeps ours elsewhere. `mask` must be all or nothing per component(like comparisons give).
+    YMM BlendMasked(const YMM& b, const YMM& mask) const { return _mm256_blendv_epi8(data_, b.data_, mask.data_); }
+
+    YMM Min(const YMM& b) const { return _mm256_min_epu16(data_, b.data_); }
+    YMM Max(const YMM& b) const { return _mm256_max_epu16(data_, b.data_); }
+    // Rounded up `(a + b) / 2`.
+    YMM Average(const YMM& b) const { return _mm256_avg_epu16(data_, b.data_); }
+
+    YMM Equal(const YMM& b) const { return _mm256_cmpeq_epi16(data_, b.data_); }
+    // There is no unsigned comparison, flipping the sign bits makes the signed one give the same answer.
+    YMM GreaterThan(const YMM& b) const
+    {
+      __m256i sign = _mm256_set1_epi16(static_cast<short>(0x8000));
+      return _mm256_cmpgt_epi16(_mm256_xor_si256(data_, sign), _mm256_xor_si256(b.data_, sign));
+    }
+    YMM LessThan(const YMM& b) const { return b.GreaterThan(*this); }
+
+    // Exact `*this / 255`(truncated) for components up to 255*255, without a division. What blending 8 bit components needs.
+    YMM Divide255() const
+    {
+      return _mm256_srli_epi16(_mm256_add_epi16(_mm256_add_epi16(data_, _mm256_set1_epi16(1)), _mm256_srli_epi16(data_, 8)), 8);
+    }
+
+    YMM operator &(const YMM& other) const { return _mm256_and_si256(data_, other.data_); }
+    YMM operator |(const YMM& other) const { return _mm256_or_si256(data_, other.data_); }
+    YMM operator ^(const YMM& other) const { return _mm256_xor_si256(data_, other.data_); }
+    // `*this & ~b`
+    YMM AndNot(const YMM& b) const { return _mm256_andnot_si256(b.data_, data_); }
+
+    YMM operator <<(int count) const { return _mm256_slli_epi16(data_, count); }
+    // Logical, shifts in zeros.
+    YMM operator >>(int count) const { return _mm256_srli_epi16(data_, count); }
+
+    // Wraps around, see `AddSaturated()`.
+    YMM operator +(const YMM& other) const { return _mm256_add_epi16(data_, other.data_); }
+    YMM& operator +=(const YMM& other) { data_ = _mm256_add_epi16(data_, other.data_); return *this; }
+    // Clamps to 65535 instead of wrapping.
+    YMM AddSaturated(const YMM& b) const { return _mm256_adds_epu16(data_, b.data_); }
+
+    YMM operator -(const YMM& other) const { return _mm256_sub_epi16(data_, other.data_); }
+    YMM& operator -=(const YMM& other) { data_ = _mm256_sub_epi16(data_, other.data_); return *this; }
+    // Clamps to 0 instead of wrapping.
+    YMM SubtractSaturated(const YMM& b) const { return _mm256_subs_epu16(data_, b.data_); }
+
+    // The low 16 bits of the products.
+    YMM operator *(const YMM& other) const { return _mm256_mullo_epi16(data_, other.data_); }
+    YMM& operator *=(const YMM& other) { data_ = _mm256_mullo_epi16(data_, other.data_); return *this; }
+    // The high 16 bits of the products, for 0.16 fixed point.
+    YMM MultiplyHigh(const YMM& b) const { return _mm256_mulhi_epu16(data_, b.data_); }
+
+    private:
+    YMM(__m256i data) : _YMMsi256(data) {}
+  };
+
+  // 8 signed 32 bit integers, for edge functions, fixed point depth and indices.
+  // Comparisons give masks, all bits set where true, like `YMM<float>`.
+  template <>
+  class YMM<int32_t> : public _YMMsi256<int32_t>
+  {
+    friend class YMM<float>;
+    public:
+    YMM() = default;
+    YMM(const int32_t* f) : _YMMsi256(f) {}
+    YMM(int32_t f) : _YMMsi256(f) {}
+    // AVOID CONFUSION: Parameters are in ltr order, like `YMM<float>`.
+    YMM(int32_t x, int32_t y, int32_t z, int32_t w, int32_t x1, int32_t y1, int32_t z1, int32_t w1) { data_ = _mm256_setr_epi32(x, y, z, w, x1, y1, z1, w1); }
+
+    // Loads 8 signed 16 bit integers from `h`(aligned to 128 bits), each sign extended into its component.
+    static YMM LoadWidened(const int16_t* h) { return _mm256_cvtepi16_epi32(_mm_load_si128(reinterpret_cast<const __m128i*>(h))); }
+    // Same but unsigned, zero extended.
+    static YMM LoadWidened(const uint16_t* h) { return _mm256_cvtepu16_epi32(_mm_load_si128(reinterpret_cast<const __m128i*>(h))); }
+    // `base[indices[i]]` goes to `[i]`, 8 loads in one instruction, they can be anywhere.
+    static YMM Gather(const int32_t* base, const YMM& indices) { return _mm256_i32gather_epi32(reinterpret_cast<const int*>(base), indices.data_, sizeof (int32_t)); }
+    // Only loads the components whose `mask` is set, the rest are 0, and their memory is not touched(so it can be past the end of an array).
+    static YMM LoadMasked(const int32_t* f, const YMM& mask) { return _mm256_maskload_epi32(reinterpret_cast<const int*>(f), mask.data_); }
+    // Only stores the components whose `mask` is set, see `LoadMasked()`.
+    void StoreMasked(int32_t* f, const YMM& mask) const { _mm256_maskstore_epi32(reinterpret_cast<int*>(f), mask.data_, data_); }
+
+    // Converts to floats, rounding like a normal cast.
+    YMM<float> ToFloats() const;
+    // The same bits, but as floats, no conversion.
+    YMM<float> AsFloats() const;
+    // Saturates `*this` and `b` to 0-65535 and packs them, per lane `*this` goes first.
+    YMM<uint16_t> PackUnsigned(const YMM& b) const { return _mm256_packus_epi32(data_, b.data_); }
+
+    // `[a0,b0,a1,b1 , a4,b4,a5,b5]`
+    YMM UnpackLow(const YMM& b) const { return _mm256_unpacklo_epi32(data_, b.data_); }
+    // `[a2,b2,a3,b3 , a6,b6,a7,b7]`
+    YMM UnpackHigh(const YMM& b) const { return _mm256_unpackhi_epi32(data_, b.data_); }
+    // Same as `YMM<float>::Blend()`.
+    constexpr YMM Blend(const YMM& b, const int mask) const { return _mm256_blend_epi32(data_, b.data_, mask); }
+    // Takes the components of `b` where `mask` is set, keeps ours elsewhere. `mask` must be all or nothing per component(like comparisons give).
+    YMM BlendMasked(const YMM& b, const YMM& mask) const { return _mm256_blendv_epi8(data_, b.data_, mask.data_); }
+    // A bit per component, the sign bits, lowest bit is `[0]`.
+    int MoveMask() const { return _mm256_movemask_ps(_mm256_castsi256_ps(data_)); }
+
+    YMM Min(const YMM& b) const { return _mm256_min_epi32(data_, b.data_); }
+    YMM Max(const YMM& b) const { return _mm256_max_epi32(data_, b.data_); }
+    YMM Abs() const { return _mm256_abs_epi32(data_); }
+
+    YMM Equal(const YMM& b) const { return _mm256_cmpeq_epi32(data_, b.data_); }
+    YMM LessThan(const YMM& b) const { return _mm256_cmpgt_epi32(b.data_, data_); }
+    YMM GreaterThan(const YMM& b) const { return _mm256_cmpgt_epi32(data_, b.data_); }
+
+    YMM operator &(const YMM& other) const { return _mm256_and_si256(data_, other.data_); }
+    YMM operator |(const YMM& other) const { return _mm256_or_si256(data_, other.data_); }
+    YMM operator ^(const YMM& other) const { return _mm256_xor_si256(data_, other.data_); }
+    // `*this & ~b`
+    YMM AndNot(const YMM& b) const { return _mm256_andnot_si256(b.data_, data_); }
+
+    YMM operator <<(int count) const { return _mm256_slli_epi32(data_, count); }
+    // Arithmetic, the sign is kept.
+    YMM operator >>(int count) const { return _mm256_srai_epi32(data_, count); }
+    // Logical, shifts in zeros.
+    YMM ShiftRightLogical(int count) const { return _mm256_srli_epi32(data_, count); }
+    // Every component by its own count.
+    YMM operator <<(const YMM& counts) const { return _mm256_sllv_epi32(data_, counts.data_); }
+    YMM operator >>(const YMM& counts) const { return _mm256_srav_epi32(data_, counts.data_); }
+    YMM ShiftRightLogical(const YMM& counts) const { return _mm256_srlv_epi32(data_, counts.data_); }
+
+    YMM operator +(const YMM& other) const { return _mm256_add_epi32(data_, other.data_); }
+    YMM& operator +=(const YMM& other) { data_ = _mm256_add_epi32(data_, other.data_); return *this; }
+
+    YMM operator -(const YMM& other) const { return _mm256_sub_epi32(data_, other.data_); }
+    YMM& operator -=(const YMM& other) { data_ = _mm256_sub_epi32(data_, other.data_); return *this; }
+
+    // The low 32 bits of the products.
+    YMM operator *(const YMM& other) const { return _mm256_mullo_epi32(data_, other.data_); }
+    YMM& operator *=(const YMM& other) { data_ = _mm256_mullo_epi32(data_, other.data_); return *this; }
+
+    YMM operator -() const { return _mm256_sub_epi32(_mm256_setzero_si256(), data_); }
+
+    private:
+    YMM(__m256i data) : _YMMsi256(data) {}
+  };
+
+  inline YMM<float> YMM<int32_t>::ToFloats() const { return _mm256_cvtepi32_ps(data_); }
+  inline YMM<float> YMM<int32_t>::AsFloats() const { return _mm256_castsi256_ps(data_); }
+  inline YMM<int32_t> YMM<float>::ToIntegers() const { return _mm256_cvttps_epi32(data_); }
+  inline YMM<int32_t> YMM<float>::AsIntegers() const { return _mm256_castps_si256(data_); }
+  inline YMM<float> YMM<float>::LoadMasked(const float* f, const YMM<int32_t>& mask) { return _mm256_maskload_ps(f, mask.data_); }
+  inline void YMM<float>::StoreMasked(float* f, const YMM<int32_t>& mask) const { _mm256_maskstore_ps(f, mask.data_, data_); }
+  inline YMM<float> YMM<float>::Gather(const float* base, const YMM<int32_t>& indices) { return _mm256_i32gather_ps(base, indices.data_, sizeof (float)); }
+}
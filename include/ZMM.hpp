@@ -0,0 +1,85 @@
+#pragma once
+
+#include "YMM.hpp"
+
+#include <immintrin.h>
+
+#include <cstdint>
+
+namespace nogl
+{
+  // A very lightweight wrapper for __m512, the AVX-512 sibling of `YMM`.
+  // Only ever use it in code compiled for AVX-512(the `Simd::Level::kAVX512` kernels), touching it anywhere else crashes on most CPUs.
+  // There are 32 of these on x64, but they share the register file with YMM and XMM.
+  template <typename T>
+  class ZMM
+  {};
+
+  template <>
+  class ZMM<float>
+  {
+    public:
+    ZMM() = default;
+    // 16 floats will be loaded. `f` must be aligned to 512 bits, if not, use `LoadUnaligned()`.
+    ZMM(const float* f) { data_ = _mm512_load_ps(f); }
+    // Sets all 16 components as `f`.
+    ZMM(float f) { data_ = _mm512_set1_ps(f); }
+
+    ~ZMM() = default;
+
+    // Loads 16 half precision floats from `h`(aligned to 256 bits) and converts them.
+    // Zero masked, like `Reciprocal()`, since GCC warns about the undefined register the plain one starts from.
+    static ZMM LoadHalves(const uint16_t* h) { return _mm512_maskz_cvtph_ps(0xFFFF, _mm256_load_si256(reinterpret_cast<const __m256i*>(h))); }
+    // Loads 16 signed 16 bit integers from `i`(aligned to 256 bits) and converts them.
+    // Zero masked for the same reason.
+    static ZMM LoadIntegers(const int16_t* i) { return _mm512_maskz_cvtepi32_ps(0xFFFF, _mm512_maskz_cvtepi16_epi32(0xFFFF, _mm256_load_si256(reinterpret_cast<const __m256i*>(i)))); }
+
+    void LoadUnaligned(const float* f) { data_ = _mm512_loadu_ps(f); }
+    // Sets all the components to their equivalent 0 value.
+    void ZeroOut() { data_ = _mm512_setzero_ps(); }
+    // Stores to 512 ALIGNED 16 float array!
+    void Store(float* f) const { _mm512_store_ps(f, data_); }
+    void StoreUnaligned(float* f) const { _mm512_storeu_ps(f, data_); }
+    // Only stores the components whose bit in `mask` is set, the rest of `f` is not touched(not even read, so it can be past the end of an array).
+    void StoreMasked(float* f, uint16_t mask) const { _mm512_mask_storeu_ps(f, mask, data_); }
+
+    // Picks from the 32 components of [*this, b], component `i` of the result is the `indices[i]`-th. Indices 16-31 are `b`'s.
+    ZMM PermuteTwo(const ZMM& b, const int32_t indices[16]) const
+    {
+      return _mm512_permutex2var_ps(data_, _mm512_loadu_si512(indices), b.data_);
+    }
+
+    // Fused `*this * b + c`, one rounding and one instruction.
+    ZMM MultiplyAdd(const ZMM& b, const ZMM& c) const { return _mm512_fmadd_ps(data_, b.data_, c.data_); }
+    // Approximate 1/x, relative error is at most 2^-14, refine with a Newton-Raphson step if you need more.
+    // NOTE: The zero masked version because GCC warns about the undefined register the plain `_mm512_rcp14_ps()` starts from.
+    ZMM Reciprocal() const { return _mm512_maskz_rcp14_ps(0xFFFF, data_); }
+    // Approximate 1/sqrt(x), same error as `Reciprocal()`, and zero masked for the same reason.
+    ZMM ISquareRoot() const { return _mm512_maskz_rsqrt14_ps(0xFFFF, data_); }
+    // Keeps the components whose bit in `mask` is set, the rest become 0.
+    ZMM ZeroMasked(uint16_t mask) const { return _mm512_maskz_mov_ps(mask, data_); }
+
+    // Unlike `YMM` comparisons give a bit per component rather than a full mask, AVX-512 has actual mask registers.
+    uint16_t LessThan(const ZMM& b) const { return _mm512_cmp_ps_mask(data_, b.data_, _CMP_LT_OQ); }
+    uint16_t GreaterThan(const ZMM& b) const { return _mm512_cmp_ps_mask(data_, b.data_, _CMP_GT_OQ); }
+
+    ZMM operator +(const ZMM& other) const { return _mm512_add_ps(data_, other.data_); }
+    ZMM& operator +=(const ZMM& other) { data_ = _mm512_add_ps(data_, other.data_); return *this; }
+
+    ZMM operator -(const ZMM& other) const { return _mm512_sub_ps(data_, other.data_); }
+    ZMM& operator -=(const ZMM& other) { data_ = _mm512_sub_ps(data_, other.data_); return *this; }
+
+    ZMM operator *(const ZMM& other) const { return _mm512_mul_ps(data_, other.data_); }
+    ZMM& operator *=(const ZMM& other) { data_ = _mm512_mul_ps(data_, other.data_); return *this; }
+
+    ZMM operator /(const ZMM& other) const { return _mm512_div_ps(data_, other.data_); }
+    ZMM& operator /=(const ZMM& other) { data_ = _mm512_div_ps(data_, other.data_); return *this; }
+
+    ZMM operator -() const { return _mm512_sub_ps(_mm512_setzero_ps(), data_); }
+
+    private:
+    ZMM(__m512 data) { data_ = data; }
+
+    __m512 data_;
+  };
+}
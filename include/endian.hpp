@@ -72,27 +72,27 @@ namespace nogl
 
   static inline std::int16_t BigE(std::int16_t _x)
   {
-    return BigE(_x);
+    return static_cast<std::int16_t>(BigE(static_cast<std::uint16_t>(_x)));
   }
   static inline std::int32_t BigE(std::int32_t _x)
   {
-    return BigE(_x);
+    return static_cast<std::int32_t>(BigE(static_cast<std::uint32_t>(_x)));
   }
   static inline std::int64_t BigE(std::int64_t _x)
   {
-    return BigE(_x);
+    return static_cast<std::int64_t>(BigE(static_cast<std::uint64_t>(_x)));
   }
 
   static inline std::int16_t LilE(std::int16_t _x)
   {
-    return LilE(_x);
+    return static_cast<std::int16_t>(LilE(static_cast<std::uint16_t>(_x)));
   }
   static inline std::int32_t LilE(std::int32_t _x)
   {
-    return LilE(_x);
+    return static_cast<std::int32_t>(LilE(static_cast<std::uint32_t>(_x)));
   }
   static inline std::int64_t LilE(std::int64_t _x)
   {
-    return LilE(_x);
+    return static_cast<std::int64_t>(LilE(static_cast<std::uint64_t>(_x)));
   }
 }
@@ -4,32 +4,49 @@
 #include "Exception.hpp"
 
 #include "XMM.hpp"
-#include "YMM.hpp"
+#include "Simd.hpp"
 
 // Various intel intrinsics for SIMD instructions, both AVX, and SSE
 #include <immintrin.h>
 
 #include <new>
 #include <memory>
+#include <algorithm>
 
 namespace nogl
 {
   class VOV4;
+  class SOV4;
+  class SOVH;
+  class SOVQ;
   class V4;
   class Q4;
+  class AABB;
+  class Sphere;
+  class Frustum;
+  class Skin;
 
   class alignas(32) M4x4
   {
     friend VOV4;
+    friend SOV4;
+    friend SOVH;
+    friend SOVQ;
     friend V4;
+    friend AABB;
+    friend Sphere;
+    friend Frustum;
+    friend Skin;
 
     public:
     M4x4()
     {
-      YMM<float> zero;
+      XMM<float> zero;
       zero.ZeroOut();
       zero.Store(p_[0]);
+      zero.Store(p_[1]);
       zero.Store(p_[2]);
+      zero.Store(p_[3]);
     }
 
     // While the construction is intuitive, the array is just a flattened array of the matrix,
@@ -48,6 +65,26 @@ namespace nogl
 
     // Gets column, then the second [] gets row.
     float* operator [](unsigned i) { return p_[i]; }
+    const float* operator [](unsigned i) const { return p_[i]; }
+
+    static M4x4 Identity() noexcept;
+    // Translation x Rotation x Scale, so scale is applied first, and translation last, the usual model matrix.
+    // The W components of `translation` and `scale` are ignored, `rotation` must be a unit quaternion.
+    static M4x4 Compose(const V4& translation, const Q4& rotation, const V4& scale) noexcept;
+
+    // `*this` x `b`, so if the result is applied to a vector, `b` is applied first and `*this` after.
+    M4x4 operator *(const M4x4& b) const noexcept;
+    void operator *=(const M4x4& b) noexcept { *this = *this * b; }
+
+    M4x4 Transposed() const noexcept;
+    // Only for matrices whose last row is [0,0,0,1], so translations, rotations, scales and shears, like the ones `Compose()` makes.
+    // Way cheaper than `Inverse()`, use it for model and view matrices.
+    M4x4 InverseAffine() const noexcept;
+    // Works for anything invertible(like projections), singular matrices give infinities.
+    M4x4 Inverse() const noexcept;
+    // The inverse transpose, what normals are transformed by so they stay perpendicular under non-uniform scales, see `VOV4::MultiplyNormals()`.
+    // Affine only, like `InverseAffine()`.
+    M4x4 NormalMatrix() const noexcept { return InverseAffine().Transposed(); }
 
     private:
     // First dimension is the columns(x), second is the individual rows(y). It does wonders to SIMD.
@@ -58,6 +95,14 @@ namespace nogl
   class alignas(XMM<float>) V4
   {
     friend VOV4;
+    friend SOV4;
+    friend SOVH;
+    friend SOVQ;
+    friend M4x4;
+    friend AABB;
+    friend Sphere;
+    friend Frustum;
+    friend Skin;
 
     public:
   
@@ -65,6 +110,8 @@ namespace nogl
     // `p` must be 4 floats in size.
     V4(const float p[4]) { *this = p; }
     V4(const V4& other) { XMM<float>(other.p_).Store(p_); }
+    // Declared, since with a user copy constructor the implicit one is deprecated.
+    V4& operator=(const V4&) = default;
     V4(float x, float y, float z)
     {
       XMM<float>(x, y, z, 0).Store(p_);
@@ -165,6 +212,8 @@ namespace nogl
       a.CrossProduct(b).Store(p_);
     }
 
+    // `mask` picks the components the magnitude is of, like `magnitude()`, but all 4 are divided by it.
+    // The reciprocal square root gets a Newton-Raphson step, so it's ~22 bits rather than ~12.
     void Normalize(int mask) noexcept;
     
     // Normalizes the vector using its 4 components, but if you only want to use the 3 components use `Normalize3()`. If you know for sure that W component is 0 then you can call this, it will be slightly faster.
@@ -205,9 +254,26 @@ namespace nogl
   // Vector Of Vectors(4 dimensional)
   class VOV4
   {
+    friend SOV4;
+    friend SOVH;
+    friend SOVQ;
+
     public:
 
-    static constexpr unsigned kAlign = sizeof(YMM<float>); // Using the 256-bit AVX/SSE SIMD
+    static constexpr unsigned kAlign = 64; // Enough for the 512-bit AVX-512 kernels, see `Simd`
+    // How many vectors the widest kernels(like `Project()`) process at once, the buffer is padded to it.
+    static constexpr unsigned kBatch = kAlign / sizeof(float);
+
+    // Bits of the outcodes `Project()` writes, which clip planes a vector is outside of.
+    enum Outcode : uint8_t
+    {
+      kOutLeft = 1 << 0,
+      kOutRight = 1 << 1,
+      kOutTop = 1 << 2,
+      kOutBottom = 1 << 3,
+      kOutNear = 1 << 4,
+      kOutFar = 1 << 5,
+    };
 
     // n is the number of the vectors.
     VOV4(unsigned n = 0)
@@ -233,39 +299,30 @@ namespace nogl
     // Set every single vector, and every one of its components to `f`.
     void operator =(float f) noexcept
     {
-      YMM<float> filler = f;
-      for (V4* ptr = begin(); ptr < end(); ptr += (kAlign / sizeof(V4)))
-      {
-        filler.Store(ptr->p_);
-      }
+      Simd::kernels().fill_float(buffer_.get()->p_, f, n_ * 4);
     }
     // Assume f is the size of `4*n()`, so it contains all the vectors necessary flattened into an array.
     void operator =(float* f) noexcept
     {
-      for (V4* ptr = begin(); ptr < end(); ptr += (kAlign / sizeof(V4)))
+      for (V4* ptr = begin(); ptr < end(); ++ptr, f += 4)
       {
-        YMM<float>(f).Store(ptr->p_);
+        XMM<float>(f).Store(ptr->p_);
       }
     }
     void operator =(const V4& v) noexcept
     {
-      // __m128 v128 = _mm_load_ps(v.p_);
-      // __m256 v256 = reinterpret_cast<__m256>(
-      //   _mm256_broadcastsi128_si256(reinterpret_cast<__m128i>(v128))
-      // );
-      YMM<float> v256;
-      v256.Broadcast4Floats(v.p_);
-      for (V4* ptr = begin(); ptr < end(); ptr += (kAlign / sizeof(V4)))
+      XMM<float> v128(v.p_);
+      for (V4* ptr = begin(); ptr < end(); ++ptr)
       {
-        v256.Store(ptr->p_);
+        v128.Store(ptr->p_);
       }
     }
     // Copies vectors from `other` to `this`, the number of vectors is whoever has a smaller `n`.
     void operator =(const VOV4& other) noexcept
     {
-      for (unsigned off = 0; off < std::min(n_, other.n_); off += (kAlign / sizeof (V4)))
+      for (unsigned off = 0; off < std::min(n_, other.n_); ++off)
       {
-        YMM<float>(other.buffer_[off].p_).Store(buffer_[off].p_);
+        XMM<float>(other.buffer_[off].p_).Store(buffer_[off].p_);
       }
     }
 
@@ -273,22 +330,59 @@ namespace nogl
     
     // Multiplies all vectors by `matrix`(as if our vectors are 1x4 matrices), stores results in `output`(can be `*this`).
     // From `from` up to `to`(exclusive).
-    // Huge note: The address in bytes of `from` & `to` must be aligned to `kAlign`.
+    // Huge note: `from` must be a multiple of `kBatch`, `to` may be anything up to `n()`.
     void Multiply(VOV4& output, const M4x4& m, unsigned from, unsigned to) noexcept;
     
     // Divides each vector by its own W component, stores results in `output`(can be `*this`).
     void DivideByW(VOV4& output, unsigned from, unsigned to);
 
+    // `Multiply()` by the camera matrix `m` and the perspective divide fused into one pass, so the projected vectors are written just once.
+    // `output` gets [x/w, y/w, z/w, 1/w], `outcodes` gets the `Outcode` bits of each vector, computed in clip space against a `width`x`height` viewport.
+    // `outcodes` must be padded like the buffer, to `kBatch`.
+    // Huge note: `from` must be a multiple of `kBatch`, `to` may be anything up to `n()`.
+    void Project(VOV4& output, uint8_t* outcodes, const M4x4& m, float width, float height, unsigned from, unsigned to) const noexcept;
+
     // Adds all vectors with `v`, stores results in `output`(can be `*this`).
     // From `from` up to `to`(exclusive).
-    // Huge note: The address in bytes of `from` & `to` must be aligned to `kAlign`.
+    // Huge note: `from` must be a multiple of `kBatch`, `to` may be anything up to `n()`.
     void Add(VOV4& output, const V4& v, unsigned from, unsigned to);
     // Same as `Add()` for V4, refers to `v` as if it's `V4::p()`.
     // void Add(VOV4& output, const float v[4], unsigned from, unsigned to);
+    // Adds `v[i]` scaled by `s` to each vector, one fused multiply-add per component, stores results in `output`(can be `*this`).
+    // Huge note: `from` must be a multiple of `kBatch`, `to` may be anything up to `n()`.
+    void AddScaled(VOV4& output, const VOV4& v, float s, unsigned from, unsigned to) const noexcept;
+    // Sparse `AddScaled()`, only the vectors at `indices` change, vector `indices[i]` gets `v[i]` scaled by `s`. `from` and `to` are indices into `indices` and `v`, any range works.
+    void ScatterAddScaled(const unsigned* indices, const VOV4& v, float s, unsigned from, unsigned to) noexcept;
 
     // Rotate each vector using the quaternion `q`.
     void Rotate(VOV4& output, const Q4& q, unsigned from, unsigned to);
 
+    // How exact the reciprocal square roots of `Normalize()` and `MultiplyNormals()` are.
+    enum class Precision : uint8_t
+    {
+      // The raw approximation, ~12 bits(~14 with AVX-512), fine for lighting.
+      kFast,
+      // Plus a Newton-Raphson step, ~22 bits, barely more expensive and way cheaper than a real square root and division.
+      kPrecise,
+    };
+
+    // Normalizes the x, y and z of each vector, w is kept(e.g the handedness of tangents), stores results in `output`(can be `*this`).
+    // Zero vectors stay zero. `from` must be a multiple of `kBatch`, like everything else here.
+    void Normalize(VOV4& output, Precision precision, unsigned from, unsigned to) const noexcept;
+    // Transforms directions(normals, tangents) by the upper 3x3 of `m` and renormalizes them in the same pass, w is kept.
+    // For normals `m` should be `M4x4::NormalMatrix()` of the model matrix.
+    void MultiplyNormals(VOV4& output, const M4x4& m, Precision precision, unsigned from, unsigned to) const noexcept;
+    // `out[i]` gets the dot product of the x, y and z of vector `i` and `b[i]`, e.g normals and view directions for backface tests.
+    // `out` must be padded to `kBatch` like the buffer.
+    void DotProduct(float* out, const VOV4& b, unsigned from, unsigned to) const noexcept;
+    // Same but every vector against `v`, e.g a light direction.
+    void DotProduct(float* out, const V4& v, unsigned from, unsigned to) const noexcept;
+    // Cross products of the x, y and z of vector `i` and `b[i]`, w is 0, stores results in `output`(can be `*this`).
+    void CrossProduct(VOV4& output, const VOV4& b, unsigned from, unsigned to) const noexcept;
+    // The vectors as unit quaternions(like `Q4`), each interpolated from ours to `b[i]` by `t[i]`(0 to 1) the short way around, stores results in `output`(can be `*this`).
+    // A corrected nlerp, so no trigonometry, within ~1e-4 radians of a real slerp for rotations up to ~120 degrees apart, ~1e-3 near 180. `t` must be padded to `kBatch` like the buffer.
+    void Slerp(VOV4& output, const VOV4& b, const float* t, unsigned from, unsigned to) const noexcept;
+
     // A chunk is a piece that a single Minion may process at once.
     // unsigned chunk_size(unsigned total_n) { return (n_ / (kAlign / sizeof (V4))) / total_n; }
 
@@ -311,6 +405,218 @@ namespace nogl
     std::unique_ptr<V4[]> buffer_ = nullptr;
   };
 
+  // Structure Of Vectors(4 dimensional), the SoA sibling of `VOV4`.
+  // Every component has its own stream, so a register holds the same component of 8(or 16) vectors, and kernels work on all of them at once without any shuffling or broadcasting of the vectors themselves.
+  class SOV4
+  {
+    public:
+    static constexpr unsigned kAlign = VOV4::kAlign;
+    // How many vectors the kernels process at once. The streams are padded to it.
+    static constexpr unsigned kBatch = kAlign / sizeof(float);
+
+    // n is the number of the vectors.
+    SOV4(unsigned n = 0)
+    {
+      Reallocate(n);
+    }
+    // Converts `vov` into the SoA layout.
+    SOV4(const VOV4& vov) : SOV4(vov.n())
+    {
+      *this = vov;
+    }
+    SOV4(SOV4&&) = default;
+    SOV4& operator =(SOV4&&) = default;
+
+    ~SOV4() = default;
+
+    // NOTE: Erases all previous data if existed.
+    void Reallocate(unsigned n);
+
+    // Converts from `VOV4`, the number of vectors is whoever has a smaller `n`.
+    void operator =(const VOV4& vov) noexcept;
+    // Converts into `vov`, the number of vectors is whoever has a smaller `n`.
+    void CopyTo(VOV4& vov) const noexcept;
+
+    void operator *=(const M4x4& m) noexcept { Multiply(*this, m, 0, n_); }
+
+    // Multiplies all vectors by `m`, just like `VOV4::Multiply()`, stores results in `output`(can be `*this`).
+    // From `from` up to `to`(exclusive).
+    // Huge note: `from` must be a multiple of `kBatch`, `to` may be anything up to `n()`.
+    void Multiply(SOV4& output, const M4x4& m, unsigned from, unsigned to) const noexcept;
+
+    // The number of vectors, not bytes, not floats.
+    unsigned n() const noexcept { return n_; }
+    // The stream of component `c`, `0` for x up to `3` for w. Aligned to `kAlign`, and padded to `kBatch` vectors.
+    float* stream(unsigned c) noexcept { return buffer_.get() + c * capacity_; }
+    const float* stream(unsigned c) const noexcept { return buffer_.get() + c * capacity_; }
+    // The distance between the streams, in floats, `n()` rounded up to `kBatch`.
+    unsigned capacity() const noexcept { return capacity_; }
+
+    private:
+    // See `n()`
+    unsigned n_;
+    // `n_` rounded up to `kBatch`, the distance between streams.
+    unsigned capacity_;
+    // All 4 streams one after another. MUST BE ALIGNED TO `kAlign`
+    std::unique_ptr<float[]> buffer_ = nullptr;
+  };
+
+  // Structure Of Vectors in Half precision, like `SOV4` but every component is a 16 bit float, and only the first `components()` streams are stored, the rest read as 0.
+  // For normals, tangents and other unit-range attributes, 3 halves are 6 bytes per vector instead of the 16 of a `VOV4`. ~3 significant digits, plenty for directions.
+  // The kernels convert on the fly(F16C from AVX2 up), so the full floats only exist in registers.
+  class SOVH
+  {
+    public:
+    static constexpr unsigned kAlign = VOV4::kAlign;
+    // The streams are padded to it, like `SOV4`.
+    static constexpr unsigned kBatch = VOV4::kBatch;
+
+    // n is the number of the vectors, `components` 1 to 4.
+    SOVH(unsigned n = 0, unsigned components = 4)
+    {
+      Reallocate(n, components);
+    }
+    // Converts `vov` into half precision, keeping its first `components`.
+    SOVH(const VOV4& vov, unsigned components = 4) : SOVH(vov.n(), components)
+    {
+      *this = vov;
+    }
+    SOVH(const SOVH& other) : SOVH(other.n_, other.components_)
+    {
+      std::copy_n(other.buffer_.get(), capacity_ * components_, buffer_.get());
+    }
+
+    ~SOVH() = default;
+
+    // NOTE: Erases all previous data if existed.
+    void Reallocate(unsigned n, unsigned components = 4);
+
+    // Converts from `VOV4`(rounding to the nearest half), the number of vectors is whoever has a smaller `n`. Components past `components()` are dropped.
+    void operator =(const VOV4& vov) noexcept;
+    // Converts into `vov`, the number of vectors is whoever has a smaller `n`. Components past `components()` become 0.
+    void CopyTo(VOV4& vov) const noexcept;
+
+    // Multiplies all vectors by `m` into `output`, converting on the way, like `VOV4::Multiply()`.
+    // For normals that's the inverse transpose of the model matrix, with the missing w(0) translation does not apply anyway.
+    // Huge note: `from` must be a multiple of `kBatch`, `to` may be anything up to `n()`.
+    void Multiply(VOV4& output, const M4x4& m, unsigned from, unsigned to) const noexcept;
+
+    // The number of vectors, not bytes, not halves.
+    unsigned n() const noexcept { return n_; }
+    unsigned components() const noexcept { return components_; }
+    // The stream of component `c`, raw IEEE half precision bits. Aligned to 32 bytes, and padded to `kBatch` vectors.
+    uint16_t* stream(unsigned c) noexcept { return buffer_.get() + c * capacity_; }
+    const uint16_t* stream(unsigned c) const noexcept { return buffer_.get() + c * capacity_; }
+
+    private:
+    // See `n()`
+    unsigned n_;
+    // See `components()`
+    unsigned components_;
+    // `n_` rounded up to `kBatch`, the distance between streams.
+    unsigned capacity_;
+    // The `components_` streams one after another. MUST BE ALIGNED TO `kAlign`
+    std::unique_ptr<uint16_t[]> buffer_ = nullptr;
+  };
+
+  // Structure Of Vectors, Quantized. Positions as 16 bit integers in 3 streams(x, y and z, w is always 1), 6 bytes per vector instead of the 16 of a `VOV4`.
+  // They are relative to their bounding box, the dequantization matrix `Quantize()` returns brings them back. Fold it into the matrix they are transformed by, and it costs nothing per vector.
+  class SOVQ
+  {
+    public:
+    static constexpr unsigned kAlign = VOV4::kAlign;
+    // The streams are padded to it, like `SOV4`.
+    static constexpr unsigned kBatch = VOV4::kBatch;
+
+    // n is the number of the vectors.
+    SOVQ(unsigned n = 0)
+    {
+      Reallocate(n);
+    }
+    SOVQ(const SOVQ& other) : SOVQ(other.n_)
+    {
+      std::copy_n(other.buffer_.get(), capacity_ * 3, buffer_.get());
+    }
+
+    ~SOVQ() = default;
+
+    // NOTE: Erases all previous data if existed.
+    void Reallocate(unsigned n);
+
+    // Reallocates to `vov.n()` and quantizes the x, y and z of `vov` over their bounding box, using the full 16 bits on each axis.
+    // Returns the dequantization matrix, `m x dequantization` does to the quantized vectors what `m` does to the originals.
+    M4x4 Quantize(const VOV4& vov);
+
+    // `VOV4::Project()` straight from the integers, `m` must have the dequantization matrix folded in.
+    // Huge note: `from` must be a multiple of `kBatch`, `to` may be anything up to `n()`.
+    void Project(VOV4& output, uint8_t* outcodes, const M4x4& m, float width, float height, unsigned from, unsigned to) const noexcept;
+
+    // The number of vectors, not bytes, not integers.
+    unsigned n() const noexcept { return n_; }
+    // The stream of component `c`, `0` for x up to `2` for z. Aligned to 32 bytes, and padded to `kBatch` vectors.
+    int16_t* stream(unsigned c) noexcept { return buffer_.get() + c * capacity_; }
+    const int16_t* stream(unsigned c) const noexcept { return buffer_.get() + c * capacity_; }
+
+    private:
+    // See `n()`
+    unsigned n_;
+    // `n_` rounded up to `kBatch`, the distance between streams.
+    unsigned capacity_;
+    // The 3 streams one after another. MUST BE ALIGNED TO `kAlign`
+    std::unique_ptr<int16_t[]> buffer_ = nullptr;
+  };
+
+  // Vector Of Vectors(2 dimensional), packed, 2 per XMM and 4 per YMM, e.g texture coordinates, where a `VOV4` would waste half the memory.
+  class VOV2
+  {
+    public:
+    static constexpr unsigned kAlign = VOV4::kAlign;
+    // The buffer is padded to it, like `VOV4`.
+    static constexpr unsigned kBatch = VOV4::kBatch;
+
+    // n is the number of the vectors.
+    VOV2(unsigned n = 0)
+    {
+      Reallocate(n);
+    }
+    VOV2(const VOV2& other) : VOV2(other.n_)
+    {
+      *this = other;
+    }
+
+    ~VOV2() = default;
+
+    // NOTE: Erases all previous data if existed.
+    void Reallocate(unsigned n);
+
+    // Set every single vector, and every one of its components to `f`.
+    void operator =(float f) noexcept
+    {
+      Simd::kernels().fill_float(buffer_.get(), f, n_ * 2);
+    }
+    // Copies vectors from `other` to `this`, the number of vectors is whoever has a smaller `n`.
+    void operator =(const VOV2& other) noexcept
+    {
+      for (unsigned off = 0; off < std::min(n_, other.n_) * 2; off += 4)
+      {
+        XMM<float>(other.buffer_.get() + off).Store(buffer_.get() + off);
+      }
+    }
+
+    // The number of vectors, not bytes, not floats.
+    unsigned n() const noexcept { return n_; }
+
+    // The 2 components of the vector at index `i`.
+    float* operator [](unsigned i) noexcept { return buffer_.get() + i * 2; }
+    const float* operator [](unsigned i) const noexcept { return buffer_.get() + i * 2; }
+
+    private:
+    // See `n()`
+    unsigned n_;
+    // Flattened [x0,y0,x1,y1...]. MUST BE ALIGNED TO `kAlign`
+    std::unique_ptr<float[]> buffer_ = nullptr;
+  };
+
   class Q4 : public V4
   {
     public:
@@ -2,7 +2,10 @@
 #pragma once
 
 #include "Clock.hpp"
+#include "Profiler.hpp"
 #include "Context.hpp"
+#include "RenderTarget.hpp"
+#include "ResolutionScaler.hpp"
 #include "Chain.hpp"
 
 #include "Logger.hpp"
@@ -13,8 +16,13 @@
 #include "Image.hpp"
 #include "Font.hpp"
 #include "Scene.hpp"
+#include "Hierarchy.hpp"
+#include "Animation.hpp"
+#include "FrameSink.hpp"
 
 #include "math.hpp"
+#include "Bounds.hpp"
+#include "Simd.hpp"
 
 #ifndef __x86_64__
   #error Need x86_64 architecture.
@@ -0,0 +1,152 @@
+#include "Animation.hpp"
+#include "Scene.hpp"
+
+#include <algorithm>
+
+namespace nogl
+{
+  float Animation::Seek(Channel& channel, float time)
+  {
+    const std::vector<float>& times = samplers_[channel.sampler].times;
+
+    // Went back(it looped), the only time it has to search.
+    if (time < times[channel.key])
+    {
+      unsigned after = std::upper_bound(times.begin(), times.end(), time) - times.begin();
+      channel.key = after > 0 ? after - 1 : 0;
+    }
+    while (channel.key + 1 < times.size() && times[channel.key + 1] <= time)
+    {
+      ++channel.key;
+    }
+
+    // Before the first key or after the last, it's held.
+    if (channel.key + 1 >= times.size() || time <= times[channel.key])
+    {
+      return 0.0f;
+    }
+    return (time - times[channel.key]) / (times[channel.key + 1] - times[channel.key]);
+  }
+
+  void Animation::Prepare()
+  {
+    slerp_channels_.clear();
+    for (unsigned i = 0; i < channels_.size(); ++i)
+    {
+      if (channels_[i].path == Path::kRotation && samplers_[channels_[i].sampler].interpolation != Interpolation::kCubicSpline)
+      {
+        slerp_channels_.push_back(i);
+      }
+    }
+
+    unsigned n = slerp_channels_.size();
+    slerp_from_.Reallocate(n);
+    slerp_to_.Reallocate(n);
+    slerp_out_.Reallocate(n);
+    slerp_t_.reset(new (std::align_val_t(VOV4::kAlign)) float[(n + VOV4::kBatch - 1) / VOV4::kBatch * VOV4::kBatch]());
+
+    duration_ = 0.0f;
+    for (const Sampler& sampler : samplers_)
+    {
+      duration_ = std::max(duration_, sampler.times.back());
+    }
+  }
+
+  V4 Animation::Interpolate(const Sampler& sampler, unsigned key, unsigned next, float t, unsigned stride, unsigned i)
+  {
+    V4 value;
+    if (sampler.interpolation == Interpolation::kCubicSpline)
+    {
+      // Hermite, the tangents are scaled by the time between the keys, like glTF says.
+      float span = sampler.times[next] - sampler.times[key];
+      float t2 = t * t, t3 = t2 * t;
+      const V4& v0 = sampler.values[(key * 3 + 1) * stride + i], & out0 = sampler.values[(key * 3 + 2) * stride + i];
+      const V4& v1 = sampler.values[(next * 3 + 1) * stride + i], & in1 = sampler.values[next * 3 * stride + i];
+      for (unsigned c = 0; c < 4; ++c)
+      {
+        value[c] = (2*t3 - 3*t2 + 1) * v0[c] + span * (t3 - 2*t2 + t) * out0[c] + (-2*t3 + 3*t2) * v1[c] + span * (t3 - t2) * in1[c];
+      }
+    }
+    else
+    {
+      const V4& v0 = sampler.values[key * stride + i], & v1 = sampler.values[next * stride + i];
+      for (unsigned c = 0; c < 4; ++c)
+      {
+        value[c] = v0[c] + (v1[c] - v0[c]) * t;
+      }
+    }
+    return value;
+  }
+
+  void Animation::Apply(float time, Scene& scene)
+  {
+    Hierarchy& hierarchy = scene.hierarchy();
+    unsigned slot = 0;
+    for (Channel& channel : channels_)
+    {
+      const Sampler& sampler = samplers_[channel.sampler];
+      float t = Seek(channel, time);
+      unsigned key = channel.key, next = std::min<unsigned>(key + 1, sampler.times.size() - 1);
+
+      if (sampler.interpolation == Interpolation::kStep)
+      {
+        t = 0.0f;
+      }
+
+      if (channel.path == Path::kRotation && sampler.interpolation != Interpolation::kCubicSpline)
+      {
+        // All of them together below.
+        slerp_from_[slot] = sampler.values[key];
+        slerp_to_[slot] = sampler.values[next];
+        slerp_t_[slot] = t;
+        ++slot;
+        continue;
+      }
+
+      if (channel.path == Path::kWeights)
+      {
+        std::vector<float>& weights = scene.weights(channel.node);
+        for (unsigned i = 0; i < weights.size(); ++i)
+        {
+          weights[i] = Interpolate(sampler, key, next, t, weights.size(), i)[0];
+        }
+        continue;
+      }
+
+      V4 value = Interpolate(sampler, key, next, t, 1, 0);
+      switch (channel.path)
+      {
+        case Path::kTranslation:
+        hierarchy.set_translation(channel.node, value);
+        break;
+        case Path::kScale:
+        hierarchy.set_scale(channel.node, value);
+        break;
+        case Path::kRotation:
+        {
+          Q4 q;
+          for (unsigned c = 0; c < 4; ++c)
+          {
+            q[c] = value[c];
+          }
+          q.Normalize();
+          hierarchy.set_rotation(channel.node, q);
+        }
+        break;
+        case Path::kWeights:
+        break;
+      }
+    }
+
+    slerp_from_.Slerp(slerp_out_, slerp_to_, slerp_t_.get(), 0, slot);
+    for (unsigned i = 0; i < slot; ++i)
+    {
+      Q4 q;
+      for (unsigned c = 0; c < 4; ++c)
+      {
+        q[c] = slerp_out_[i][c];
+      }
+      hierarchy.set_rotation(channels_[slerp_channels_[i]].node, q);
+    }
+  }
+}
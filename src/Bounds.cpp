@@ -0,0 +1,171 @@
+#include "Bounds.hpp"
+
+#include <cmath>
+
+namespace nogl
+{
+  // Clears the sign bits, `&` it with something for the absolute values.
+  static XMM<float> AbsMask()
+  {
+    return XMM<int32_t>(0x7FFFFFFF).AsFloats();
+  }
+
+  AABB AABB::Of(const VOV4& vov) noexcept
+  {
+    return Of(vov, nullptr, vov.n());
+  }
+
+  AABB AABB::Of(const VOV4& vov, const unsigned* indices, unsigned n) noexcept
+  {
+    if (n == 0)
+    {
+      return AABB();
+    }
+
+    XMM<float> lo(vov[indices != nullptr ? indices[0] : 0].p_), hi = lo;
+    for (unsigned i = 1; i < n; ++i)
+    {
+      XMM<float> v(vov[indices != nullptr ? indices[i] : i].p_);
+      lo = lo.Min(v);
+      hi = hi.Max(v);
+    }
+
+    AABB box;
+    lo.Store(box.min.p_);
+    hi.Store(box.max.p_);
+    return box;
+  }
+
+  V4 AABB::center() const noexcept
+  {
+    V4 c;
+    ((XMM<float>(min.p_) + XMM<float>(max.p_)) * XMM<float>(0.5f)).Store(c.p_);
+    return c;
+  }
+
+  V4 AABB::extents() const noexcept
+  {
+    V4 e;
+    ((XMM<float>(max.p_) - XMM<float>(min.p_)) * XMM<float>(0.5f)).Store(e.p_);
+    return e;
+  }
+
+  AABB AABB::Transformed(const M4x4& m) const noexcept
+  {
+    V4 c = center(), e = extents();
+
+    XMM<float> new_c(m.p_[3]), new_e;
+    new_e.ZeroOut();
+    for (unsigned i = 0; i < 3; ++i)
+    {
+      XMM<float> col(m.p_[i]);
+      new_c += col * XMM<float>(c.p_[i]);
+      new_e += (col & AbsMask()) * XMM<float>(e.p_[i]);
+    }
+
+    AABB box;
+    (new_c - new_e).Store(box.min.p_);
+    (new_c + new_e).Store(box.max.p_);
+    return box;
+  }
+
+  Sphere Sphere::Of(const VOV4& vov, const AABB& bounds) noexcept
+  {
+    return Of(vov, nullptr, vov.n(), bounds);
+  }
+
+  Sphere Sphere::Of(const VOV4& vov, const unsigned* indices, unsigned n, const AABB& bounds) noexcept
+  {
+    Sphere sphere(bounds.center(), 0.0f);
+
+    XMM<float> c(sphere.center.p_), farthest;
+    farthest.ZeroOut();
+    for (unsigned i = 0; i < n; ++i)
+    {
+      XMM<float> d = XMM<float>(vov[indices != nullptr ? indices[i] : i].p_) - c;
+      farthest = farthest.Max(d.DotProduct(d, 0b0111));
+    }
+    sphere.radius = std::sqrt(farthest.x());
+    return sphere;
+  }
+
+  Sphere Sphere::Transformed(const M4x4& m) const noexcept
+  {
+    XMM<float> c(m.p_[3]);
+    float scale_squared = 0.0f;
+    for (unsigned i = 0; i < 3; ++i)
+    {
+      XMM<float> col(m.p_[i]);
+      c += col * XMM<float>(center.p_[i]);
+      scale_squared = std::max(scale_squared, col.DotProduct(col, 0b0111).x());
+    }
+
+    Sphere sphere;
+    c.Store(sphere.center.p_);
+    sphere.radius = radius * std::sqrt(scale_squared);
+    return sphere;
+  }
+
+  Frustum::Frustum(const M4x4& view_projection, float width, float height) noexcept
+  {
+    // The columns transposed are the rows, row `j` dotted with the vector is clip component `j`.
+    XMM<float> x(view_projection.p_[0]), y(view_projection.p_[1]), z(view_projection.p_[2]), w(view_projection.p_[3]);
+    XMM<float>::Transpose(x, y, z, w);
+
+    // Same as the outcodes, x in [0, width*w], y in [0, height*w] and z in [-w, w].
+    XMM<float> planes[kPlanes] = {
+      x,
+      w * XMM<float>(width) - x,
+      y,
+      w * XMM<float>(height) - y,
+      z + w,
+      w - z,
+    };
+
+    for (unsigned i = 0; i < kPlanes; ++i)
+    {
+      float length = std::sqrt(planes[i].DotProduct(planes[i], 0b0111).x());
+      // Only for degenerate matrices, better a plane that passes everything than NaNs.
+      if (length > 0.0f)
+      {
+        planes[i] /= XMM<float>(length);
+      }
+      planes[i].Store(planes_[i]);
+    }
+  }
+
+  bool Frustum::Intersects(const AABB& box) const noexcept
+  {
+    XMM<float> c(box.center().p_), e(box.extents().p_);
+    for (unsigned i = 0; i < kPlanes; ++i)
+    {
+      XMM<float> plane(planes_[i]);
+      // The corner farthest along the plane's normal is `e` away along every axis, it's outside if even that one is.
+      float distance = plane.DotProduct(c, 0b0111).x() + planes_[i][3];
+      float reach = (plane & AbsMask()).DotProduct(e, 0b0111).x();
+      if (distance + reach < 0.0f)
+      {
+        return false;
+      }
+    }
+    return true;
+  }
+
+  bool Frustum::Intersects(const Sphere& sphere) const noexcept
+  {
+    XMM<float> c(sphere.center.p_);
+    for (unsigned i = 0; i < kPlanes; ++i)
+    {
+      if (XMM<float>(planes_[i]).DotProduct(c, 0b0111).x() + planes_[i][3] < -sphere.radius)
+      {
+        return false;
+      }
+    }
+    return true;
+  }
+
+  void Frustum::Cull(uint8_t* visible, const SOV4& centers, const SOV4& extents) const noexcept
+  {
+    Simd::kernels().cull_boxes(visible, centers.stream(0), extents.stream(0), centers.capacity(), planes_[0], centers.n());
+  }
+}
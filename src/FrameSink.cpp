@@ -0,0 +1,678 @@
+#include "FrameSink.hpp"
+#include "Logger.hpp"
+
+#include <array>
+#include <cstring>
+
+namespace nogl
+{
+  // ==================================================================
+  //                              HELPERS
+  // ==================================================================
+
+  static void PushBigE32(std::vector<uint8_t>& out, uint32_t x)
+  {
+    out.push_back(x >> 24);
+    out.push_back(x >> 16);
+    out.push_back(x >> 8);
+    out.push_back(x);
+  }
+
+  static constexpr std::array<uint32_t, 256> kCRCTable = [] {
+    std::array<uint32_t, 256> table{};
+    for (uint32_t i = 0; i < 256; ++i)
+    {
+      uint32_t c = i;
+      for (unsigned k = 0; k < 8; ++k)
+      {
+        c = (c & 1) ? (0xEDB88320 ^ (c >> 1)) : (c >> 1);
+      }
+      table[i] = c;
+    }
+    return table;
+  }();
+
+  static uint32_t CRC32(const uint8_t* p, size_t n, uint32_t crc = 0)
+  {
+    crc = ~crc;
+    for (size_t i = 0; i < n; ++i)
+    {
+      crc = kCRCTable[(crc ^ p[i]) & 0xFF] ^ (crc >> 8);
+    }
+    return ~crc;
+  }
+
+  static constexpr uint32_t kAdlerBase = 65521;
+
+  static uint32_t Adler32(const uint8_t* p, size_t n)
+  {
+    uint32_t a = 1, b = 0;
+    while (n > 0)
+    {
+      // 5552 is the most bytes we can sum before `b` may overflow 32 bits.
+      size_t block = n < 5552 ? n : 5552;
+      n -= block;
+      for (size_t i = 0; i < block; ++i)
+      {
+        a += *p++;
+        b += a;
+      }
+      a %= kAdlerBase;
+      b %= kAdlerBase;
+    }
+    return (b << 16) | a;
+  }
+
+  // Same as zlib's adler32_combine(), gives the adler32 of the two buffers concatenated, where `n2` is the length of the second.
+  static uint32_t CombineAdler32(uint32_t adler1, uint32_t adler2, size_t n2)
+  {
+    uint32_t rem = n2 % kAdlerBase;
+    uint32_t sum1 = adler1 & 0xFFFF;
+    uint32_t sum2 = (rem * sum1) % kAdlerBase;
+    sum1 += (adler2 & 0xFFFF) + kAdlerBase - 1;
+    sum2 += (adler1 >> 16) + (adler2 >> 16) + kAdlerBase - rem;
+    if (sum1 >= kAdlerBase) sum1 -= kAdlerBase;
+    if (sum1 >= kAdlerBase) sum1 -= kAdlerBase;
+    if (sum2 >= (kAdlerBase << 1)) sum2 -= (kAdlerBase << 1);
+    if (sum2 >= kAdlerBase) sum2 -= kAdlerBase;
+    return (sum2 << 16) | sum1;
+  }
+
+  // ==================================================================
+  //                              DEFLATE
+  // ==================================================================
+
+  // Deflate is LSB first, except for huffman codes, which are MSB first.
+  struct BitWriter
+  {
+    std::vector<uint8_t>& out;
+    uint64_t bits = 0;
+    unsigned bits_n = 0;
+
+    void Put(uint32_t v, unsigned n)
+    {
+      bits |= static_cast<uint64_t>(v) << bits_n;
+      bits_n += n;
+      while (bits_n >= 8)
+      {
+        out.push_back(bits);
+        bits >>= 8;
+        bits_n -= 8;
+      }
+    }
+    void PutCode(uint32_t code, unsigned n)
+    {
+      uint32_t reversed = 0;
+      for (unsigned i = 0; i < n; ++i, code >>= 1)
+      {
+        reversed = (reversed << 1) | (code & 1);
+      }
+      Put(reversed, n);
+    }
+    void Align()
+    {
+      if (bits_n > 0)
+      {
+        out.push_back(bits);
+        bits = 0;
+        bits_n = 0;
+      }
+    }
+  };
+
+  static constexpr uint16_t kLengthBase[29] = {3,4,5,6,7,8,9,10,11,13,15,17,19,23,27,31,35,43,51,59,67,83,99,115,131,163,195,227,258};
+  static constexpr uint8_t kLengthExtra[29] = {0,0,0,0,0,0,0,0,1,1,1,1,2,2,2,2,3,3,3,3,4,4,4,4,5,5,5,5,0};
+  static constexpr uint16_t kDistanceBase[30] = {1,2,3,4,5,7,9,13,17,25,33,49,65,97,129,193,257,385,513,769,1025,1537,2049,3073,4097,6145,8193,12289,16385,24577};
+  static constexpr uint8_t kDistanceExtra[30] = {0,0,0,0,1,1,2,2,3,3,4,4,5,5,6,6,7,7,8,8,9,9,10,10,11,11,12,12,13,13};
+
+  // Writes a symbol of the fixed huffman literal/length alphabet.
+  static void PutFixedSymbol(BitWriter& bw, unsigned sym)
+  {
+    if (sym < 144)
+    {
+      bw.PutCode(0x30 + sym, 8);
+    }
+    else if (sym < 256)
+    {
+      bw.PutCode(0x190 + sym - 144, 9);
+    }
+    else if (sym < 280)
+    {
+      bw.PutCode(sym - 256, 7);
+    }
+    else
+    {
+      bw.PutCode(0xC0 + sym - 280, 8);
+    }
+  }
+
+  static void PutMatch(BitWriter& bw, unsigned length, unsigned distance)
+  {
+    unsigned l = 28;
+    while (kLengthBase[l] > length)
+    {
+      --l;
+    }
+    PutFixedSymbol(bw, 257 + l);
+    bw.Put(length - kLengthBase[l], kLengthExtra[l]);
+
+    unsigned d = 29;
+    while (kDistanceBase[d] > distance)
+    {
+      --d;
+    }
+    bw.PutCode(d, 5);
+    bw.Put(distance - kDistanceBase[d], kDistanceExtra[d]);
+  }
+
+  // Compresses `in` as a single fixed huffman block with a greedy LZ77 and appends it to `out`.
+  // If not `last` an empty stored block is appended, so the output ends byte aligned and independently compressed segments can be concatenated.
+  static void Deflate(const uint8_t* in, unsigned n, bool last, std::vector<uint8_t>& out)
+  {
+    static constexpr unsigned kWindow = 32768;
+    static constexpr unsigned kHashBits = 15;
+    static constexpr unsigned kMaxChain = 8;
+    static constexpr unsigned kMinMatch = 3, kMaxMatch = 258;
+
+    // Thread local because both the writer and the deflaters compress at once.
+    static thread_local std::unique_ptr<int[]> head(new int[1 << kHashBits]);
+    static thread_local std::vector<int> prev;
+
+    std::fill(head.get(), head.get() + (1 << kHashBits), -1);
+    prev.resize(n);
+
+    BitWriter bw{out};
+    bw.Put(last, 1);
+    bw.Put(1, 2); // Fixed huffman
+
+    auto hash = [in] (unsigned i) -> unsigned {
+      uint32_t x = in[i] | (in[i + 1] << 8) | (in[i + 2] << 16);
+      return (x * 2654435761u) >> (32 - kHashBits);
+    };
+
+    unsigned i = 0;
+    while (i < n)
+    {
+      unsigned best_length = 0, best_distance = 0;
+
+      if (i + kMinMatch <= n)
+      {
+        unsigned h = hash(i);
+        unsigned max_length = std::min(kMaxMatch, n - i);
+        int candidate = head[h];
+
+        for (unsigned chain = 0; candidate >= 0 && i - candidate <= kWindow && chain < kMaxChain; ++chain)
+        {
+          unsigned length = 0;
+          while (length < max_length && in[candidate + length] == in[i + length])
+          {
+            ++length;
+          }
+          if (length > best_length)
+          {
+            best_length = length;
+            best_distance = i - candidate;
+            if (length == max_length)
+            {
+              break;
+            }
+          }
+          candidate = prev[candidate];
+        }
+
+        prev[i] = head[h];
+        head[h] = i;
+      }
+
+      if (best_length >= kMinMatch)
+      {
+        PutMatch(bw, best_length, best_distance);
+        // Insert the skipped positions so later matches can find them.
+        for (unsigned j = i + 1; j < i + best_length && j + kMinMatch <= n; ++j)
+        {
+          unsigned h = hash(j);
+          prev[j] = head[h];
+          head[h] = j;
+        }
+        i += best_length;
+      }
+      else
+      {
+        PutFixedSymbol(bw, in[i]);
+        ++i;
+      }
+    }
+
+    PutFixedSymbol(bw, 256); // End of block
+
+    if (!last)
+    {
+      // Empty stored block, to byte align the segment.
+      bw.Put(0, 1);
+      bw.Put(0, 2);
+      bw.Align();
+      out.insert(out.end(), {0x00, 0x00, 0xFF, 0xFF});
+    }
+    else
+    {
+      bw.Align();
+    }
+  }
+
+  // ==================================================================
+  //                             FRAME SINK
+  // ==================================================================
+
+  FrameSink::FrameSink(const char* path, Target target, Format format, unsigned width, unsigned height, unsigned buffers_n, unsigned deflaters_n)
+  {
+    path_ = path;
+    target_ = target;
+    format_ = format;
+    width_ = width;
+    height_ = height;
+    frame_size_ = width * height * 4;
+    buffers_n_ = buffers_n > 0 ? buffers_n : 1;
+    deflaters_n_ = format == Format::kPNG ? deflaters_n : 0;
+
+    switch (target_)
+    {
+      case Target::kStream:
+      file_ = fopen(path, "wb");
+      break;
+
+      case Target::kPipe:
+      #ifdef _WIN32
+        file_ = _popen(path, "wb");
+      #else
+        file_ = popen(path, "w");
+      #endif
+      break;
+
+      default:
+      break;
+    }
+    if (target_ != Target::kFiles && file_ == nullptr)
+    {
+      throw OpenException("Opening frame sink stream.");
+    }
+
+    buffers_ = std::unique_ptr<uint8_t[]>(
+      new (std::align_val_t(32)) uint8_t[static_cast<size_t>(frame_size_) * buffers_n_]
+    );
+
+    if (deflaters_n_ > 0)
+    {
+      deflaters_.reset(new Deflater[deflaters_n_]);
+      deflate_begin_bells_.reset(new Bell[deflaters_n_]);
+      deflate_done_bells_.reset(new Bell[deflaters_n_]);
+      for (unsigned i = 0; i < deflaters_n_; ++i)
+      {
+        deflaters_[i].sink = this;
+        deflaters_[i].thread.Open(FrameSink::_StartDeflater, &deflaters_[i]);
+      }
+    }
+
+    writer_.Open(FrameSink::_StartWriter, this);
+  }
+
+  FrameSink::~FrameSink()
+  {
+    mutex_.Lock();
+    alive_ = false;
+    queued_bell_.Ring();
+    mutex_.Unlock();
+    writer_.Join();
+
+    // The writer is gone, so nobody else rings the deflaters.
+    deflaters_alive_ = false;
+    for (unsigned i = 0; i < deflaters_n_; ++i)
+    {
+      deflate_begin_bells_[i].Ring();
+      deflaters_[i].thread.Join();
+    }
+
+    if (file_ != nullptr)
+    {
+      if (target_ == Target::kPipe)
+      {
+        #ifdef _WIN32
+          _pclose(file_);
+        #else
+          pclose(file_);
+        #endif
+      }
+      else
+      {
+        fclose(file_);
+      }
+    }
+
+    Logger::Begin() << "Frame sink closed, " << frames_pushed_ << " frames pushed." << Logger::End();
+  }
+
+  void FrameSink::Push(const uint8_t* data)
+  {
+    mutex_.Lock();
+    if (failed_)
+    {
+      mutex_.Unlock();
+      throw WriteException("Writing a previous frame failed.");
+    }
+    // The only case where we block the render loop, the disk just can't keep up.
+    while (queued_n_ == buffers_n_)
+    {
+      written_bell_.Reset();
+      mutex_.Unlock();
+      written_bell_.Wait();
+      mutex_.Lock();
+    }
+    unsigned i = push_i_;
+    mutex_.Unlock();
+
+    // Safe without the lock, the writer never touches a buffer that isn't queued.
+    memcpy(buffers_.get() + static_cast<size_t>(frame_size_) * i, data, frame_size_);
+
+    mutex_.Lock();
+    push_i_ = (i + 1) % buffers_n_;
+    ++queued_n_;
+    ++frames_pushed_;
+    queued_bell_.Ring();
+    mutex_.Unlock();
+  }
+
+  void FrameSink::Flush()
+  {
+    mutex_.Lock();
+    while (queued_n_ > 0)
+    {
+      written_bell_.Reset();
+      mutex_.Unlock();
+      written_bell_.Wait();
+      mutex_.Lock();
+    }
+    mutex_.Unlock();
+  }
+
+  int FrameSink::StartWriter()
+  {
+    while (true)
+    {
+      mutex_.Lock();
+      while (queued_n_ == 0)
+      {
+        // Only exit once the queue is drained.
+        if (!alive_)
+        {
+          mutex_.Unlock();
+          return 0;
+        }
+        queued_bell_.Reset();
+        mutex_.Unlock();
+        queued_bell_.Wait();
+        mutex_.Lock();
+      }
+      unsigned i = write_i_;
+      mutex_.Unlock();
+
+      bool ok = Write(buffers_.get() + static_cast<size_t>(frame_size_) * i);
+      ++frames_written_;
+
+      mutex_.Lock();
+      write_i_ = (i + 1) % buffers_n_;
+      --queued_n_;
+      failed_ |= !ok;
+      written_bell_.Ring();
+      mutex_.Unlock();
+    }
+  }
+
+  int FrameSink::StartDeflater(unsigned i)
+  {
+    while (true)
+    {
+      deflate_begin_bells_[i].Wait();
+      deflate_begin_bells_[i].Reset();
+
+      if (!deflaters_alive_)
+      {
+        break;
+      }
+
+      Deflater& d = deflaters_[i];
+      d.out.clear();
+      Deflate(d.in, d.in_n, d.last, d.out);
+      d.adler = Adler32(d.in, d.in_n);
+
+      deflate_done_bells_[i].Ring();
+    }
+
+    return 0;
+  }
+
+  bool FrameSink::Write(const uint8_t* frame)
+  {
+    FILE* f = file_;
+    if (target_ == Target::kFiles)
+    {
+      char path[512];
+      snprintf(path, sizeof (path), path_.c_str(), frames_written_);
+      f = fopen(path, "wb");
+      if (f == nullptr)
+      {
+        Logger::Begin() << "Frame sink failed to open " << path << '.' << Logger::End();
+        return false;
+      }
+    }
+
+    const uint8_t* out = frame;
+    size_t out_n = frame_size_;
+    switch (format_)
+    {
+      case Format::kPPM:
+      EncodePPM(frame);
+      break;
+      case Format::kQOI:
+      EncodeQOI(frame);
+      break;
+      case Format::kPNG:
+      EncodePNG(frame);
+      break;
+      default:
+      break;
+    }
+    if (format_ != Format::kRaw)
+    {
+      out = encoded_.data();
+      out_n = encoded_.size();
+    }
+
+    bool ok = fwrite(out, 1, out_n, f) == out_n;
+
+    if (target_ == Target::kFiles)
+    {
+      ok &= fclose(f) == 0;
+    }
+    return ok;
+  }
+
+  void FrameSink::EncodePPM(const uint8_t* frame)
+  {
+    char header[64];
+    int header_n = snprintf(header, sizeof (header), "P6\n%u %u\n255\n", width_, height_);
+
+    encoded_.resize(header_n + width_ * height_ * 3);
+    memcpy(encoded_.data(), header, header_n);
+
+    uint8_t* rgb = encoded_.data() + header_n;
+    for (unsigned i = 0; i < width_ * height_; ++i, rgb += 3, frame += 4)
+    {
+      rgb[0] = frame[2];
+      rgb[1] = frame[1];
+      rgb[2] = frame[0];
+    }
+  }
+
+  void FrameSink::EncodeQOI(const uint8_t* frame)
+  {
+    enum : uint8_t
+    {
+      kOpIndex = 0x00,
+      kOpDiff = 0x40,
+      kOpLuma = 0x80,
+      kOpRun = 0xC0,
+      kOpRGB = 0xFE,
+    };
+
+    encoded_.clear();
+    encoded_.insert(encoded_.end(), {'q', 'o', 'i', 'f'});
+    PushBigE32(encoded_, width_);
+    PushBigE32(encoded_, height_);
+    encoded_.push_back(3); // RGB
+    encoded_.push_back(0); // sRGB with linear alpha
+
+    // Alpha is always 255, the X in BGRX is padding. The index is still RGBA, decoders start it all 0s, alpha too, so an unseen slot must never match an opaque pixel.
+    uint8_t index[64][4] = {};
+    uint8_t pr = 0, pg = 0, pb = 0;
+    unsigned run = 0;
+
+    const unsigned pixels_n = width_ * height_;
+    for (unsigned i = 0; i < pixels_n; ++i, frame += 4)
+    {
+      uint8_t r = frame[2], g = frame[1], b = frame[0];
+
+      if (r == pr && g == pg && b == pb)
+      {
+        ++run;
+        if (run == 62 || i == pixels_n - 1)
+        {
+          encoded_.push_back(kOpRun | (run - 1));
+          run = 0;
+        }
+        continue;
+      }
+
+      if (run > 0)
+      {
+        encoded_.push_back(kOpRun | (run - 1));
+        run = 0;
+      }
+
+      unsigned hash = (r * 3 + g * 5 + b * 7 + 255 * 11) % 64;
+      if (index[hash][0] == r && index[hash][1] == g && index[hash][2] == b && index[hash][3] == 255)
+      {
+        encoded_.push_back(kOpIndex | hash);
+      }
+      else
+      {
+        index[hash][0] = r;
+        index[hash][1] = g;
+        index[hash][2] = b;
+        index[hash][3] = 255;
+
+        int8_t dr = r - pr, dg = g - pg, db = b - pb;
+        int8_t dr_dg = dr - dg, db_dg = db - dg;
+
+        if (dr >= -2 && dr <= 1 && dg >= -2 && dg <= 1 && db >= -2 && db <= 1)
+        {
+          encoded_.push_back(kOpDiff | ((dr + 2) << 4) | ((dg + 2) << 2) | (db + 2));
+        }
+        else if (dg >= -32 && dg <= 31 && dr_dg >= -8 && dr_dg <= 7 && db_dg >= -8 && db_dg <= 7)
+        {
+          encoded_.push_back(kOpLuma | (dg + 32));
+          encoded_.push_back(((dr_dg + 8) << 4) | (db_dg + 8));
+        }
+        else
+        {
+          encoded_.insert(encoded_.end(), {kOpRGB, r, g, b});
+        }
+      }
+
+      pr = r;
+      pg = g;
+      pb = b;
+    }
+
+    encoded_.insert(encoded_.end(), {0, 0, 0, 0, 0, 0, 0, 1});
+  }
+
+  void FrameSink::EncodePNG(const uint8_t* frame)
+  {
+    // Filter every scanline with "Sub", cheap and compresses rendered frames well.
+    const unsigned row_size = 1 + width_ * 3;
+    filtered_.resize(row_size * height_);
+    for (unsigned y = 0; y < height_; ++y)
+    {
+      uint8_t* row = filtered_.data() + row_size * y;
+      const uint8_t* in = frame + width_ * 4 * y;
+      row[0] = 1; // Sub
+      uint8_t pr = 0, pg = 0, pb = 0;
+      for (unsigned x = 0; x < width_; ++x, in += 4)
+      {
+        uint8_t* rgb = row + 1 + x * 3;
+        rgb[0] = in[2] - pr;
+        rgb[1] = in[1] - pg;
+        rgb[2] = in[0] - pb;
+        pr = in[2];
+        pg = in[1];
+        pb = in[0];
+      }
+    }
+
+    // Give each deflater a segment and do the first one here meanwhile.
+    const unsigned segments_n = deflaters_n_ + 1;
+    const unsigned segment_size = filtered_.size() / segments_n;
+    for (unsigned i = 0; i < deflaters_n_; ++i)
+    {
+      Deflater& d = deflaters_[i];
+      d.in = filtered_.data() + segment_size * (i + 1);
+      d.in_n = (i == deflaters_n_ - 1) ? filtered_.size() - segment_size * (i + 1) : segment_size;
+      d.last = i == deflaters_n_ - 1;
+      deflate_begin_bells_[i].Ring();
+    }
+
+    deflated_.clear();
+    deflated_.insert(deflated_.end(), {0x78, 0x01}); // zlib header, 32K window, fastest
+    unsigned first_n = segments_n == 1 ? filtered_.size() : segment_size;
+    Deflate(filtered_.data(), first_n, segments_n == 1, deflated_);
+    uint32_t adler = Adler32(filtered_.data(), first_n);
+
+    if (deflaters_n_ > 0)
+    {
+      Bell::MultiWait(deflate_done_bells_.get(), deflaters_n_);
+      for (unsigned i = 0; i < deflaters_n_; ++i)
+      {
+        deflate_done_bells_[i].Reset();
+        deflated_.insert(deflated_.end(), deflaters_[i].out.begin(), deflaters_[i].out.end());
+        adler = CombineAdler32(adler, deflaters_[i].adler, deflaters_[i].in_n);
+      }
+    }
+    PushBigE32(deflated_, adler);
+
+    // Now the actual file
+    encoded_.clear();
+    encoded_.insert(encoded_.end(), {0x89, 'P', 'N', 'G', '\r', '\n', 0x1A, '\n'});
+
+    auto push_chunk = [this] (const char type[4], const uint8_t* data, unsigned n) {
+      PushBigE32(encoded_, n);
+      size_t crc_begin = encoded_.size();
+      encoded_.insert(encoded_.end(), type, type + 4);
+      encoded_.insert(encoded_.end(), data, data + n);
+      PushBigE32(encoded_, CRC32(encoded_.data() + crc_begin, n + 4));
+    };
+
+    std::vector<uint8_t> ihdr;
+    PushBigE32(ihdr, width_);
+    PushBigE32(ihdr, height_);
+    ihdr.insert(ihdr.end(), {
+      8, // Bit depth
+      2, // RGB
+      0, // Deflate
+      0, // Adaptive filtering
+      0, // No interlace
+    });
+
+    push_chunk("IHDR", ihdr.data(), ihdr.size());
+    push_chunk("IDAT", deflated_.data(), deflated_.size());
+    push_chunk("IEND", nullptr, 0);
+  }
+}
@@ -0,0 +1,58 @@
+#include "Hierarchy.hpp"
+#include "Exception.hpp"
+
+#include <algorithm>
+
+namespace nogl
+{
+  unsigned Hierarchy::Add(unsigned parent)
+  {
+    if (parent != kNoParent && parent >= n())
+    {
+      throw IndexException("Parent must be added before its children.");
+    }
+
+    parents_.push_back(parent);
+    translations_.push_back(V4(0, 0, 0));
+    rotations_.push_back(Q4::WithAngle(0, 0, 1, 0));
+    scales_.push_back(V4(1, 1, 1));
+    locals_.push_back(M4x4::Identity());
+    worlds_.push_back(M4x4::Identity());
+    dirty_.push_back(kLocalDirty);
+    any_dirty_ = true;
+
+    return n() - 1;
+  }
+
+  void Hierarchy::Update()
+  {
+    if (!any_dirty_)
+    {
+      return;
+    }
+
+    for (unsigned i = 0; i < n(); ++i)
+    {
+      unsigned parent = parents_[i];
+      // The parent was already handled, its flags are still up, so that's how the whole subtree gets dirty.
+      if (parent != kNoParent && dirty_[parent])
+      {
+        dirty_[i] |= kWorldDirty;
+      }
+
+      if (!dirty_[i])
+      {
+        continue;
+      }
+
+      if (dirty_[i] & kLocalDirty)
+      {
+        locals_[i] = M4x4::Compose(translations_[i], rotations_[i], scales_[i]);
+      }
+      worlds_[i] = parent == kNoParent ? locals_[i] : worlds_[parent] * locals_[i];
+    }
+
+    std::fill(dirty_.begin(), dirty_.end(), 0);
+    any_dirty_ = false;
+  }
+}
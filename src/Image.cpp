@@ -5,6 +5,15 @@
 
 namespace nogl
 {
+  void _Image::Allocate(unsigned bpp)
+  {
+    // Padded so SIMD loops can go in whole 32 byte steps.
+    unsigned size = (width_ * height_ * bpp + 31) & ~31u;
+    data_ = std::unique_ptr<uint8_t[]>(
+      new (std::align_val_t(32)) uint8_t[size]()
+    );
+  }
+
   // Image::Image(const char* path)
   // {
   //   FILE* f = fopen(path, "rb");
@@ -0,0 +1,829 @@
+#include "Mesh.hpp"
+
+#include <algorithm>
+#include <cmath>
+
+namespace nogl
+{
+  // The sphere and normal cone of `meshlet`, its ranges must be set.
+  template <typename I>
+  static void Bound(Meshlet& meshlet, const VOV4& positions, const std::vector<std::array<I, 3>>& indices, const unsigned* vertices)
+  {
+    AABB box = AABB::Of(positions, vertices, meshlet.vertices_n);
+    meshlet.sphere = Sphere::Of(positions, vertices, meshlet.vertices_n, box);
+
+    // The axis is the average of the unit normals, degenerate triangles have none and don't matter.
+    V4 normals[Meshlet::kMaxTriangles];
+    V4 sum(0.0f);
+    for (unsigned t = 0; t < meshlet.triangles_n; ++t)
+    {
+      const auto& tri = indices[meshlet.first_triangle + t];
+      V4 edge1 = positions[tri[1]], edge2 = positions[tri[2]];
+      edge1 -= positions[tri[0]];
+      edge2 -= positions[tri[0]];
+      // CCW, so it points to the front.
+      edge1.CrossProduct(edge2);
+      normals[t] = edge1;
+      if (normals[t].magnitude3() > 0.0f)
+      {
+        normals[t].Normalize3();
+      }
+      sum += normals[t];
+    }
+
+    // Never true, see `Meshlet::cutoff`.
+    meshlet.apex = meshlet.sphere.center;
+    meshlet.axis = V4(1.0f, 0.0f, 0.0f);
+    meshlet.cutoff = 2.0f;
+
+    if (sum.magnitude3() == 0.0f)
+    {
+      return;
+    }
+    sum.Normalize3();
+
+    float min_dot = 1.0f;
+    for (unsigned t = 0; t < meshlet.triangles_n; ++t)
+    {
+      if (normals[t].magnitude3() > 0.0f)
+      {
+        min_dot = std::min(min_dot, normals[t].DotProduct(sum));
+      }
+    }
+    // Past ~85 degrees from the axis the cone is so wide it would hardly ever cull anything.
+    if (min_dot <= 0.1f)
+    {
+      return;
+    }
+
+    // The apex goes back along the axis until it's behind every triangle's plane, then looking at it within the cone means looking at the backs of all.
+    V4 center = meshlet.sphere.center;
+    center[3] = 0.0f;
+    float back = 0.0f;
+    for (unsigned t = 0; t < meshlet.triangles_n; ++t)
+    {
+      if (normals[t].magnitude3() > 0.0f)
+      {
+        V4 to_center = center;
+        to_center -= positions[indices[meshlet.first_triangle + t][0]];
+        to_center[3] = 0.0f;
+        back = std::max(back, to_center.DotProduct(normals[t]) / normals[t].DotProduct(sum));
+      }
+    }
+
+    meshlet.axis = sum;
+    meshlet.apex = sum;
+    meshlet.apex *= V4(-back);
+    meshlet.apex += center;
+    meshlet.apex[3] = 1.0f;
+    meshlet.cutoff = std::sqrt(1.0f - min_dot * min_dot);
+  }
+
+  // Which triangles use each vertex, the ones of vertex `v` are `triangles[first[v]]` up to `triangles[first[v + 1]]`.
+  struct Adjacency
+  {
+    std::vector<unsigned> first;
+    std::vector<unsigned> triangles;
+
+    template <typename I>
+    Adjacency(const std::array<I, 3>* indices, unsigned triangles_n, unsigned vertices_n) : first(vertices_n + 1, 0), triangles(triangles_n * 3)
+    {
+      for (unsigned t = 0; t < triangles_n; ++t)
+      {
+        for (unsigned v : indices[t])
+        {
+          ++first[v + 1];
+        }
+      }
+      for (unsigned v = 0; v < vertices_n; ++v)
+      {
+        first[v + 1] += first[v];
+      }
+      std::vector<unsigned> filled(first.begin(), first.end() - 1);
+      for (unsigned t = 0; t < triangles_n; ++t)
+      {
+        for (unsigned v : indices[t])
+        {
+          triangles[filled[v]++] = t;
+        }
+      }
+    }
+  };
+
+  // Tipsify(Sander, Nehab and Barczak 2007), puts the order of the `triangles_n` triangles of `indices` into `order`.
+  // It fans around one vertex at a time, and picks the next one among the vertices just used that will still be among the last `cache_size` when its fan is done, so consecutive triangles share vertices.
+  static void Tipsify(const std::array<unsigned, 3>* indices, unsigned triangles_n, unsigned vertices_n, unsigned cache_size, unsigned* order)
+  {
+    Adjacency adjacency(indices, triangles_n, vertices_n);
+
+    // The triangles of each vertex not emitted yet, and when it last entered the cache.
+    std::vector<unsigned> live(vertices_n), entered(vertices_n, 0);
+    for (unsigned v = 0; v < vertices_n; ++v)
+    {
+      live[v] = adjacency.first[v + 1] - adjacency.first[v];
+    }
+    std::vector<uint8_t> emitted(triangles_n, 0);
+    // Every vertex used so far, the fallbacks when a fan leads nowhere.
+    std::vector<unsigned> dead_ends, candidates;
+
+    unsigned time = cache_size + 1, cursor = 0, emitted_n = 0;
+    for (unsigned fan = 0; fan != ~0u;)
+    {
+      candidates.clear();
+      for (unsigned a = adjacency.first[fan]; a < adjacency.first[fan + 1]; ++a)
+      {
+        unsigned t = adjacency.triangles[a];
+        if (emitted[t])
+        {
+          continue;
+        }
+
+        for (unsigned v : indices[t])
+        {
+          dead_ends.push_back(v);
+          candidates.push_back(v);
+          --live[v];
+          if (time - entered[v] > cache_size)
+          {
+            entered[v] = time++;
+          }
+        }
+        emitted[t] = 1;
+        order[emitted_n++] = t;
+      }
+
+      // The one that entered the cache the earliest, of those that won't drop out of it during their own fan.
+      fan = ~0u;
+      int best = -1;
+      for (unsigned v : candidates)
+      {
+        if (live[v] == 0)
+        {
+          continue;
+        }
+        int priority = time - entered[v] + 2 * live[v] <= cache_size ? time - entered[v] : 0;
+        if (priority > best)
+        {
+          best = priority;
+          fan = v;
+        }
+      }
+
+      while (fan == ~0u && !dead_ends.empty())
+      {
+        if (live[dead_ends.back()] > 0)
+        {
+          fan = dead_ends.back();
+        }
+        dead_ends.pop_back();
+      }
+      for (; fan == ~0u && cursor < vertices_n; ++cursor)
+      {
+        if (live[cursor] > 0)
+        {
+          fan = cursor;
+        }
+      }
+    }
+  }
+
+  // Splits `indices` into `lod.meshlets`, reordering them so each is a range of triangles. The bounds are left for `BoundMeshlets()`.
+  template <typename I>
+  static void BuildMeshlets(Mesh::Lod& lod, std::vector<std::array<I, 3>>& indices, const VOV4& positions)
+  {
+    lod.meshlets.clear();
+    lod.meshlet_vertices.clear();
+
+    const unsigned triangles_n = indices.size();
+
+    Adjacency adjacency(indices.data(), triangles_n, positions.n());
+
+    // The meshlet a vertex was last added to, so it's added to each only once.
+    std::vector<unsigned> added_to(positions.n(), ~0u);
+    auto new_vertices = [&](unsigned t) -> unsigned {
+      const auto& tri = indices[t];
+      return (added_to[tri[0]] != lod.meshlets.size()) + (added_to[tri[1]] != lod.meshlets.size()) + (added_to[tri[2]] != lod.meshlets.size());
+    };
+
+    // The triangles are reordered so every meshlet is a range of them.
+    std::vector<std::array<I, 3>> ordered;
+    ordered.reserve(triangles_n);
+    std::vector<uint8_t> used(triangles_n, 0);
+    unsigned seed = 0;
+
+    while (true)
+    {
+      while (seed < triangles_n && used[seed])
+      {
+        ++seed;
+      }
+      if (seed == triangles_n)
+      {
+        break;
+      }
+
+      Meshlet meshlet = {};
+      meshlet.first_triangle = ordered.size();
+      meshlet.first_vertex = lod.meshlet_vertices.size();
+
+      // Of the vertices so far, the meshlet grows around their center.
+      V4 sum(0.0f);
+
+      // Grows from the seed through neighbours, so the meshlets come out compact and their cones narrow, whatever the order of the indices.
+      for (unsigned t = seed; t != ~0u;)
+      {
+        used[t] = 1;
+        ordered.push_back(indices[t]);
+        for (unsigned v : indices[t])
+        {
+          if (added_to[v] != lod.meshlets.size())
+          {
+            added_to[v] = lod.meshlets.size();
+            lod.meshlet_vertices.push_back(v);
+            ++meshlet.vertices_n;
+            sum += positions[v];
+          }
+        }
+        ++meshlet.triangles_n;
+
+        if (meshlet.triangles_n == Meshlet::kMaxTriangles)
+        {
+          break;
+        }
+
+        // The unused neighbour that adds the fewest vertices, ties go to the closest to the center.
+        unsigned room = Meshlet::kMaxVertices - meshlet.vertices_n, fewest = ~0u;
+        float closest = 0.0f;
+        V4 center = sum;
+        center /= V4(static_cast<float>(meshlet.vertices_n));
+        t = ~0u;
+        for (unsigned i = meshlet.first_vertex; i < lod.meshlet_vertices.size(); ++i)
+        {
+          unsigned v = lod.meshlet_vertices[i];
+          for (unsigned a = adjacency.first[v]; a < adjacency.first[v + 1]; ++a)
+          {
+            unsigned neighbour = adjacency.triangles[a];
+            if (used[neighbour])
+            {
+              continue;
+            }
+            unsigned adds = new_vertices(neighbour);
+            if (adds > room || adds > fewest)
+            {
+              continue;
+            }
+            V4 offset = positions[indices[neighbour][0]];
+            offset -= center;
+            float distance = offset.DotProduct(offset);
+            if (adds < fewest || distance < closest)
+            {
+              fewest = adds;
+              closest = distance;
+              t = neighbour;
+            }
+          }
+        }
+
+        // No neighbours left(e.g the mesh is in disconnected pieces), just the next unused one then, if it fits.
+        if (t == ~0u)
+        {
+          while (seed < triangles_n && used[seed])
+          {
+            ++seed;
+          }
+          if (seed < triangles_n && new_vertices(seed) <= room)
+          {
+            t = seed;
+          }
+        }
+      }
+
+      lod.meshlets.push_back(meshlet);
+    }
+
+    indices = std::move(ordered);
+  }
+
+  // Tipsify within each meshlet, so the raster loop's gathers from `vertices_projected_` hit what the last few triangles already brought in.
+  // Only the meshlet's own vertices matter, so they get local indices. `vertices_n` is of the whole mesh.
+  template <typename I>
+  static void TipsifyMeshlets(const Mesh::Lod& lod, std::vector<std::array<I, 3>>& indices, unsigned vertices_n)
+  {
+    std::vector<unsigned> local(vertices_n);
+    std::array<unsigned, 3> local_indices[Meshlet::kMaxTriangles];
+    std::array<I, 3> ordered[Meshlet::kMaxTriangles];
+    unsigned order[Meshlet::kMaxTriangles];
+    for (const Meshlet& meshlet : lod.meshlets)
+    {
+      for (unsigned v = 0; v < meshlet.vertices_n; ++v)
+      {
+        local[lod.meshlet_vertices[meshlet.first_vertex + v]] = v;
+      }
+      for (unsigned t = 0; t < meshlet.triangles_n; ++t)
+      {
+        for (unsigned c = 0; c < 3; ++c)
+        {
+          local_indices[t][c] = local[indices[meshlet.first_triangle + t][c]];
+        }
+      }
+
+      // ~16 vertices, a `VOV4::kBatch`, is 4 cache lines of projected vertices.
+      Tipsify(local_indices, meshlet.triangles_n, meshlet.vertices_n, VOV4::kBatch, order);
+      for (unsigned t = 0; t < meshlet.triangles_n; ++t)
+      {
+        ordered[t] = indices[meshlet.first_triangle + order[t]];
+      }
+      std::copy_n(ordered, meshlet.triangles_n, indices.begin() + meshlet.first_triangle);
+    }
+  }
+
+  template <typename I>
+  static void BoundMeshlets(Mesh::Lod& lod, const std::vector<std::array<I, 3>>& indices, const VOV4& positions)
+  {
+    for (Meshlet& meshlet : lod.meshlets)
+    {
+      Bound(meshlet, positions, indices, lod.meshlet_vertices.data() + meshlet.first_vertex);
+    }
+  }
+
+  // The vertices a simplification must keep where they are, borders(edges of one triangle, or of more than two) and seams(other vertices are at the same position, so moving it would tear the surface open).
+  static std::vector<uint8_t> Locked(const std::vector<std::array<unsigned, 3>>& indices, const VOV4& positions)
+  {
+    std::vector<uint8_t> locked(positions.n(), 0);
+
+    std::vector<unsigned> by_position(positions.n());
+    for (unsigned v = 0; v < positions.n(); ++v)
+    {
+      by_position[v] = v;
+    }
+    auto key = [&](unsigned v) { return std::array<float, 3>{positions[v][0], positions[v][1], positions[v][2]}; };
+    std::sort(by_position.begin(), by_position.end(), [&](unsigned a, unsigned b) { return key(a) < key(b); });
+    for (unsigned i = 1; i < by_position.size(); ++i)
+    {
+      if (key(by_position[i - 1]) == key(by_position[i]))
+      {
+        locked[by_position[i - 1]] = locked[by_position[i]] = 1;
+      }
+    }
+
+    std::vector<std::array<unsigned, 2>> edges;
+    edges.reserve(indices.size() * 3);
+    for (const auto& tri : indices)
+    {
+      for (unsigned c = 0; c < 3; ++c)
+      {
+        unsigned a = tri[c], b = tri[(c + 1) % 3];
+        edges.push_back({std::min(a, b), std::max(a, b)});
+      }
+    }
+    std::sort(edges.begin(), edges.end());
+    for (unsigned i = 0, j; i < edges.size(); i = j)
+    {
+      for (j = i + 1; j < edges.size() && edges[j] == edges[i]; ++j);
+      if (j - i != 2)
+      {
+        locked[edges[i][0]] = locked[edges[i][1]] = 1;
+      }
+    }
+
+    return locked;
+  }
+
+  // The area weighted sum of squared distances to a set of planes, as the symmetric 4x4 matrix of Garland and Heckbert, evaluated at a point it's the error of moving the vertex there.
+  // Doubles since the terms cancel out a lot.
+  struct Quadric
+  {
+    double a2 = 0, ab = 0, ac = 0, ad = 0, b2 = 0, bc = 0, bd = 0, c2 = 0, cd = 0, d2 = 0;
+    double area = 0;
+
+    // `a`, `b` and `c` are a unit normal.
+    void AddPlane(double a, double b, double c, double d, double weight)
+    {
+      a2 += weight * a * a; ab += weight * a * b; ac += weight * a * c; ad += weight * a * d;
+      b2 += weight * b * b; bc += weight * b * c; bd += weight * b * d;
+      c2 += weight * c * c; cd += weight * c * d;
+      d2 += weight * d * d;
+      area += weight;
+    }
+
+    Quadric& operator+=(const Quadric& other)
+    {
+      a2 += other.a2; ab += other.ab; ac += other.ac; ad += other.ad;
+      b2 += other.b2; bc += other.bc; bd += other.bd;
+      c2 += other.c2; cd += other.cd;
+      d2 += other.d2;
+      area += other.area;
+      return *this;
+    }
+
+    double Error(double x, double y, double z) const
+    {
+      return a2 * x * x + 2 * ab * x * y + 2 * ac * x * z + 2 * ad * x
+        + b2 * y * y + 2 * bc * y * z + 2 * bd * y
+        + c2 * z * z + 2 * cd * z
+        + d2;
+    }
+  };
+
+  // One level of `Simplify()`.
+  struct Simplified
+  {
+    std::vector<std::array<unsigned, 3>> triangles;
+    // The biggest RMS distance of a collapse from the planes it merged, so far, a model space distance.
+    float error;
+  };
+
+  // Quadric error metric simplification(Garland and Heckbert 1997), halving the triangles again and again, each level goes on from the last with the quadrics it merged so the errors are still against the full mesh.
+  // Only half edge collapses, a vertex moves onto a neighbour, so the simpler levels use a subset of the vertices and share them with the full mesh.
+  // Stops after `levels_n` levels, once half would be under `min_triangles`, or when the `locked` vertices don't let a level get under 3/4 of the last.
+  static std::vector<Simplified> Simplify(const std::vector<std::array<unsigned, 3>>& indices, const VOV4& positions, const std::vector<uint8_t>& locked, unsigned levels_n, unsigned min_triangles)
+  {
+    std::vector<std::array<unsigned, 3>> triangles = indices;
+    std::vector<uint8_t> alive(triangles.size(), 1);
+    // Which triangles use each vertex, collapses move them along so it's not an `Adjacency`. Dead ones are skipped, not removed.
+    std::vector<std::vector<unsigned>> around(positions.n());
+    std::vector<Quadric> quadrics(positions.n());
+
+    auto position = [&](unsigned v, unsigned c) -> double { return positions[v][c]; };
+    for (unsigned t = 0; t < triangles.size(); ++t)
+    {
+      const auto& tri = triangles[t];
+      double e1[3], e2[3];
+      for (unsigned c = 0; c < 3; ++c)
+      {
+        e1[c] = position(tri[1], c) - position(tri[0], c);
+        e2[c] = position(tri[2], c) - position(tri[0], c);
+      }
+      double n[3] = {e1[1] * e2[2] - e1[2] * e2[1], e1[2] * e2[0] - e1[0] * e2[2], e1[0] * e2[1] - e1[1] * e2[0]};
+      double length = std::sqrt(n[0] * n[0] + n[1] * n[1] + n[2] * n[2]);
+
+      for (unsigned v : tri)
+      {
+        around[v].push_back(t);
+        if (length > 0)
+        {
+          quadrics[v].AddPlane(n[0] / length, n[1] / length, n[2] / length, -(n[0] * position(tri[0], 0) + n[1] * position(tri[0], 1) + n[2] * position(tri[0], 2)) / length, length / 2);
+        }
+      }
+    }
+
+    auto cost = [&](unsigned from, unsigned to) {
+      Quadric q = quadrics[from];
+      q += quadrics[to];
+      return q.Error(position(to, 0), position(to, 1), position(to, 2));
+    };
+
+    // Whether moving `from` onto `to` turns any of the triangles that stay around.
+    auto flips = [&](unsigned from, unsigned to) {
+      for (unsigned t : around[from])
+      {
+        const auto& tri = triangles[t];
+        if (!alive[t] || tri[0] == to || tri[1] == to || tri[2] == to)
+        {
+          continue;
+        }
+
+        double before[3], after[3];
+        for (unsigned moved = 0; moved < 2; ++moved)
+        {
+          double p[3][3];
+          for (unsigned i = 0; i < 3; ++i)
+          {
+            unsigned v = moved && tri[i] == from ? to : tri[i];
+            for (unsigned c = 0; c < 3; ++c)
+            {
+              p[i][c] = position(v, c);
+            }
+          }
+          double e1[3] = {p[1][0] - p[0][0], p[1][1] - p[0][1], p[1][2] - p[0][2]};
+          double e2[3] = {p[2][0] - p[0][0], p[2][1] - p[0][1], p[2][2] - p[0][2]};
+          double* n = moved ? after : before;
+          n[0] = e1[1] * e2[2] - e1[2] * e2[1];
+          n[1] = e1[2] * e2[0] - e1[0] * e2[2];
+          n[2] = e1[0] * e2[1] - e1[1] * e2[0];
+        }
+        // Not just turned over, turning more than ~75 degrees at once is too, since turns add up over collapses. Degenerate triangles stay put.
+        double dot = before[0] * after[0] + before[1] * after[1] + before[2] * after[2];
+        double lengths = std::sqrt((before[0] * before[0] + before[1] * before[1] + before[2] * before[2]) * (after[0] * after[0] + after[1] * after[1] + after[2] * after[2]));
+        if (dot <= 0.25 * lengths)
+        {
+          return true;
+        }
+      }
+      return false;
+    };
+
+    struct Collapse
+    {
+      double cost;
+      unsigned from, to;
+    };
+    std::vector<Collapse> collapses;
+    std::vector<uint8_t> touched(positions.n());
+
+    std::vector<Simplified> levels;
+    float error = 0.0f;
+    unsigned alive_n = triangles.size();
+    for (unsigned target = alive_n / 2; levels.size() < levels_n && target >= min_triangles; target = alive_n / 2)
+    {
+      unsigned before = alive_n;
+      // In passes, each takes the cheapest collapses that don't touch each other, then the costs are redone with the merged quadrics.
+      while (alive_n > target)
+      {
+        collapses.clear();
+        for (unsigned from = 0; from < positions.n(); ++from)
+        {
+          if (locked[from])
+          {
+            continue;
+          }
+          Collapse best = {0.0, from, ~0u};
+          for (unsigned t : around[from])
+          {
+            if (!alive[t])
+            {
+              continue;
+            }
+            for (unsigned to : triangles[t])
+            {
+              if (to == from)
+              {
+                continue;
+              }
+              double c = cost(from, to);
+              if (best.to == ~0u || c < best.cost)
+              {
+                best = {c, from, to};
+              }
+            }
+          }
+          if (best.to != ~0u)
+          {
+            collapses.push_back(best);
+          }
+        }
+        std::sort(collapses.begin(), collapses.end(), [](const Collapse& a, const Collapse& b) { return a.cost < b.cost; });
+
+        std::fill(touched.begin(), touched.end(), 0);
+        bool collapsed = false;
+        for (const Collapse& collapse : collapses)
+        {
+          if (alive_n <= target)
+          {
+            break;
+          }
+          if (touched[collapse.from] || touched[collapse.to] || flips(collapse.from, collapse.to))
+          {
+            continue;
+          }
+
+          for (unsigned t : around[collapse.from])
+          {
+            auto& tri = triangles[t];
+            if (!alive[t])
+            {
+              continue;
+            }
+            if (tri[0] == collapse.to || tri[1] == collapse.to || tri[2] == collapse.to)
+            {
+              alive[t] = 0;
+              --alive_n;
+              continue;
+            }
+            for (unsigned& v : tri)
+            {
+              v = v == collapse.from ? collapse.to : v;
+            }
+            around[collapse.to].push_back(t);
+          }
+          around[collapse.from].clear();
+          quadrics[collapse.to] += quadrics[collapse.from];
+
+          double area = quadrics[collapse.to].area;
+          if (area > 0)
+          {
+            error = std::max(error, static_cast<float>(std::sqrt(std::max(collapse.cost, 0.0) / area)));
+          }
+          touched[collapse.from] = touched[collapse.to] = 1;
+          collapsed = true;
+        }
+
+        if (!collapsed)
+        {
+          break;
+        }
+      }
+
+      if (alive_n > before * 3 / 4)
+      {
+        break;
+      }
+
+      Simplified level;
+      level.triangles.reserve(alive_n);
+      for (unsigned t = 0; t < triangles.size(); ++t)
+      {
+        if (alive[t])
+        {
+          level.triangles.push_back(triangles[t]);
+        }
+      }
+      level.error = error;
+      levels.push_back(std::move(level));
+    }
+    return levels;
+  }
+
+  std::vector<unsigned> Mesh::Optimize(VOV4& positions)
+  {
+    Lod& full = lods_[0];
+    std::vector<unsigned> remap(positions.n(), ~0u);
+    std::visit([&](auto& indices) {
+      using I = typename std::remove_reference_t<decltype(indices)>::value_type::value_type;
+
+      BuildMeshlets(full, indices, positions);
+      TipsifyMeshlets(full, indices, positions.n());
+
+      // Then the vertices go in the order the triangles first use them, so each meshlet's are mostly one run, and its batches few.
+      // The unused ones go last.
+      unsigned next = 0;
+      for (const auto& tri : indices)
+      {
+        for (unsigned v : tri)
+        {
+          if (remap[v] == ~0u)
+          {
+            remap[v] = next++;
+          }
+        }
+      }
+      for (unsigned& r : remap)
+      {
+        if (r == ~0u)
+        {
+          r = next++;
+        }
+      }
+
+      for (auto& tri : indices)
+      {
+        for (I& v : tri)
+        {
+          v = static_cast<I>(remap[v]);
+        }
+      }
+      for (unsigned& v : full.meshlet_vertices)
+      {
+        v = remap[v];
+      }
+      VOV4 original(positions);
+      for (unsigned v = 0; v < positions.n(); ++v)
+      {
+        positions[remap[v]] = original[v];
+      }
+
+      BoundMeshlets(full, indices, positions);
+    }, full.indices);
+
+    // Most meshes have under 65536 vertices, whatever width the file had they get the 16-bit indices.
+    if (auto* wide = std::get_if<std::vector<std::array<uint32_t, 3>>>(&full.indices); wide != nullptr && positions.n() <= 0x10000)
+    {
+      std::vector<std::array<uint16_t, 3>> narrow(wide->size());
+      for (unsigned t = 0; t < narrow.size(); ++t)
+      {
+        for (unsigned c = 0; c < 3; ++c)
+        {
+          narrow[t][c] = static_cast<uint16_t>((*wide)[t][c]);
+        }
+      }
+      full.indices = std::move(narrow);
+    }
+
+    // The simpler levels, until halving stops working or there is nothing left worth halving.
+    constexpr unsigned kMinTriangles = 64;
+    std::vector<std::array<unsigned, 3>> triangles;
+    std::visit([&](const auto& indices) {
+      for (const auto& tri : indices)
+      {
+        triangles.push_back({tri[0], tri[1], tri[2]});
+      }
+    }, full.indices);
+    std::vector<uint8_t> locked = Locked(triangles, positions);
+
+    for (Simplified& simpler : Simplify(triangles, positions, locked, kMaxLods - 1, kMinTriangles))
+    {
+      Lod lod;
+      lod.error = simpler.error;
+      // Same width as the full one.
+      std::visit([&](const auto& full_indices) {
+        std::remove_cvref_t<decltype(full_indices)> indices(simpler.triangles.size());
+        using I = typename decltype(indices)::value_type::value_type;
+        for (unsigned t = 0; t < indices.size(); ++t)
+        {
+          for (unsigned c = 0; c < 3; ++c)
+          {
+            indices[t][c] = static_cast<I>(simpler.triangles[t][c]);
+          }
+        }
+        BuildMeshlets(lod, indices, positions);
+        TipsifyMeshlets(lod, indices, positions.n());
+        BoundMeshlets(lod, indices, positions);
+        lod.indices = std::move(indices);
+      }, lods_[0].indices);
+      lods_.push_back(std::move(lod));
+    }
+
+    batch_marks_.assign((positions.n() + VOV4::kBatch - 1) / VOV4::kBatch, 0);
+    return remap;
+  }
+
+  void Mesh::CullMeshlets(Instance& instance, const Frustum* frustum, const V4& eye, bool cones, float grow)
+  {
+    instance.visible_meshlets.clear();
+    instance.batches.clear();
+
+    const Lod& lod = lods_[instance.lod];
+    for (unsigned i = 0; i < lod.meshlets.size(); ++i)
+    {
+      const Meshlet& meshlet = lod.meshlets[i];
+      if (frustum != nullptr && !frustum->Intersects(Sphere(meshlet.sphere.center, meshlet.sphere.radius + grow)))
+      {
+        continue;
+      }
+      if (cones && grow == 0.0f && meshlet.cutoff <= 1.0f)
+      {
+        V4 view = meshlet.apex;
+        view -= eye;
+        // Both have w 1, the difference has 0.
+        if (view.DotProduct(meshlet.axis) >= meshlet.cutoff * view.magnitude3())
+        {
+          continue;
+        }
+      }
+
+      instance.visible_meshlets.push_back(i);
+      for (unsigned v = 0; v < meshlet.vertices_n; ++v)
+      {
+        batch_marks_[lod.meshlet_vertices[meshlet.first_vertex + v] / VOV4::kBatch] = 1;
+      }
+    }
+
+    for (unsigned batch = 0; batch < batch_marks_.size(); ++batch)
+    {
+      if (batch_marks_[batch])
+      {
+        instance.batches.push_back(batch);
+        batch_marks_[batch] = 0;
+      }
+    }
+  }
+
+  void Mesh::Morph(const Instance& instance, const float* weights, VOV4& positions, VOV4* normals, unsigned from, unsigned to) const noexcept
+  {
+    if (normals_.n() == 0)
+    {
+      normals = nullptr;
+    }
+
+    // The base first, then every target on top of it. Only the active ones, so it costs what is actually moving, not how many targets there are.
+    std::copy(vertices_.begin() + from, vertices_.begin() + to, positions.begin() + from);
+    if (normals != nullptr)
+    {
+      std::copy(normals_.begin() + from, normals_.begin() + to, normals->begin() + from);
+    }
+
+    for (unsigned t : instance.active_targets)
+    {
+      const Target& target = targets_[t];
+      if (target.indices.empty())
+      {
+        if (target.positions.n() > 0)
+        {
+          positions.AddScaled(positions, target.positions, weights[t], from, to);
+        }
+        if (normals != nullptr && target.normals.n() > 0)
+        {
+          normals->AddScaled(*normals, target.normals, weights[t], from, to);
+        }
+        continue;
+      }
+
+      // Only the deltas of the vertices in range.
+      unsigned first = std::lower_bound(target.indices.begin(), target.indices.end(), from) - target.indices.begin();
+      unsigned last = std::lower_bound(target.indices.begin() + first, target.indices.end(), to) - target.indices.begin();
+      if (target.positions.n() > 0)
+      {
+        positions.ScatterAddScaled(target.indices.data(), target.positions, weights[t], first, last);
+      }
+      if (normals != nullptr && target.normals.n() > 0)
+      {
+        normals->ScatterAddScaled(target.indices.data(), target.normals, weights[t], first, last);
+      }
+    }
+
+    if (normals != nullptr)
+    {
+      normals->Normalize(*normals, VOV4::Precision::kPrecise, from, to);
+    }
+  }
+}
@@ -3,13 +3,15 @@
 #include "Thread.hpp"
 
 #include <iostream>
+#include <algorithm>
+#include <immintrin.h>
 
 namespace nogl
 {
   // Various wizard statics.
-  Scene* Wizard::scene = nullptr;
   bool Wizard::alive = true;
   uint8_t Wizard::minions_n_ = 0;
+  std::vector<Wizard::Job> Wizard::jobs_;
   Bell Wizard::begin_bells_[2];
   std::unique_ptr<Bell[]> Wizard::done_bells_;
 
@@ -33,7 +35,7 @@ namespace nogl
       Wizard::alive = false;
       Wizard::begin_bells_[0].Ring();
       Wizard::begin_bells_[1].Ring();
-      delete m;
+      delete [] m;
       
       Logger::Begin() << "Minions closed." << Logger::End();
     });
@@ -66,11 +68,142 @@ namespace nogl
   }
   void Wizard::WaitDone()
   {
+    // Without minions the main thread does it all.
+    if (Wizard::minions_n_ == 0)
+    {
+      Work(0);
+    }
     Bell::MultiWait(Wizard::done_bells_.get(), Wizard::minions_n_);
     for (unsigned i = 0; i < Wizard::minions_n_; ++i)
     {
       Wizard::done_bells_[i].Reset();
     }
+    jobs_.clear();
+  }
+
+  unsigned Wizard::Submit(Function function, void* data, unsigned n, unsigned grain, std::initializer_list<unsigned> after)
+  {
+    for (unsigned a : after)
+    {
+      if (a >= jobs_.size())
+      {
+        throw IndexException("A job can only wait for jobs submitted before it.");
+      }
+    }
+
+    grain = std::max(grain, 1u);
+    // Without minions the main thread runs it all, as minion 0.
+    unsigned slices_n = std::max<unsigned>(Wizard::minions_n_, 1);
+    unsigned chunks_n = (n + grain - 1) / grain;
+    jobs_.push_back({function, data, n, grain, after, std::unique_ptr<Slice[]>(new Slice[slices_n]), n});
+    for (unsigned i = 0; i < slices_n; ++i)
+    {
+      uint64_t begin = chunks_n * i / slices_n, end = chunks_n * (i + 1) / slices_n;
+      jobs_.back().slices[i].chunks.Store(begin | end << 32, Atomic<uint64_t>::Order::kRelaxed);
+    }
+    return jobs_.size() - 1;
+  }
+
+  bool Wizard::Take(Job& job, unsigned self, unsigned& chunk)
+  {
+    using Order = Atomic<uint64_t>::Order;
+    unsigned slices_n = std::max<unsigned>(Wizard::minions_n_, 1);
+
+    // Own ones from the front, in order, the neighbouring chunks are usually neighbouring memory.
+    Atomic<uint64_t>& own = job.slices[self].chunks;
+    uint64_t chunks = own.Load(Order::kAcquire);
+    while (static_cast<uint32_t>(chunks) < chunks >> 32)
+    {
+      if (own.CompareExchange(&chunks, chunks + 1, true, Order::kAcqRel, Order::kAcquire))
+      {
+        chunk = static_cast<uint32_t>(chunks);
+        return true;
+      }
+    }
+
+    // Out of them, half of the back of whoever has the most left, so a thief doesn't come back for every chunk.
+    while (true)
+    {
+      unsigned victim = self, most = 0;
+      for (unsigned i = 1; i < slices_n; ++i)
+      {
+        unsigned other = (self + i) % slices_n;
+        chunks = job.slices[other].chunks.Load(Order::kAcquire);
+        unsigned left = (chunks >> 32) - static_cast<uint32_t>(chunks);
+        if (left > most)
+        {
+          victim = other;
+          most = left;
+        }
+      }
+      if (most == 0)
+      {
+        return false;
+      }
+
+      Atomic<uint64_t>& stolen = job.slices[victim].chunks;
+      chunks = stolen.Load(Order::kAcquire);
+      while (static_cast<uint32_t>(chunks) < chunks >> 32)
+      {
+        uint64_t begin = static_cast<uint32_t>(chunks), end = chunks >> 32;
+        uint64_t take = (end - begin + 1) / 2;
+        if (stolen.CompareExchange(&chunks, begin | (end - take) << 32, true, Order::kAcqRel, Order::kAcquire))
+        {
+          // The first is ours, the rest go in our empty slice, where others may steal them in turn. No one touches an empty slice, so a store will do.
+          chunk = end - take;
+          own.Store((end - take + 1) | end << 32, Order::kRelease);
+          return true;
+        }
+      }
+      // Someone was faster, look again.
+    }
+  }
+
+  void Wizard::Work(unsigned self)
+  {
+    using Order = Atomic<unsigned>::Order;
+    while (true)
+    {
+      bool all_done = true, ran = false;
+      // From the first job every time, the earlier ones are usually what the later ones wait for.
+      for (Job& job : jobs_)
+      {
+        if (job.left.Load(Order::kAcquire) == 0)
+        {
+          continue;
+        }
+        all_done = false;
+
+        if (!std::all_of(job.after.begin(), job.after.end(), [](unsigned a) { return jobs_[a].left.Load(Order::kAcquire) == 0; }))
+        {
+          continue;
+        }
+
+        // All taken, someone else is finishing it.
+        unsigned chunk;
+        if (!Take(job, self, chunk))
+        {
+          continue;
+        }
+        unsigned from = chunk * job.grain;
+        unsigned to = std::min(from + job.grain, job.n);
+        job.function(job.data, from, to);
+        // Releases what it wrote to whoever sees the job done.
+        job.left.FetchSub(to - from, Order::kAcqRel);
+        ran = true;
+        break;
+      }
+
+      if (all_done)
+      {
+        return;
+      }
+      // Only waiting on others, don't hog the core from an SMT sibling that is doing the work.
+      if (!ran)
+      {
+        _mm_pause();
+      }
+    }
   }
 
   void Minion::WaitBegin()
@@ -94,41 +227,8 @@ namespace nogl
       {
         break;
       }
-      
-      if (Wizard::scene != nullptr && Wizard::scene->main_camera_node != nullptr)
-      {
-        for (auto& mesh : Wizard::scene->meshes_)
-        {
-          VOV4& in_vov = mesh.vertices_;
-          VOV4& out_vov = mesh.vertices_projected_;
-
-          // Calculate how many vectors in a chunk, no rounding
-          unsigned chunk_size = in_vov.n() / Wizard::minions_n_;
-          
-          // Round it up to how the vectors per 256 bits
-          unsigned v4_per_256 = in_vov.kAlign / sizeof (V4);
-          chunk_size /= v4_per_256;
-          chunk_size *= v4_per_256;
-
-          // Determining the `from` and `to`, in the vov4
-          unsigned from = chunk_size * index;
-          unsigned to;
-          // The last minion will need to deal with rounding from the fiasco before 
-          if (index == Wizard::minions_n_ - 1)
-          {
-            to = in_vov.n();
-          }
-          else
-          {
-            to = from + chunk_size;
-          }
-
-          // Now for multiplication
-          const M4x4& matrix = std::get<Camera*>(Wizard::scene->main_camera_node->data())->matrix();
-          in_vov.Multiply(out_vov, matrix, from, to);
-          out_vov.DivideByW(out_vov, from, to);
-        }
-      }
+
+      Wizard::Work(index);
 
       RingDone();
     }
@@ -136,4 +236,3 @@ namespace nogl
     return 0;
   }
 }
-
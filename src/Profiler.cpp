@@ -0,0 +1,89 @@
+#include "Profiler.hpp"
+#include "Thread.hpp"
+#include "Exception.hpp"
+
+#include <cstdio>
+
+namespace nogl
+{
+  bool Profiler::enabled = true;
+  Atomic<Profiler::Buffer*> Profiler::buffers_[Profiler::kThreadsN];
+  std::unique_ptr<Profiler::Buffer> Profiler::owned_[Profiler::kThreadsN];
+
+  void Profiler::Record(const char* name, unsigned long long begin, unsigned long long end)
+  {
+    if (!enabled || Thread::index() >= kThreadsN)
+    {
+      return;
+    }
+
+    // Only this thread ever writes to its own slot, so no need for anything fancier.
+    static thread_local Buffer* buffer = nullptr;
+    if (buffer == nullptr)
+    {
+      owned_[Thread::index()].reset(new Buffer);
+      buffer = owned_[Thread::index()].get();
+      buffers_[Thread::index()].Store(buffer, Atomic<Buffer*>::Order::kRelease);
+    }
+
+    unsigned n = buffer->n.Load(Atomic<unsigned>::Order::kRelaxed);
+    buffer->events[n % kEventsN] = {name, begin, end};
+    // Publish the event only after it is fully written.
+    buffer->n.Store(n + 1, Atomic<unsigned>::Order::kRelease);
+  }
+
+  void Profiler::ExportChromeTrace(const char* path)
+  {
+    FILE* f = fopen(path, "w");
+    if (f == nullptr)
+    {
+      throw OpenException("Opening trace file.");
+    }
+
+    // Relative to the earliest event, so the timestamps stay readable.
+    unsigned long long t0 = ~0ull;
+    for (unsigned t = 0; t < kThreadsN; ++t)
+    {
+      Buffer* buffer = buffers_[t].Load(Atomic<Buffer*>::Order::kAcquire);
+      if (buffer == nullptr)
+      {
+        continue;
+      }
+      unsigned n = buffer->n.Load(Atomic<unsigned>::Order::kAcquire);
+      unsigned first = n > kEventsN ? n - kEventsN : 0;
+      for (unsigned i = first; i < n; ++i)
+      {
+        t0 = std::min(t0, buffer->events[i % kEventsN].begin);
+      }
+    }
+
+    fputs("{\"displayTimeUnit\":\"ns\",\"traceEvents\":[\n", f);
+    bool first_event = true;
+    for (unsigned t = 0; t < kThreadsN; ++t)
+    {
+      Buffer* buffer = buffers_[t].Load(Atomic<Buffer*>::Order::kAcquire);
+      if (buffer == nullptr)
+      {
+        continue;
+      }
+
+      // Same naming as the `Logger`.
+      fprintf(f, "%s{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":0,\"tid\":%u,\"args\":{\"name\":\"TH%u\"}}",
+        first_event ? "" : ",\n", t, t);
+      first_event = false;
+
+      unsigned n = buffer->n.Load(Atomic<unsigned>::Order::kAcquire);
+      unsigned first = n > kEventsN ? n - kEventsN : 0;
+      for (unsigned i = first; i < n; ++i)
+      {
+        const Event& e = buffer->events[i % kEventsN];
+        // Chrome wants microseconds, the fraction keeps the nanoseconds.
+        fprintf(f, ",\n{\"name\":\"%s\",\"ph\":\"X\",\"pid\":0,\"tid\":%u,\"ts\":%.3f,\"dur\":%.3f}",
+          e.name, t, (e.begin - t0) / 1000.0, (e.end - e.begin) / 1000.0);
+      }
+    }
+    fputs("\n]}\n", f);
+
+    fclose(f);
+  }
+}
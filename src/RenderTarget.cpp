@@ -0,0 +1,250 @@
+#include <immintrin.h>
+
+#include "Atomic.hpp"
+#include "math.hpp"
+#include "RenderTarget.hpp"
+#include "Simd.hpp"
+
+#include <cstdlib>
+#include <iostream>
+
+namespace nogl
+{
+  RenderTarget::RenderTarget(unsigned width, unsigned height, bool depth)
+  {
+    width_ = width;
+    height_ = height;
+
+    // Padded to whole __m256i so `Clear()` doesn't need a tail.
+    unsigned size = (width_ * height_ * 4 + sizeof (__m256i) - 1) & ~(sizeof (__m256i) - 1);
+    owned_data_ = std::unique_ptr<uint8_t[]>(
+      new (std::align_val_t(sizeof (__m256i))) uint8_t[size]()
+    );
+    data_ = owned_data_.get();
+
+    if (depth)
+    {
+      AllocateZ();
+    }
+  }
+
+  RenderTarget::RenderTarget(Image& image, bool depth)
+  {
+    width_ = image.width();
+    height_ = image.height();
+    // Image data is aligned and padded the same way.
+    data_ = image.data();
+
+    if (depth)
+    {
+      AllocateZ();
+    }
+  }
+
+  void RenderTarget::AllocateZ()
+  {
+    // Allocate aligned to __m256, padded for `ClearZ()`.
+    unsigned n = (width_ * height_ + 7) & ~7u;
+    zdata_ = std::unique_ptr<float[]>(
+      new (std::align_val_t(sizeof (__m256))) float[n]
+    );
+  }
+
+  void RenderTarget::Clear() noexcept
+  {
+    Simd::kernels().fill32(reinterpret_cast<uint32_t*>(data()), clear_color_, width() * height());
+  }
+  void RenderTarget::set_clear_color(uint8_t b, uint8_t g, uint8_t r) noexcept
+  {
+    // Little endian, so B is the lowest byte.
+    clear_color_ = b | (g << 8) | (r << 16);
+  }
+
+  void RenderTarget::ClearZ() noexcept
+  {
+    if (zdata_ == nullptr)
+    {
+      return;
+    }
+
+    Simd::kernels().fill_float(zdata(), 1.0f, width() * height());
+  }
+
+  // `copy_x` is the "offset" in the image.
+  // `copy_width` is the actual row size(in pixels) to be copied.
+  static void CalculateCopyInfo(unsigned& copy_x, unsigned& copy_width, unsigned i_width_, int x, unsigned width_)
+  {
+    if (x < 0)
+    {
+      copy_x = -x;
+    }
+    else
+    {
+      copy_x = 0;
+    }
+
+    if (x + i_width_ >= width_)
+    {
+      copy_width = width_ - x;
+    }
+    else
+    {
+      copy_width = i_width_;
+    }
+  }
+
+  void RenderTarget::PutImage(const Image& i, int x, int y)
+  {
+    if (x >= (long long)width_ || y >= (long long)height_)
+    {
+      return;
+    }
+
+    unsigned copy_width=0, copy_x=0;
+    CalculateCopyInfo(copy_x, copy_width, i.width(), x, width_);
+
+    unsigned copy_height=0, copy_y=0;
+    CalculateCopyInfo(copy_y, copy_height, i.height(), y, height_);
+
+    unsigned x_start = std::max(x, 0);
+    unsigned y_start = std::max(y, 0);
+    for (unsigned y = y_start, iy = copy_y; iy < copy_height; ++y, ++iy)
+    {
+      if (copy_x < copy_width)
+      {
+        Simd::kernels().blend_row(
+          &data_[(x_start + y * width_) * 4],
+          &i.data()[(copy_x + iy * i.width()) * 4],
+          copy_width - copy_x
+        );
+      }
+
+      // memcpy(
+      //   data_ + (x_start + y * width_) * 4, 
+      //   i.data() + (copy_x + copy_y * i.width()) * 4,
+      //   copy_width * 4
+      // );
+    }
+  }
+
+  // What both `PutTriangle()`s start from, the bounding rectangle clipped to the target, and the half space functions of the edges.
+  struct TriangleSetup
+  {
+    int min_x, min_y, max_x, max_y;
+    // Edge `i` is `I[i]*x + J[i]*y + K[i]`, inside where it's not negative. `f` are the edges at [min_x, min_y].
+    int I[3], J[3], K[3], f[3];
+  };
+
+  static TriangleSetup SetupTriangle(int ax, int ay, int bx, int by, int cx, int cy, unsigned width, unsigned height)
+  {
+    TriangleSetup t;
+
+    // Finding the triangle rectangle
+    FindMinMax(t.min_x, t.max_x, ax, bx, cx);
+    FindMinMax(t.min_y, t.max_y, ay, by, cy);
+
+    // Clipping the rectangle
+    t.min_x = ClipValue(t.min_x, 0, (int)width-1);
+    t.min_y = ClipValue(t.min_y, 0, (int)height-1);
+    t.max_x = ClipValue(t.max_x, 0, (int)width-1);
+    t.max_y = ClipValue(t.max_y, 0, (int)height-1);
+
+    // Half space function constants
+    t.I[0] = ay - by;
+    t.J[0] = bx - ax;
+    t.K[0] = ax*by - ay*bx;
+
+    t.I[1] = by - cy;
+    t.J[1] = cx - bx;
+    t.K[1] = bx*cy - by*cx;
+
+    t.I[2] = cy - ay;
+    t.J[2] = ax - cx;
+    t.K[2] = cx*ay - cy*ax;
+
+    // Initial(and future) evaluations of the edge functions
+    for (unsigned i = 0; i < 3; ++i)
+    {
+      t.f[i] = t.I[i]*t.min_x + t.J[i]*t.min_y + t.K[i];
+    }
+    return t;
+  }
+
+  void RenderTarget::PutTriangle(
+    float _ax, float _ay, float az,
+    float _bx, float _by, float bz,
+    float _cx, float _cy, float cz
+  )
+  {
+    int ax=_ax,bx=_bx,cx=_cx;
+    int ay=_ay,by=_by,cy=_cy;
+    std::srand(ax * bx * cx);
+
+    uint8_t r = std::rand(), g = std::rand(), b = std::rand();
+    const uint32_t bgrx = b | (g << 8) | (r << 16);
+
+    TriangleSetup t = SetupTriangle(ax, ay, bx, by, cx, cy, width_, height_);
+
+    // Actual loop, increment by Ji every time, the rows themselves are stepped by Ii in `Simd::Kernels::raster_row`
+    for (int y = t.min_y; y <= t.max_y; ++y, t.f[0] += t.J[0], t.f[1] += t.J[1], t.f[2] += t.J[2])
+    {
+      Simd::kernels().raster_row(
+        reinterpret_cast<uint32_t*>(data_) + y * width_ + t.min_x,
+        zdata_ == nullptr ? nullptr : zdata_.get() + y * width_ + t.min_x,
+        t.max_x - t.min_x + 1, t.f, t.I, az, bgrx
+      );
+    }
+  }
+
+  void RenderTarget::PutTriangle(
+    const V4& a, const V4& b, const V4& c,
+    const float uv_a[2], const float uv_b[2], const float uv_c[2],
+    const Image& texture
+  )
+  {
+    TriangleSetup t = SetupTriangle(a[0], a[1], b[0], b[1], c[0], c[1], width_, height_);
+
+    // The edge functions always add up to twice the area, nothing is inside if it's not positive.
+    const int area = t.K[0] + t.K[1] + t.K[2];
+    if (area <= 0)
+    {
+      return;
+    }
+    const float inv_area = 1.0f / area;
+
+    // z, 1/w, u/w and v/w at a, b and c, `a[3]` is already 1/w.
+    const float attributes[4][3] = {
+      {a[2], b[2], c[2]},
+      {a[3], b[3], c[3]},
+      {uv_a[0] * a[3], uv_b[0] * b[3], uv_c[0] * c[3]},
+      {uv_a[1] * a[3], uv_b[1] * b[3], uv_c[1] * c[3]},
+    };
+    // The barycentric weights of a, b and c are the edges opposite to them(1, 2 and 0) over the area, so the attributes step by a constant per pixel too.
+    float linear[4], linear_dx[4], linear_dy[4];
+    for (unsigned i = 0; i < 4; ++i)
+    {
+      linear[i] = (t.f[1] * attributes[i][0] + t.f[2] * attributes[i][1] + t.f[0] * attributes[i][2]) * inv_area;
+      linear_dx[i] = (t.I[1] * attributes[i][0] + t.I[2] * attributes[i][1] + t.I[0] * attributes[i][2]) * inv_area;
+      linear_dy[i] = (t.J[1] * attributes[i][0] + t.J[2] * attributes[i][1] + t.J[0] * attributes[i][2]) * inv_area;
+    }
+
+    const uint32_t* texels = reinterpret_cast<const uint32_t*>(texture.data());
+    for (int y = t.min_y; y <= t.max_y; ++y)
+    {
+      Simd::kernels().raster_row_textured(
+        reinterpret_cast<uint32_t*>(data_) + y * width_ + t.min_x,
+        zdata_ == nullptr ? nullptr : zdata_.get() + y * width_ + t.min_x,
+        t.max_x - t.min_x + 1, t.f, t.I, linear, linear_dx, texels, texture.width(), texture.height()
+      );
+
+      for (unsigned i = 0; i < 3; ++i)
+      {
+        t.f[i] += t.J[i];
+      }
+      for (unsigned i = 0; i < 4; ++i)
+      {
+        linear[i] += linear_dy[i];
+      }
+    }
+  }
+}
@@ -0,0 +1,135 @@
+#include "ResolutionScaler.hpp"
+#include "math.hpp"
+
+#include <cmath>
+#include <cstring>
+
+namespace nogl
+{
+  ResolutionScaler::ResolutionScaler(unsigned width, unsigned height, float min_scale)
+  {
+    width_ = width;
+    height_ = height;
+    min_scale_ = ClipValue(min_scale, 0.1f, 1.0f);
+
+    x0_.reset(new unsigned[width_]);
+    wx_.reset(new int16_t[width_]);
+
+    Resize();
+  }
+
+  void ResolutionScaler::set_clear_color(uint8_t b, uint8_t g, uint8_t r)
+  {
+    clear_color_[0] = b;
+    clear_color_[1] = g;
+    clear_color_[2] = r;
+    target_->set_clear_color(b, g, r);
+  }
+
+  bool ResolutionScaler::Update(float frame_time, float target_frame_time)
+  {
+    // Timers can give 0ms on fast frames, which makes no sense for the log below.
+    frame_time = std::max(frame_time, 0.1f);
+    if (frame_time_ == 0.0f)
+    {
+      frame_time_ = frame_time;
+    }
+    frame_time_ += (frame_time - frame_time_) * kSmoothing;
+
+    // Frame times still reflect the old resolution, acting on them now would overshoot.
+    if (cooldown_ > 0)
+    {
+      --cooldown_;
+      return false;
+    }
+
+    // Cost is roughly proportional to the pixels, so to the scale squared, hence the half.
+    float error = 0.5f * logf(target_frame_time * kHeadroom / frame_time_);
+    if (fabsf(error) > kDeadband)
+    {
+      // The desired scale itself is the integrator, we just push it by the error.
+      desired_scale_ = ClipValue(desired_scale_ * expf(error * kGain), min_scale_, 1.0f);
+    }
+
+    if (ScaledWidth(desired_scale_) == target_->width())
+    {
+      return false;
+    }
+
+    scale_ = desired_scale_;
+    Resize();
+    cooldown_ = kCooldown;
+    return true;
+  }
+
+  unsigned ResolutionScaler::ScaledWidth(float scale) const
+  {
+    unsigned w = (static_cast<unsigned>(width_ * scale) / kGranularity) * kGranularity;
+    // The last step up is the output's own width, which may not be a multiple of `kGranularity`, otherwise full scale is never reached.
+    if (w + kGranularity > width_)
+    {
+      w = width_;
+    }
+    return ClipValue(w, std::min(kGranularity, width_), width_);
+  }
+
+  void ResolutionScaler::Resize()
+  {
+    unsigned w = ScaledWidth(scale_);
+    unsigned h = std::max(2u, static_cast<unsigned>(height_ * (static_cast<float>(w) / width_)));
+    h = std::min(h, height_);
+    scale_ = static_cast<float>(w) / width_;
+
+    target_.reset(new RenderTarget(w, h, true));
+    target_->set_clear_color(clear_color_[0], clear_color_[1], clear_color_[2]);
+
+    // Pixel centers of the output mapped onto the source.
+    float sx = static_cast<float>(w) / width_;
+    for (unsigned x = 0; x < width_; ++x)
+    {
+      float fx = ClipValue((x + 0.5f) * sx - 0.5f, 0.0f, static_cast<float>(w - 1));
+      unsigned x0 = std::min(static_cast<unsigned>(fx), w - 2);
+      x0_[x] = x0;
+      wx_[x] = std::min(32767.0f, (fx - x0) * 32768.0f);
+    }
+  }
+
+  void ResolutionScaler::Upscale(RenderTarget& output) const
+  {
+    const RenderTarget& input = *target_;
+    const unsigned w = input.width(), h = input.height();
+    const float sy = static_cast<float>(h) / height_;
+
+    // At full scale it's just a copy.
+    if (w == width_ && h == height_)
+    {
+      memcpy(output.data(), input.data(), w * h * 4);
+      return;
+    }
+
+    for (unsigned y = 0; y < height_; ++y)
+    {
+      float fy = ClipValue((y + 0.5f) * sy - 0.5f, 0.0f, static_cast<float>(h - 1));
+      unsigned y0 = std::min(static_cast<unsigned>(fy), h - 2);
+      __m128i wy = _mm_set1_epi16(std::min(32767.0f, (fy - y0) * 32768.0f));
+
+      const uint8_t* top = input.data() + y0 * w * 4;
+      const uint8_t* bottom = top + w * 4;
+      uint32_t* out = reinterpret_cast<uint32_t*>(output.data() + y * width_ * 4);
+
+      for (unsigned x = 0; x < width_; ++x)
+      {
+        // Both neighbours, as 16 bit components, [left BGRX, right BGRX].
+        __m128i t = _mm_cvtepu8_epi16(_mm_loadl_epi64(reinterpret_cast<const __m128i*>(top + x0_[x] * 4)));
+        __m128i b = _mm_cvtepu8_epi16(_mm_loadl_epi64(reinterpret_cast<const __m128i*>(bottom + x0_[x] * 4)));
+
+        // Vertical, then horizontal, `_mm_mulhrs_epi16()` is a rounded (a*b)>>15 which is exactly a lerp weight of 0-1.
+        __m128i v = _mm_add_epi16(t, _mm_mulhrs_epi16(_mm_sub_epi16(b, t), wy));
+        __m128i right = _mm_unpackhi_epi64(v, v);
+        __m128i c = _mm_add_epi16(v, _mm_mulhrs_epi16(_mm_sub_epi16(right, v), _mm_set1_epi16(wx_[x])));
+
+        out[x] = _mm_cvtsi128_si32(_mm_packus_epi16(c, c));
+      }
+    }
+  }
+}
@@ -1,12 +1,187 @@
 #include "Scene.hpp"
+#include "Minion.hpp"
 #include "Logger.hpp"
+#include "Profiler.hpp"
 #include "endian.hpp"
 
+#include <algorithm>
+#include <cmath>
 #include <fstream>
 
 namespace nogl
 {
-  Scene::Scene(const char* path, Context& ctx)
+  // How many vertices are morphed and skinned before they are projected, the deformed positions and normals(8KB per step) stay in L1.
+  static constexpr unsigned kDeformChunk = 16 * VOV4::kBatch;
+  // What a batch of `SubmitProjection()` touches at most, the positions in and out, the outcodes, and the morphed and skinned positions and normals.
+  static constexpr unsigned kProjectBatchBytes = VOV4::kBatch * (2 * sizeof (V4) + 1 + 4 * sizeof (V4));
+
+  // The size of an accessor's component, 0 if `component_type` is not one attributes can have.
+  static unsigned ComponentSize(unsigned component_type)
+  {
+    switch (component_type)
+    {
+      case 5120: // byte
+      case 5121: // unsigned byte
+      return 1;
+      case 5122: // short
+      case 5123: // unsigned short
+      return 2;
+      case 5126: // float
+      return 4;
+    }
+    return 0;
+  }
+
+  // Component `i` of the element at `element` as a float. KHR_mesh_quantization allows integer components,
+  // `normalized` ones map to -1..1(signed) or 0..1(unsigned) like glTF says, the rest are taken as they are.
+  static float ReadComponent(const char* element, unsigned i, unsigned component_type, bool normalized)
+  {
+    // Elements are only aligned to their component size, memcpy it is.
+    switch (component_type)
+    {
+      case 5120:
+      {
+        int8_t c;
+        memcpy(&c, element + i * sizeof (c), sizeof (c));
+        return normalized ? std::max(c / 127.0f, -1.0f) : c;
+      }
+      case 5121:
+      {
+        uint8_t c;
+        memcpy(&c, element + i * sizeof (c), sizeof (c));
+        return normalized ? c / 255.0f : c;
+      }
+      case 5122:
+      {
+        int16_t c;
+        memcpy(&c, element + i * sizeof (c), sizeof (c));
+        c = LilE(c);
+        return normalized ? std::max(c / 32767.0f, -1.0f) : c;
+      }
+      case 5123:
+      {
+        uint16_t c;
+        memcpy(&c, element + i * sizeof (c), sizeof (c));
+        c = LilE(c);
+        return normalized ? c / 65535.0f : c;
+      }
+      default:
+      {
+        float c;
+        memcpy(&c, element + i * sizeof (c), sizeof (c));
+        return c;
+      }
+    }
+  }
+
+  // Every element of an accessor as `V4`s, one per element, or 4 per `MAT4` element(its columns), the components it doesn't have are 0.
+  // Float or normalized integer components, unless `integers`, joints are indices and neither.
+  // Interleaved accessors share a buffer view, hence the stride. Accessors without a buffer view are all 0s,
+  // and `sparse` ones get their values on top, like glTF says, morph targets are often like that.
+  static std::vector<V4> ReadAccessor(JSON::Node& jsonr, const char* bin_chunk, JSON::Node& accessor, bool integers = false)
+  {
+    static const char* const kTypes[] = {"SCALAR", "VEC2", "VEC3", "VEC4", "MAT4"};
+    static const unsigned kComponentsN[] = {1, 2, 3, 4, 16};
+    unsigned components_n = 0;
+    for (unsigned i = 0; i < 5; ++i)
+    {
+      if (accessor["type"].string() == kTypes[i])
+      {
+        components_n = kComponentsN[i];
+      }
+    }
+
+    unsigned component_type = accessor["componentType"].number();
+    unsigned component_size = ComponentSize(component_type);
+    bool normalized = accessor.PointNode("normalized") != nullptr && accessor["normalized"].boolean();
+    if (
+      components_n == 0 || component_size == 0
+      || (component_type != 5126 && !normalized && !integers)
+      // Integer matrices pad their columns to 4 bytes, nothing here needs them.
+      || (components_n == 16 && component_type != 5126)
+    )
+    {
+      throw ReadException("Bad accessor type/componentType.");
+    }
+    unsigned vectors_n = (components_n + 3) / 4;
+
+    std::vector<V4> vectors(static_cast<unsigned>(accessor["count"].number()) * vectors_n, V4(0.0f));
+    // Component `c` of an element goes to vector `c / 4` of it.
+    auto read_element = [&](const char* element, unsigned index)
+    {
+      for (unsigned c = 0; c < components_n; ++c)
+      {
+        vectors[index * vectors_n + c / 4][c % 4] = ReadComponent(element, c, component_type, normalized);
+      }
+    };
+
+    if (accessor.PointNode("bufferView") != nullptr)
+    {
+      auto& buffer_view = jsonr["bufferViews"][accessor["bufferView"].number()];
+      unsigned byte_offset = buffer_view.PointNode("byteOffset") != nullptr ? buffer_view["byteOffset"].number() : 0;
+      if (accessor.PointNode("byteOffset") != nullptr)
+      {
+        byte_offset += accessor["byteOffset"].number();
+      }
+      unsigned byte_stride = buffer_view.PointNode("byteStride") != nullptr ? buffer_view["byteStride"].number() : component_size * components_n;
+
+      for (unsigned i = 0; i < vectors.size() / vectors_n; ++i)
+      {
+        read_element(bin_chunk + byte_offset + i * byte_stride, i);
+      }
+    }
+
+    if (auto* sparse = accessor.PointNode("sparse"); sparse != nullptr)
+    {
+      auto& json_indices = (*sparse)["indices"];
+      auto& json_values = (*sparse)["values"];
+      unsigned index_type = json_indices["componentType"].number();
+      unsigned index_size = index_type == 5125 ? 4 : ComponentSize(index_type);
+      if (index_type != 5121 && index_type != 5123 && index_type != 5125)
+      {
+        throw ReadException("Bad sparse accessor indices componentType.");
+      }
+
+      // Both tightly packed.
+      auto& indices_view = jsonr["bufferViews"][json_indices["bufferView"].number()];
+      const char* indices = bin_chunk + static_cast<unsigned>(indices_view.PointNode("byteOffset") != nullptr ? indices_view["byteOffset"].number() : 0);
+      if (json_indices.PointNode("byteOffset") != nullptr)
+      {
+        indices += static_cast<unsigned>(json_indices["byteOffset"].number());
+      }
+      auto& values_view = jsonr["bufferViews"][json_values["bufferView"].number()];
+      const char* values = bin_chunk + static_cast<unsigned>(values_view.PointNode("byteOffset") != nullptr ? values_view["byteOffset"].number() : 0);
+      if (json_values.PointNode("byteOffset") != nullptr)
+      {
+        values += static_cast<unsigned>(json_values["byteOffset"].number());
+      }
+
+      unsigned count = (*sparse)["count"].number();
+      for (unsigned i = 0; i < count; ++i)
+      {
+        unsigned index;
+        if (index_type == 5125)
+        {
+          uint32_t index32;
+          memcpy(&index32, indices + i * index_size, sizeof (index32));
+          index = LilE(index32);
+        }
+        else
+        {
+          index = ReadComponent(indices + i * index_size, 0, index_type, false);
+        }
+        if (index >= vectors.size() / vectors_n)
+        {
+          throw ReadException("Sparse accessor index out of range.");
+        }
+
+        read_element(values + i * component_size * components_n, index);
+      }
+    }
+    return vectors;
+  }
+
+  Scene::Scene(const char* path, RenderTarget& target, unsigned storage)
   {
     std::ifstream f(path, std::ios::in | std::ios::binary);
     if (!f.is_open())
@@ -144,11 +319,22 @@ namespace nogl
         }
 
 
-        mesh.indices_.resize(static_cast<unsigned>(accessor["count"].number()));
+        // The count is of indices, not triangles. Kept in the width they come in.
+        unsigned triangles_n = static_cast<unsigned>(accessor["count"].number()) / 3;
+        // The full mesh, `Mesh::Optimize()` adds the rest of the levels.
+        mesh.lods_.resize(1);
+        if (component_type == 5123)
+        {
+          mesh.lods_[0].indices.emplace<std::vector<std::array<uint16_t, 3>>>(triangles_n);
+        }
+        else
+        {
+          mesh.lods_[0].indices.emplace<std::vector<std::array<uint32_t, 3>>>(triangles_n);
+        }
 
         auto& buffer_view = jsonr["bufferViews"][accessor["bufferView"].number()];
 
-        // Used for conversion and determining default byte_stride
+        // For determining default byte_stride
         unsigned component_size = component_type == 5123 ? sizeof (uint16_t) : sizeof (uint32_t);
 
         unsigned byte_offset = buffer_view.PointNode("byteOffset") != nullptr ? buffer_view["byteOffset"].number() : 0;
@@ -163,126 +349,538 @@ namespace nogl
         }
         unsigned byte_length = buffer_view["byteLength"].number();
 
-        // Now for the copying
-        for (unsigned byte = byte_offset, comp = 0; byte < byte_offset + byte_length; byte += byte_stride, comp += 3)
-        {
-          switch (component_size)
+        // Now for the copying, straight since the widths match
+        std::visit([&](auto& triangles) {
+          for (unsigned byte = byte_offset, comp = 0; comp < triangles.size() && byte < byte_offset + byte_length; byte += byte_stride, ++comp)
           {
-            // Just straight copy
-            case sizeof (uint32_t):
-            memcpy(&mesh.indices_[0] + comp, bin_chunk + byte, component_size * 3);
-            break;
-            
-            // Need conversion
-            case sizeof (uint16_t):
-            uint16_t* first_comp = reinterpret_cast<uint16_t*>(bin_chunk + byte);
-            mesh.indices_[comp][0] = first_comp[0];
-            mesh.indices_[comp][1] = first_comp[1];
-            mesh.indices_[comp][2] = first_comp[2];
-            break;
+            memcpy(&triangles[comp], bin_chunk + byte, sizeof (triangles[comp]));
           }
-        }
+        }, mesh.lods_[0].indices);
       }
 
-      // Attributes
+      // Skinning and morphing deform full floats, so such meshes ignore the storage flags.
+      bool skinned = primitive0["attributes"].PointNode("JOINTS_0") != nullptr;
+      bool deformed = skinned || primitive0.PointNode("targets") != nullptr;
+
+      // Attributes, positions first since they pick the order of the vertices, which the others are then read straight into.
+      std::vector<JSON::Node*> attributes;
       for (auto& attrib : primitive0["attributes"])
       {
+        attributes.push_back(&attrib);
+      }
+      std::stable_partition(attributes.begin(), attributes.end(), [](JSON::Node* attrib) { return attrib->key() == "POSITION"; });
+      // `remap[old] = new`, empty until the positions are in.
+      std::vector<unsigned> remap;
+
+      for (JSON::Node* attrib_ptr : attributes)
+      {
+        auto& attrib = *attrib_ptr;
         // ALL VALUES BELOW ASSUME THAT THE ATTRIBUTE IS POSITION, CHECK IFS BELOW.
         const char* desired_type = "VEC3";
-        unsigned desired_component_type = 5126;
+        // Directions(normals and tangents) can only be floats, or normalized signed integers.
+        bool directional = false;
         unsigned components_n = 3; // How many components per vector in the glTF format, not the VOV
         float f[4] = {0,0,0,1}; // A buffer for copying into the vov easily. Value of the 4th component is set up below, not supposed to be 1 for non positional vectors.
         // Choose VOV from the mesh based on the primitive
         VOV4* vov = &mesh.vertices_;
+        // Set instead of `vov` for 2 component attributes.
+        VOV2* vov2 = nullptr;
+        // With the storage flags `vov` may just be a staging buffer for converting into one of these.
+        SOVH* half = nullptr;
+        unsigned half_components = 0;
+        SOVQ* quantized = nullptr;
+        // `JOINTS_0` and `WEIGHTS_0` go through `staging` too.
+        bool joints = false, weights = false;
+        VOV4 staging;
 
         if (attrib.key() == "NORMAL")
         {
           vov = &mesh.normals_;
           f[3] = 0;
+          directional = true;
+          half = &mesh.normals_half_;
+          half_components = 3;
         }
-        else if (attrib.key() == "TANGENTS")
+        else if (attrib.key() == "TANGENT")
         {
           vov = &mesh.tangents_;
-          f[3] = 0;
+          desired_type = "VEC4";
+          components_n = 4;
+          directional = true;
+          half = &mesh.tangents_half_;
+          half_components = 4;
+        }
+        else if (attrib.key().starts_with("TEXCOORD_"))
+        {
+          unsigned set = std::stoul(attrib.key().substr(sizeof ("TEXCOORD_") - 1));
+          if (set >= mesh.texcoords_.size())
+          {
+            mesh.texcoords_.resize(set + 1);
+          }
+          vov2 = &mesh.texcoords_[set];
+          desired_type = "VEC2";
+          components_n = 2;
+        }
+        else if (attrib.key() == "JOINTS_0" || attrib.key() == "WEIGHTS_0")
+        {
+          vov = &staging;
+          desired_type = "VEC4";
+          components_n = 4;
+          joints = attrib.key() == "JOINTS_0";
+          weights = !joints;
         }
-        // else if (attrib.key() == "TEXCOORD_0")
-        // {
-        //   vov = mesh.texcoords_;
-        //   desired_type = "VEC2";
-        //   components_n = 2;
-        // }
         else if (attrib.key() != "POSITION")
         {
           Logger::Begin() << name_ << ": Skipping unsupported attribute key: " << attrib.key() << '.' << Logger::End();
           continue;
         }
+        else if ((storage & kQuantizedPositions) && !deformed)
+        {
+          quantized = &mesh.vertices_quantized_;
+          vov = &staging;
+        }
+
+        if (half != nullptr && (storage & kHalfAttributes) && !deformed)
+        {
+          vov = &staging;
+        }
+        else
+        {
+          half = nullptr;
+        }
 
         auto& accessor = jsonr["accessors"][attrib.number()];
 
+        unsigned component_type = accessor["componentType"].number();
+        unsigned component_size = ComponentSize(component_type);
+        bool normalized = accessor.PointNode("normalized") != nullptr && accessor["normalized"].boolean();
         if (
           accessor["type"].string() != desired_type
-          || accessor["componentType"].number() != desired_component_type
+          || component_size == 0
+          || (directional && component_type != 5126 && (!normalized || (component_type != 5120 && component_type != 5122)))
+          // Joints are indices, unsigned bytes or shorts, weights are floats or normalized ones.
+          || (joints && ((component_type != 5121 && component_type != 5123) || normalized))
+          || (weights && component_type != 5126 && (!normalized || (component_type != 5121 && component_type != 5123)))
         )
         {
           throw ReadException("Bad accessor type/componentType.");
         }
-        vov->Reallocate(accessor["count"].number());
-
-        auto& buffer_view = jsonr["bufferViews"][accessor["bufferView"].number()];
-
-        unsigned byte_offset = buffer_view.PointNode("byteOffset") != nullptr ? buffer_view["byteOffset"].number() : 0;
-        unsigned byte_stride;
-        if (buffer_view.PointNode("byteStride") != nullptr)
+        std::vector<V4> read = ReadAccessor(jsonr, bin_chunk, accessor, joints);
+        unsigned count = read.size();
+        if (vov2 != nullptr)
         {
-          byte_stride = buffer_view["byteStride"].number();
+          vov2->Reallocate(count);
         }
         else
         {
-          byte_stride = sizeof (float) * components_n;
+          vov->Reallocate(count);
         }
-        unsigned byte_length = buffer_view["byteLength"].number();
 
-        for (unsigned byte = byte_offset, vec = 0; byte < byte_offset + byte_length; byte += byte_stride, ++vec)
+        for (unsigned vec = 0; vec < count; ++vec)
         {
-          float* first_comp = reinterpret_cast<float*>(bin_chunk + byte);
-          switch (components_n)
+          for (unsigned c = 0; c < components_n; ++c)
           {
-            case 2:
-            break;
+            f[c] = read[vec][c];
+          }
 
-            case 3:
-            // if (vov == &mesh.vertices_)
-            // {
-            //   Logger::Begin() << first_comp[0] << Logger::End();
-            // }
-            f[0] = first_comp[0];
-            f[1] = first_comp[1];
-            f[2] = first_comp[2];
-            (*vov)[vec] = f;
-            break;
+          unsigned to = vec < remap.size() ? remap[vec] : vec;
+          if (vov2 != nullptr)
+          {
+            (*vov2)[to][0] = f[0];
+            (*vov2)[to][1] = f[1];
+          }
+          else
+          {
+            (*vov)[to] = f;
           }
         }
+
+        if (attrib.key() == "POSITION")
+        {
+          // glTF requires them for positions, but in the accessor's own components, so only float ones are taken as they are.
+          auto* min = accessor.PointNode("min"), * max = accessor.PointNode("max");
+          if (min != nullptr && max != nullptr && component_type == 5126)
+          {
+            mesh.bounds_ = AABB(
+              V4((*min)[0].number(), (*min)[1].number(), (*min)[2].number()),
+              V4((*max)[0].number(), (*max)[1].number(), (*max)[2].number())
+            );
+          }
+          else
+          {
+            mesh.bounds_ = AABB::Of(*vov);
+          }
+          mesh.sphere_ = Sphere::Of(*vov, mesh.bounds_);
+          // The indices come first, so the clusters can be made from the full floats, even when the positions end up quantized.
+          remap = mesh.Optimize(*vov);
+        }
+
+        if (half != nullptr)
+        {
+          half->Reallocate(staging.n(), half_components);
+          *half = staging;
+        }
+        else if (quantized != nullptr)
+        {
+          mesh.dequantization_ = quantized->Quantize(staging);
+        }
+        else if (weights)
+        {
+          mesh.weights_.Reallocate(staging.n());
+          mesh.weights_ = staging;
+        }
+        else if (joints)
+        {
+          // Padded with joint 0 and, through the weights, no pull at all.
+          unsigned capacity = (staging.n() + SOV4::kBatch - 1) / SOV4::kBatch * SOV4::kBatch;
+          mesh.joints_.reset(new (std::align_val_t(VOV4::kAlign)) uint16_t[capacity * 4]());
+          for (unsigned vec = 0; vec < staging.n(); ++vec)
+          {
+            for (unsigned c = 0; c < 4; ++c)
+            {
+              uint16_t joint = staging[vec][c];
+              mesh.joints_[c * capacity + vec] = joint;
+              mesh.joints_n_ = std::max(mesh.joints_n_, joint + 1u);
+            }
+          }
+        }
+      }
+
+      if (skinned != (mesh.weights_.n() > 0) || (skinned && mesh.weights_.n() != mesh.vertices_.n()))
+      {
+        throw ReadException("JOINTS_0 and WEIGHTS_0 must come together, one of each per vertex.");
       }
 
-      // After ALL THAT, we for sure have vertices_, at very least n()=0 so...
-      mesh.vertices_projected_.Reallocate(mesh.vertices_.n());
+      // Morph targets, in the order of the vertices after `Mesh::Optimize()` like the rest.
+      if (auto* json_targets = primitive0.PointNode("targets"); json_targets != nullptr)
+      {
+        for (auto& json_target : *json_targets)
+        {
+          mesh.targets_.push_back(Mesh::Target());
+          Mesh::Target& target = mesh.targets_.back();
+
+          std::vector<V4> deltas[2];
+          for (auto& attrib : json_target)
+          {
+            unsigned a;
+            if (attrib.key() == "POSITION")
+            {
+              a = 0;
+            }
+            else if (attrib.key() == "NORMAL" && mesh.normals_.n() > 0)
+            {
+              a = 1;
+            }
+            else
+            {
+              Logger::Begin() << name_ << ": Skipping unsupported morph target attribute key: " << attrib.key() << '.' << Logger::End();
+              continue;
+            }
+
+            auto& accessor = jsonr["accessors"][attrib.number()];
+            if (accessor["type"].string() != "VEC3" || accessor["count"].number() != mesh.vertices_.n())
+            {
+              throw ReadException("Bad morph target accessor type/count.");
+            }
+            deltas[a].resize(mesh.vertices_.n(), V4(0.0f));
+            // Deltas, so w stays 0 and adding them keeps the positions' 1.
+            std::vector<V4> read = ReadAccessor(jsonr, bin_chunk, accessor);
+            for (unsigned vec = 0; vec < read.size(); ++vec)
+            {
+              deltas[a][vec < remap.size() ? remap[vec] : vec] = read[vec];
+            }
+          }
+
+          // Most targets only move a part of the mesh(a face's mouth, a blink), those are kept sparse, so the minions only touch what moves.
+          for (unsigned vec = 0; vec < mesh.vertices_.n(); ++vec)
+          {
+            for (const std::vector<V4>& d : deltas)
+            {
+              if (!d.empty() && (d[vec][0] != 0.0f || d[vec][1] != 0.0f || d[vec][2] != 0.0f))
+              {
+                target.indices.push_back(vec);
+                break;
+              }
+            }
+          }
+          // Past a quarter of the vertices the scattering costs more than just going through all of them.
+          bool sparse = target.indices.size() * 4 <= mesh.vertices_.n();
+          if (!sparse)
+          {
+            target.indices.clear();
+          }
+
+          VOV4* vovs[2] = {&target.positions, &target.normals};
+          for (unsigned a = 0; a < 2; ++a)
+          {
+            if (deltas[a].empty())
+            {
+              continue;
+            }
+            vovs[a]->Reallocate(sparse ? target.indices.size() : deltas[a].size());
+            for (unsigned i = 0; i < vovs[a]->n(); ++i)
+            {
+              (*vovs[a])[i] = deltas[a][sparse ? target.indices[i] : i];
+            }
+          }
+          for (const V4& d : deltas[0])
+          {
+            target.reach = std::max(target.reach, d.magnitude3());
+          }
+        }
+
+        mesh.default_weights_.assign(mesh.targets_.size(), 0.0f);
+        if (auto* weights = json_mesh.PointNode("weights"); weights != nullptr)
+        {
+          if (weights->children_n() != mesh.targets_.size())
+          {
+            throw ReadException("Mesh weights don't match its morph targets.");
+          }
+          for (unsigned t = 0; t < mesh.targets_.size(); ++t)
+          {
+            mesh.default_weights_[t] = (*weights)[t].number();
+          }
+        }
+      }
     }
 
-    // Node parsing
+    // Node parsing, breadth first from the scene's roots, so every parent is added before its children, which is what `Hierarchy` wants.
+    struct PendingNode
+    {
+      unsigned index;
+      unsigned parent;
+    };
+    std::vector<PendingNode> pending;
+    // glTF index to `Hierarchy` index, for the joints of the skins.
+    std::vector<unsigned> node_indices(jsonr["nodes"].children_n(), Hierarchy::kNoParent);
+    // The `Mesh::Instance::skin` of each node, by `Hierarchy` index.
+    std::vector<unsigned> node_skins;
     for (auto& json_node: jsonr["scenes"][scene]["nodes"])
     {
-      unsigned index = json_node.number();
+      pending.push_back({static_cast<unsigned>(json_node.number()), Hierarchy::kNoParent});
+    }
+
+    for (unsigned p = 0; p < pending.size(); ++p)
+    {
+      // glTF nodes form a tree, more nodes than that means someone is a child twice, or there is a cycle.
+      if (p >= jsonr["nodes"].children_n())
+      {
+        throw ReadException("Node hierarchy is not a tree.");
+      }
+
+      auto& json_node = jsonr["nodes"][pending[p].index];
 
       nodes_.push_back(Node());
       Node& node = nodes_.back();
+      node.index_ = hierarchy_.Add(pending[p].parent);
+      node_indices[pending[p].index] = node.index_;
+
+      node.name_ = json_node["name"].string();
+
+      // Either a matrix or TRS, all optional.
+      if (auto* matrix = json_node.PointNode("matrix"); matrix != nullptr)
+      {
+        // glTF matrices are column major, just like `M4x4`'s storage.
+        M4x4 m;
+        for (unsigned i = 0; i < 4*4; ++i)
+        {
+          m[i / 4][i % 4] = (*matrix)[i].number();
+        }
+        hierarchy_.set_local(node.index_, m);
+      }
+      if (auto* translation = json_node.PointNode("translation"); translation != nullptr)
+      {
+        hierarchy_.set_translation(node.index_, V4((*translation)[0].number(), (*translation)[1].number(), (*translation)[2].number()));
+      }
+      if (auto* rotation = json_node.PointNode("rotation"); rotation != nullptr)
+      {
+        Q4 q;
+        for (unsigned i = 0; i < 4; ++i)
+        {
+          q[i] = (*rotation)[i].number();
+        }
+        hierarchy_.set_rotation(node.index_, q);
+      }
+      if (auto* scale = json_node.PointNode("scale"); scale != nullptr)
+      {
+        hierarchy_.set_scale(node.index_, V4((*scale)[0].number(), (*scale)[1].number(), (*scale)[2].number()));
+      }
 
-      node.name_ = jsonr["nodes"][index]["name"].string();
+      if (auto* children = json_node.PointNode("children"); children != nullptr)
+      {
+        for (auto& child : *children)
+        {
+          pending.push_back({static_cast<unsigned>(child.number()), node.index_});
+        }
+      }
 
-      auto* mesh = jsonr["nodes"][index].PointNode("mesh");
+      auto* mesh = json_node.PointNode("mesh");
       if (mesh != nullptr)
       {
         node.data_ = &meshes_.at(mesh->number());
-        continue;
+      }
+      auto* skin = json_node.PointNode("skin");
+      node_skins.push_back(skin != nullptr ? static_cast<unsigned>(skin->number()) : Mesh::kNoSkin);
+
+      // The node's own weights win over the mesh's.
+      weights_.push_back(mesh != nullptr ? meshes_[mesh->number()].default_weights_ : std::vector<float>());
+      if (auto* weights = json_node.PointNode("weights"); weights != nullptr && mesh != nullptr)
+      {
+        if (weights->children_n() != weights_.back().size())
+        {
+          throw ReadException("Node weights don't match its mesh's morph targets.");
+        }
+        for (unsigned t = 0; t < weights_.back().size(); ++t)
+        {
+          weights_.back()[t] = (*weights)[t].number();
+        }
+      }
+    }
+
+    // Skins, after the nodes so the joints can be found in the hierarchy.
+    if (auto* json_skins = jsonr.PointNode("skins"); json_skins != nullptr)
+    {
+      for (auto& json_skin : *json_skins)
+      {
+        skins_.push_back(Skin());
+        Skin& skin = skins_.back();
+
+        for (auto& joint : json_skin["joints"])
+        {
+          unsigned j = joint.number();
+          if (j >= node_indices.size() || node_indices[j] == Hierarchy::kNoParent)
+          {
+            throw ReadException("Skin joint is not in the scene.");
+          }
+          skin.joints_.push_back(node_indices[j]);
+        }
+        skin.inverse_binds_.assign(skin.joints_.size(), M4x4::Identity());
+        skin.matrices_.resize(skin.joints_.size());
+
+        if (auto* inverse_binds = json_skin.PointNode("inverseBindMatrices"); inverse_binds != nullptr)
+        {
+          auto& accessor = jsonr["accessors"][inverse_binds->number()];
+          if (
+            accessor["type"].string() != "MAT4"
+            || accessor["componentType"].number() != 5126
+            || accessor["count"].number() < skin.joints_.size()
+          )
+          {
+            throw ReadException("Bad inverse bind matrices accessor.");
+          }
+
+          // Column major, like the node matrices.
+          std::vector<V4> columns = ReadAccessor(jsonr, bin_chunk, accessor);
+          for (unsigned j = 0; j < skin.joints_.size(); ++j)
+          {
+            for (unsigned i = 0; i < 4*4; ++i)
+            {
+              skin.inverse_binds_[j][i / 4][i % 4] = columns[j * 4 + i / 4][i % 4];
+            }
+          }
+        }
+      }
+    }
+
+    // Animations, after the nodes too.
+    if (auto* json_animations = jsonr.PointNode("animations"); json_animations != nullptr)
+    {
+      for (auto& json_animation : *json_animations)
+      {
+        animations_.push_back(Animation());
+        Animation& animation = animations_.back();
+        if (auto* name = json_animation.PointNode("name"); name != nullptr)
+        {
+          animation.name_ = name->string();
+        }
+
+        for (auto& json_sampler : json_animation["samplers"])
+        {
+          Animation::Sampler sampler;
+          for (const V4& time : ReadAccessor(jsonr, bin_chunk, jsonr["accessors"][json_sampler["input"].number()]))
+          {
+            sampler.times.push_back(time[0]);
+          }
+          if (sampler.times.empty())
+          {
+            throw ReadException("Animation sampler without keys.");
+          }
+          sampler.values = ReadAccessor(jsonr, bin_chunk, jsonr["accessors"][json_sampler["output"].number()]);
+
+          if (auto* interpolation = json_sampler.PointNode("interpolation"); interpolation != nullptr)
+          {
+            if (interpolation->string() == "STEP")
+            {
+              sampler.interpolation = Animation::Interpolation::kStep;
+            }
+            else if (interpolation->string() == "CUBICSPLINE")
+            {
+              sampler.interpolation = Animation::Interpolation::kCubicSpline;
+            }
+          }
+          animation.samplers_.push_back(std::move(sampler));
+        }
+
+        for (auto& json_channel : json_animation["channels"])
+        {
+          auto& json_target = json_channel["target"];
+          auto* node = json_target.PointNode("node");
+          auto target_path = json_target["path"].string();
+
+          Animation::Path path;
+          if (target_path == "translation")
+          {
+            path = Animation::Path::kTranslation;
+          }
+          else if (target_path == "rotation")
+          {
+            path = Animation::Path::kRotation;
+          }
+          else if (target_path == "scale")
+          {
+            path = Animation::Path::kScale;
+          }
+          else if (target_path == "weights")
+          {
+            path = Animation::Path::kWeights;
+          }
+          else
+          {
+            Logger::Begin() << name_ << ": Skipping unsupported animation path: " << target_path << '.' << Logger::End();
+            continue;
+          }
+
+          // Nodes outside of the scene may be animated too, nobody sees them. Same for the weights of nodes without morph targets.
+          unsigned node_index = node != nullptr ? static_cast<unsigned>(node->number()) : Hierarchy::kNoParent;
+          if (
+            node_index >= node_indices.size() || node_indices[node_index] == Hierarchy::kNoParent
+            || (path == Animation::Path::kWeights && weights_[node_indices[node_index]].empty())
+          )
+          {
+            continue;
+          }
+
+          unsigned sampler_index = json_channel["sampler"].number();
+          if (sampler_index >= animation.samplers_.size())
+          {
+            throw ReadException("Animation channel without a sampler.");
+          }
+          const Animation::Sampler& sampler = animation.samplers_[sampler_index];
+          unsigned values_per_key = sampler.interpolation == Animation::Interpolation::kCubicSpline ? 3 : 1;
+          // Weights are sampled for every target of the node's mesh at once.
+          if (path == Animation::Path::kWeights)
+          {
+            values_per_key *= weights_[node_indices[node_index]].size();
+          }
+          if (sampler.values.size() != sampler.times.size() * values_per_key)
+          {
+            throw ReadException("Animation sampler has a different number of keys and values.");
+          }
+
+          animation.channels_.push_back({sampler_index, node_indices[node_index], path});
+        }
+
+        animation.Prepare();
       }
     }
 
@@ -298,26 +896,305 @@ namespace nogl
 
       nodes_.push_back(Node());
       auto& node = nodes_.back();
+      node.index_ = hierarchy_.Add(Hierarchy::kNoParent);
       node.data_ = &camera;
+      weights_.push_back({});
 
       main_camera_node = &node;
     }
-    UpdateCameras(ctx);
+    for (auto& node : nodes_)
+    {
+      if (std::holds_alternative<Mesh*>(node.data()))
+      {
+        Mesh& mesh = *std::get<Mesh*>(node.data());
+        // A skin on a node whose mesh has no joints does nothing.
+        unsigned skin = mesh.skinned() ? node_skins[node.index()] : Mesh::kNoSkin;
+        if (mesh.skinned() && (skin >= skins_.size() || skins_[skin].joints_.size() < mesh.joints_n_))
+        {
+          throw ReadException("Skinned mesh without a skin that has all its joints.");
+        }
+        mesh_nodes_.push_back(node.index());
+        mesh_instances_.push_back(mesh.instances_.size());
+        mesh.instances_.push_back({node.index(), skin, {}, 0, {}, {}});
+      }
+    }
+    cull_centers_.Reallocate(mesh_nodes_.size());
+    cull_extents_.Reallocate(mesh_nodes_.size());
+    reaches_.resize(mesh_nodes_.size());
+    cull_visible_.reset(new uint8_t[(mesh_nodes_.size() + SOV4::kBatch - 1) / SOV4::kBatch * SOV4::kBatch]());
+    visible_.assign(nodes_.size(), 1);
+    spheres_.resize(nodes_.size());
+
+    UpdateCameras(target);
+    hierarchy_.Update();
+    Cull();
 
     delete [] json_chunk;
     delete [] bin_chunk;
   }
 
-  void Scene::UpdateCameras(Context& ctx)
+  void Scene::UpdateCameras(RenderTarget& target)
   {
     for (Camera& camera : cameras_)
     {
-      camera.width_ = ctx.width();
-      camera.height_ = ctx.height();
+      camera.width_ = target.width();
+      camera.height_ = target.height();
       camera.RecalculateMatrix();
     }
   }
 
+  void Scene::Cull()
+  {
+    if (main_camera_node == nullptr)
+    {
+      return;
+    }
+
+    Camera& camera = *std::get<Camera*>(main_camera_node->data());
+    // Same as the minions'.
+    const M4x4 view_projection = camera.matrix() * hierarchy_.world(main_camera_node->index()).InverseAffine();
+
+    for (Skin& skin : skins_)
+    {
+      for (unsigned j = 0; j < skin.joints_.size(); ++j)
+      {
+        skin.matrices_[j] = hierarchy_.world(skin.joints_[j]) * skin.inverse_binds_[j];
+      }
+    }
+
+    for (unsigned i = 0; i < mesh_nodes_.size(); ++i)
+    {
+      unsigned node = mesh_nodes_[i];
+      Mesh& mesh = *std::get<Mesh*>(nodes_[node].data());
+      Mesh::Instance& instance = mesh.instances_[mesh_instances_[i]];
+      unsigned skin = instance.skin;
+
+      // No vertex moves farther than the reaches of the active targets combined, so the mesh's bounds are grown by that before anything else.
+      instance.active_targets.clear();
+      reaches_[i] = 0.0f;
+      for (unsigned t = 0; t < mesh.targets_.size(); ++t)
+      {
+        float weight = weights_[node][t];
+        if (weight != 0.0f)
+        {
+          instance.active_targets.push_back(t);
+          reaches_[i] += std::abs(weight) * mesh.targets_[t].reach;
+        }
+      }
+      AABB bounds = mesh.bounds();
+      for (unsigned c = 0; c < 3; ++c)
+      {
+        bounds.min[c] -= reaches_[i];
+        bounds.max[c] += reaches_[i];
+      }
+
+      AABB box;
+      if (skin != Mesh::kNoSkin)
+      {
+        // A skinned vertex is a blend of where its joints would each put it, so it's inside the box around the mesh's box under every joint.
+        const std::vector<M4x4>& matrices = skins_[skin].matrices_;
+        box = bounds.Transformed(matrices[0]);
+        for (unsigned j = 1; j < matrices.size(); ++j)
+        {
+          AABB joint_box = bounds.Transformed(matrices[j]);
+          for (unsigned c = 0; c < 3; ++c)
+          {
+            box.min[c] = std::min(box.min[c], joint_box.min[c]);
+            box.max[c] = std::max(box.max[c], joint_box.max[c]);
+          }
+        }
+        spheres_[node] = Sphere(box.center(), box.extents().magnitude3());
+      }
+      else
+      {
+        const M4x4& world = hierarchy_.world(node);
+        box = bounds.Transformed(world);
+        spheres_[node] = Sphere(mesh.sphere().center, mesh.sphere().radius + reaches_[i]).Transformed(world);
+      }
+
+      V4 center = box.center(), extents = box.extents();
+      for (unsigned c = 0; c < 3; ++c)
+      {
+        cull_centers_.stream(c)[i] = center[c];
+        cull_extents_.stream(c)[i] = extents[c];
+      }
+    }
+
+    Frustum(view_projection, camera.width(), camera.height()).Cull(cull_visible_.get(), cull_centers_, cull_extents_);
+
+    for (Mesh& mesh : meshes_)
+    {
+      mesh.visible_instances_.clear();
+      mesh.instance_matrices_.clear();
+    }
+
+    // Then the meshlets of the meshes that survived, in model space, so only the frustum and the camera's position get transformed and not every meshlet.
+    const V4 camera_position(hierarchy_.world(main_camera_node->index())[3]);
+    // Pixels per unit of size at a distance of 1, the bigger of the axes.
+    const float focal = std::max(camera.matrix()[0][0], camera.matrix()[1][1]);
+    for (unsigned i = 0; i < mesh_nodes_.size(); ++i)
+    {
+      unsigned node = mesh_nodes_[i];
+      Mesh& mesh = *std::get<Mesh*>(nodes_[node].data());
+      Mesh::Instance& instance = mesh.instances_[mesh_instances_[i]];
+      visible_[node] = cull_visible_[i];
+      if (!visible_[node])
+      {
+        continue;
+      }
+
+      // The errors grow with the levels, so the simplest one still under `lod_error_`. Up close(or inside the sphere) it's always the full mesh.
+      const Sphere& sphere = spheres_[node];
+      V4 offset = sphere.center;
+      offset -= camera_position;
+      float distance = offset.magnitude3() - sphere.radius;
+      float scale = mesh.sphere().radius > 0.0f ? sphere.radius / mesh.sphere().radius : 1.0f;
+      instance.lod = 0;
+      while (distance > 0.0f && instance.lod + 1 < mesh.lods_.size() && mesh.lods_[instance.lod + 1].error * scale * focal <= lod_error_ * distance)
+      {
+        ++instance.lod;
+      }
+
+      // Skinned vertices land in world space, and their meshlets' bounds are of the bind pose, so they are all projected.
+      if (instance.skin != Mesh::kNoSkin)
+      {
+        mesh.CullMeshlets(instance, nullptr, camera_position, false);
+        mesh.visible_instances_.push_back(mesh_instances_[i]);
+        mesh.instance_matrices_.push_back(view_projection);
+        continue;
+      }
+
+      const M4x4& world = hierarchy_.world(node);
+      V4 eye = camera_position;
+      eye *= world.InverseAffine();
+
+      // A negative determinant means a mirror.
+      V4 x(world[0]), y(world[1]), z(world[2]);
+      y.CrossProduct(z);
+      bool cones = x.DotProduct(y) > 0.0f;
+
+      const M4x4 mvp = view_projection * world;
+      Frustum frustum(mvp, camera.width(), camera.height());
+      mesh.CullMeshlets(instance, &frustum, eye, cones, reaches_[i]);
+
+      mesh.visible_instances_.push_back(mesh_instances_[i]);
+      // The dequantization goes first, so it's on the right.
+      mesh.instance_matrices_.push_back(mesh.quantized() ? mvp * mesh.dequantization_ : mvp);
+    }
+
+    // The scratch only ever grows, to as many instances as were ever visible at once.
+    for (Mesh& mesh : meshes_)
+    {
+      unsigned padded = (mesh.vertices_n() + VOV4::kBatch - 1) / VOV4::kBatch * VOV4::kBatch;
+      unsigned skinned_n = mesh.skinned() ? mesh.vertices_n() : 0;
+      unsigned morphed_n = mesh.targets_.empty() ? 0 : mesh.vertices_n();
+      while (mesh.projected_.size() < mesh.visible_instances_.size())
+      {
+        mesh.projected_.push_back({
+          VOV4(mesh.vertices_n()), std::unique_ptr<uint8_t[]>(new uint8_t[padded]()),
+          VOV4(skinned_n), VOV4(mesh.normals_.n() > 0 ? skinned_n : 0),
+          VOV4(morphed_n), VOV4(mesh.normals_.n() > 0 ? morphed_n : 0)
+        });
+      }
+    }
+  }
+
+  unsigned Scene::SubmitProjection()
+  {
+    // The batches of all visible instances of all meshes as one list.
+    project_runs_.clear();
+    unsigned total = 0;
+    if (main_camera_node != nullptr)
+    {
+      for (Mesh& mesh : meshes_)
+      {
+        for (unsigned v = 0; v < mesh.visible_instances_.size(); ++v)
+        {
+          project_runs_.push_back({&mesh, v, total});
+          total += mesh.instances_[mesh.visible_instances_[v]].batches.size();
+        }
+      }
+    }
+    return Wizard::Submit<&Scene::Project>(*this, total, Wizard::Grain(kProjectBatchBytes));
+  }
+
+  void Scene::Project(unsigned from, unsigned to)
+  {
+    Profiler::Scope scope("transform");
+
+    Camera& camera = *std::get<Camera*>(main_camera_node->data());
+
+    // `Cull()` already threw out the instances off screen before anyone touched a vertex, and left the matrices of the rest.
+    auto run = std::upper_bound(project_runs_.begin(), project_runs_.end(), from, [](unsigned item, const ProjectRun& run) { return item < run.first; }) - 1;
+    for (; run != project_runs_.end() && run->first < to; ++run)
+    {
+      Mesh& mesh = *run->mesh;
+      unsigned v = run->slot;
+
+      // Only the batches the visible meshlets use.
+      const Mesh::Instance& instance = mesh.instances_[mesh.visible_instances_[v]];
+      const std::vector<unsigned>& batches = instance.batches;
+      unsigned b = std::max(from, run->first) - run->first;
+      unsigned b_last = std::min(to, run->first + static_cast<unsigned>(batches.size())) - run->first;
+
+      // The whole model-view-projection collapsed into one matrix, so the vertices are touched only once.
+      const M4x4& m = mesh.instance_matrices_[v];
+      Mesh::Projected& projected = mesh.projected_[v];
+      VOV4& out_vov = projected.vertices;
+      uint8_t* outcodes = projected.outcodes.get();
+
+      // Consecutive batches go in one call.
+      while (b < b_last)
+      {
+        unsigned run_end = b + 1;
+        while (run_end < b_last && batches[run_end] == batches[run_end - 1] + 1)
+        {
+          ++run_end;
+        }
+        unsigned first = batches[b] * VOV4::kBatch;
+        unsigned last = std::min((batches[run_end - 1] + 1) * VOV4::kBatch, out_vov.n());
+        b = run_end;
+
+        // Now for projection, multiplication and division in one go
+        if (instance.skin != Mesh::kNoSkin || !instance.active_targets.empty())
+        {
+          // Morphed, then skinned, a chunk at a time, so the deformed vertices are still in cache when they are skinned and projected.
+          const float* weights = weights_[instance.node].data();
+          bool normals = mesh.normals_.n() > 0;
+          for (unsigned chunk = first; chunk < last; chunk += kDeformChunk)
+          {
+            unsigned chunk_end = std::min(chunk + kDeformChunk, last);
+            const VOV4* positions = &mesh.vertices_;
+            const VOV4* normals_in = &mesh.normals_;
+            if (!instance.active_targets.empty())
+            {
+              mesh.Morph(instance, weights, projected.morphed_vertices, &projected.morphed_normals, chunk, chunk_end);
+              positions = &projected.morphed_vertices;
+              normals_in = &projected.morphed_normals;
+            }
+            if (instance.skin != Mesh::kNoSkin)
+            {
+              skins_[instance.skin].Deform(
+                mesh, *positions, normals ? normals_in : nullptr,
+                projected.skinned_vertices, normals ? &projected.skinned_normals : nullptr, chunk, chunk_end
+              );
+              positions = &projected.skinned_vertices;
+            }
+            positions->Project(out_vov, outcodes, m, camera.width(), camera.height(), chunk, chunk_end);
+          }
+        }
+        else if (mesh.quantized())
+        {
+          mesh.vertices_quantized_.Project(out_vov, outcodes, m, camera.width(), camera.height(), first, last);
+        }
+        else
+        {
+          mesh.vertices_.Project(out_vov, outcodes, m, camera.width(), camera.height(), first, last);
+        }
+      }
+    }
+  }
+
   Scene::~Scene()
   {
     
@@ -0,0 +1,140 @@
+#include "Simd.hpp"
+
+#include <cpuid.h>
+
+#include <cstdlib>
+#include <cstring>
+
+namespace nogl
+{
+  // The tables with the `nullptr`s filled from the level below, so `kernels()` never has to check.
+  static Simd::Kernels resolved[3];
+
+  // Fills every `nullptr` kernel of `k` from `fallback`.
+  static void Fill(Simd::Kernels& k, const Simd::Kernels& fallback)
+  {
+    auto fill = [](auto& kernel, auto fallback_kernel) { if (kernel == nullptr) kernel = fallback_kernel; };
+
+    fill(k.multiply, fallback.multiply);
+    fill(k.divide_by_w, fallback.divide_by_w);
+    fill(k.add, fallback.add);
+    fill(k.add_scaled, fallback.add_scaled);
+    fill(k.scatter_add_scaled, fallback.scatter_add_scaled);
+    fill(k.rotate, fallback.rotate);
+    fill(k.project, fallback.project);
+    fill(k.normalize, fallback.normalize);
+    fill(k.multiply_normals, fallback.multiply_normals);
+    fill(k.dot, fallback.dot);
+    fill(k.dot_vector, fallback.dot_vector);
+    fill(k.cross, fallback.cross);
+    fill(k.slerp, fallback.slerp);
+    fill(k.sov4_from_vov4, fallback.sov4_from_vov4);
+    fill(k.sov4_to_vov4, fallback.sov4_to_vov4);
+    fill(k.sov4_multiply, fallback.sov4_multiply);
+    fill(k.sovh_from_vov4, fallback.sovh_from_vov4);
+    fill(k.sovh_to_vov4, fallback.sovh_to_vov4);
+    fill(k.sovh_multiply, fallback.sovh_multiply);
+    fill(k.sovq_project, fallback.sovq_project);
+    fill(k.cull_boxes, fallback.cull_boxes);
+    fill(k.skin, fallback.skin);
+    fill(k.fill32, fallback.fill32);
+    fill(k.fill_float, fallback.fill_float);
+    fill(k.raster_row, fallback.raster_row);
+    fill(k.raster_row_textured, fallback.raster_row_textured);
+    fill(k.blend_row, fallback.blend_row);
+  }
+
+  // XCR0, what register states the OS actually saves on context switches. The CPU having AVX means nothing if the OS doesn't.
+  static uint64_t xgetbv()
+  {
+    uint32_t eax, edx;
+    __asm__ volatile ("xgetbv" : "=a"(eax), "=d"(edx) : "c"(0));
+    return (static_cast<uint64_t>(edx) << 32) | eax;
+  }
+
+  Simd::Level Simd::supported()
+  {
+    unsigned eax, ebx, ecx, edx;
+
+    if (!__get_cpuid(1, &eax, &ebx, &ecx, &edx))
+    {
+      return Level::kSSE4;
+    }
+    bool osxsave = ecx & bit_OSXSAVE, avx = ecx & bit_AVX, fma = ecx & bit_FMA, f16c = ecx & bit_F16C;
+    if (!osxsave || !avx || !fma || !f16c)
+    {
+      return Level::kSSE4;
+    }
+
+    // XMM and YMM state
+    uint64_t xcr0 = xgetbv();
+    if ((xcr0 & 0b110) != 0b110 || !__get_cpuid_count(7, 0, &eax, &ebx, &ecx, &edx) || !(ebx & bit_AVX2))
+    {
+      return Level::kSSE4;
+    }
+
+    // Plus the opmask and both halves of ZMM state
+    bool avx512 = (ebx & bit_AVX512F) && (ebx & bit_AVX512BW) && (ebx & bit_AVX512VL) && (ebx & bit_AVX512DQ);
+    if (!avx512 || (xcr0 & 0xE6) != 0xE6)
+    {
+      return Level::kAVX2;
+    }
+
+    return Level::kAVX512;
+  }
+
+  Simd::Level Simd::set_level(Level level)
+  {
+    Level best = supported();
+    if (level > best)
+    {
+      level = best;
+    }
+
+    level_ = level;
+    kernels_ = &resolved[static_cast<int>(level)];
+    return level;
+  }
+
+  const char* Simd::name(Level level)
+  {
+    switch (level)
+    {
+      case Level::kSSE4: return "SSE4.1";
+      case Level::kAVX2: return "AVX2";
+      case Level::kAVX512: return "AVX-512";
+    }
+    return "?";
+  }
+
+  const Simd::Kernels* Simd::Initialize()
+  {
+    resolved[0] = kSSE4Kernels;
+    resolved[1] = kAVX2Kernels;
+    Fill(resolved[1], resolved[0]);
+    resolved[2] = kAVX512Kernels;
+    Fill(resolved[2], resolved[1]);
+
+    Level level = supported();
+
+    // No logging here, this runs during static initialization, the logger may not exist yet.
+    const char* env = std::getenv("NOGL_SIMD");
+    if (env != nullptr)
+    {
+      if (!strcmp(env, "sse4"))
+      {
+        level = Level::kSSE4;
+      }
+      else if (!strcmp(env, "avx2") && level > Level::kAVX2)
+      {
+        level = Level::kAVX2;
+      }
+    }
+
+    level_ = level;
+    return &resolved[static_cast<int>(level)];
+  }
+
+  Simd::Level Simd::level_ = Simd::Level::kSSE4;
+  const Simd::Kernels* Simd::kernels_ = Simd::Initialize();
+}
@@ -0,0 +1,15 @@
+#include "Skin.hpp"
+
+namespace nogl
+{
+  void Skin::Deform(const Mesh& mesh, const VOV4& positions, const VOV4* normals, VOV4& out_positions, VOV4* out_normals, unsigned from, unsigned to) const noexcept
+  {
+    bool with_normals = normals != nullptr && out_normals != nullptr;
+    Simd::kernels().skin(
+      out_positions.begin()->p_, with_normals ? out_normals->begin()->p_ : nullptr,
+      positions.begin()->p_, with_normals ? normals->begin()->p_ : nullptr,
+      mesh.joints_.get(), mesh.weights_.stream(0), mesh.weights_.capacity(),
+      matrices_.data()->p_[0], from, to
+    );
+  }
+}
@@ -13,6 +13,7 @@ namespace nogl
 
   bool Thread::has_simd()
   {
-    return __builtin_cpu_supports("avx2") && __builtin_cpu_supports("sse4.1");
+    // Just the baseline, anything wider is picked at runtime by `Simd`.
+    return __builtin_cpu_supports("sse4.1");
   }
 }
@@ -3,10 +3,13 @@
 #include <iostream>
 #include <memory>
 #include <exception>
+#include <span>
+#include <cmath>
 
 #include "nogl.hpp"
 
 static bool run_loop = true;
+static bool export_trace = false;
 
 static void EventHandler(nogl::Context&, const nogl::Context::Event& e)
 {
@@ -17,6 +20,11 @@ static void EventHandler(nogl::Context&, const nogl::Context::Event& e)
     break;
 
     case nogl::Context::Event::Type::kPress:
+    // T for trace.
+    if (e.press.code == 'T')
+    {
+      export_trace = true;
+    }
     break;
 
     default:
@@ -42,70 +50,172 @@ int main()
 
     // q = q.QMultiply(p); // -577.4,113.49,525.2,-235.9
     // q.StoreUnaligned(ymmf);
-    float ymmf[8];
-    nogl::XMM<float> q1(1,0,0,0), p1(.5f,.5f,.5f,.5f);
-    nogl::YMM<float> q = q1, p = p1;
+    // Only XMM out here, the rest of the program is compiled for SSE4.1, wider code lives in the `nogl::Simd` kernels.
+    float xmmf[4];
+    nogl::XMM<float> q(1,0,0,0), p(.5f,.5f,.5f,.5f);
 
     q = q.QVSandwich(p);
-    q.StoreUnaligned(ymmf);
+    q.StoreUnaligned(xmmf);
     
-    nogl::Logger::Begin() << ymmf[0] << ',' << ymmf[1] << ',' << ymmf[2] << ',' << ymmf[3] << '|' << ymmf[4] << ',' << ymmf[5] << ',' << ymmf[6] << ',' << ymmf[7] << ',' << nogl::Logger::End();
+    nogl::Logger::Begin() << xmmf[0] << ',' << xmmf[1] << ',' << xmmf[2] << ',' << xmmf[3] << nogl::Logger::End();
   }
 
+  nogl::Logger::Begin() << "SIMD: " << nogl::Simd::name(nogl::Simd::level()) << nogl::Logger::End();
+
   nogl::Context ctx(480,360);
-  ctx.set_clear_color(32, 32, 32);
   ctx.set_event_handler(EventHandler);
 
-  nogl::Scene scene("./scifi.glb", ctx);
+  // We render into the scaler's target, it's upscaled to `ctx` at the end of the frame.
+  nogl::ResolutionScaler scaler(ctx.width(), ctx.height());
+  scaler.set_clear_color(32, 32, 32);
+
+  nogl::Scene scene("./scifi.glb", scaler.target());
   std::get<nogl::Camera*>(scene.main_camera_node->data())->set_yfov(0.5);
+  // No materials are loaded yet, so meshes with texture coordinates get a checkerboard, it shows off the UVs and that they stay straight in perspective.
+  nogl::Image checker(64, 64);
+  for (unsigned y = 0; y < checker.height(); ++y)
+  {
+    for (unsigned x = 0; x < checker.width(); ++x)
+    {
+      reinterpret_cast<uint32_t*>(checker.data())[x + y * checker.width()] = (x / 8 + y / 8) % 2 ? 0xC0C0C0 : 0x404040;
+    }
+  }
   // nogl::Image img("../data/test.jpg");
 
   auto minions = nogl::Wizard::SpawnMinions();
-  nogl::Wizard::scene = &scene;
 
   char title[128];
   unsigned title_set_time = ~0;
-  unsigned avg_frame_time = 33;
+  float avg_frame_time = 33;
   nogl::Clock clock(avg_frame_time);
+  // Seconds, every animation loops over its own duration.
+  float animation_time = 0;
   while (run_loop)
   {
     nogl::Clock::BeginMeasure();
+    unsigned long long frame_begin = nogl::Clock::global_now_ns();
+    // Minions are idle here, so the animations can move the nodes, and the world matrices can be brought up to date.
+    {
+      nogl::Profiler::Scope scope("animate");
+      for (nogl::Animation& animation : scene.animations())
+      {
+        animation.Apply(animation.duration() > 0 ? std::fmod(animation_time, animation.duration()) : 0, scene);
+      }
+    }
+    {
+      nogl::Profiler::Scope scope("hierarchy");
+      scene.hierarchy().Update();
+    }
+    {
+      nogl::Profiler::Scope scope("cull");
+      scene.Cull();
+    }
+    scene.SubmitProjection();
     nogl::Wizard::RingBegin();
 
+    nogl::RenderTarget& target = scaler.target();
+
     ctx.HandleEvents();
-    ctx.Clear();
-    // ctx.PutImage(img, 0, 0);
+    {
+      nogl::Profiler::Scope scope("clear");
+      target.Clear();
+      target.ClearZ();
+    }
+    // target.PutImage(img, 0, 0);
     
-    nogl::Wizard::WaitDone();
+    {
+      nogl::Profiler::Scope scope("wait minions");
+      nogl::Wizard::WaitDone();
+    }
 
-    auto& vertices_projected = scene.meshes()[0].vertices_projected();
-    for (auto& tri : scene.meshes()[0].indices())
+    unsigned long long raster_begin = nogl::Clock::global_now_ns();
+
+    // Culled instances weren't projected this frame, only the visible ones are there.
+    for (const nogl::Mesh& mesh : scene.meshes())
     {
-      // Additional transformations? A THING OF THE PAST WITH ARTIOM'S NOGL!
-      // unsigned x = (v[0]/2 + 0.5) * ctx.width();
-      // unsigned y = (v[1]/2 + 0.5) * ctx.height();
-      // unsigned x = v[0];
-      // unsigned y = v[1];
-      // if (x >= ctx.width() || y >= ctx.height() || v[2] > 1 || v[2] < 0)
-      // {
-      //   continue;
-      // }
-      // ctx.data()[(x + y * ctx.width()) * 4 + 1] = 255;
-      // if (scene.meshes()[0].normals()[tri[0]].DotProduct((const float[]) {0,0,1,0}) > 0)
-      // {
-        ctx.PutTriangle(
-          vertices_projected[tri[0]][0], vertices_projected[tri[0]][1], vertices_projected[tri[0]][2],
-          vertices_projected[tri[1]][0], vertices_projected[tri[1]][1], vertices_projected[tri[1]][2],
-          vertices_projected[tri[2]][0], vertices_projected[tri[2]][1], vertices_projected[tri[2]][2]);
-      // }
+      for (unsigned v = 0; v < mesh.visible_instances().size(); ++v)
+      {
+        const nogl::Mesh::Instance& instance = mesh.instances()[mesh.visible_instances()[v]];
+        const nogl::Mesh::Lod& lod = mesh.lods()[instance.lod];
+        auto& vertices_projected = mesh.vertices_projected(v);
+        const uint8_t* outcodes = mesh.outcodes(v);
+        // Only `TEXCOORD_0`, there is no material to pick another set.
+        const nogl::VOV2* texcoords = !mesh.texcoords().empty() && mesh.texcoords()[0].n() > 0 ? &mesh.texcoords()[0] : nullptr;
+        // Only the meshlets that survived culling, the others' vertices weren't projected.
+        // Visited so the loop is compiled for each index width, 16-bit ones are half the bytes to stream through.
+        std::visit([&](const auto& indices) {
+          for (unsigned m : instance.visible_meshlets)
+          {
+            const nogl::Meshlet& meshlet = lod.meshlets[m];
+            for (auto& tri : std::span(indices).subspan(meshlet.first_triangle, meshlet.triangles_n))
+            {
+              // All vertices outside the same plane means it's invisible, and there is no near clipping yet so anything crossing it goes too.
+              uint8_t oc0 = outcodes[tri[0]], oc1 = outcodes[tri[1]], oc2 = outcodes[tri[2]];
+              if ((oc0 & oc1 & oc2) || ((oc0 | oc1 | oc2) & nogl::VOV4::kOutNear))
+              {
+                continue;
+              }
+
+              // Additional transformations? A THING OF THE PAST WITH ARTIOM'S NOGL!
+              // unsigned x = (v[0]/2 + 0.5) * ctx.width();
+              // unsigned y = (v[1]/2 + 0.5) * ctx.height();
+              // unsigned x = v[0];
+              // unsigned y = v[1];
+              // if (x >= ctx.width() || y >= ctx.height() || v[2] > 1 || v[2] < 0)
+              // {
+              //   continue;
+              // }
+              // ctx.data()[(x + y * ctx.width()) * 4 + 1] = 255;
+              // if (scene.meshes()[0].normals()[tri[0]].DotProduct((const float[]) {0,0,1,0}) > 0)
+              // {
+                if (texcoords != nullptr)
+                {
+                  target.PutTriangle(
+                    vertices_projected[tri[0]], vertices_projected[tri[1]], vertices_projected[tri[2]],
+                    (*texcoords)[tri[0]], (*texcoords)[tri[1]], (*texcoords)[tri[2]],
+                    checker);
+                }
+                else
+                {
+                  target.PutTriangle(
+                    vertices_projected[tri[0]][0], vertices_projected[tri[0]][1], vertices_projected[tri[0]][2],
+                    vertices_projected[tri[1]][0], vertices_projected[tri[1]][1], vertices_projected[tri[1]][2],
+                    vertices_projected[tri[2]][0], vertices_projected[tri[2]][1], vertices_projected[tri[2]][2]);
+                }
+              // }
+            }
+          }
+        }, lod.indices);
+      }
     }
-    ctx.Refresh();
-    avg_frame_time = (avg_frame_time + nogl::Clock::EndMeasure()) / 2;
-    
-    if (clock.SleepRemainder() < 0)
+    nogl::Profiler::Record("raster", raster_begin, nogl::Clock::global_now_ns());
+
+    {
+      nogl::Profiler::Scope scope("upscale");
+      scaler.Upscale(ctx);
+    }
+    {
+      nogl::Profiler::Scope scope("present");
+      ctx.Refresh();
+    }
+    float work_time = nogl::Clock::EndMeasureNs() / 1'000'000.0f;
+    avg_frame_time = (avg_frame_time + work_time) / 2;
+    nogl::Profiler::Record("frame", frame_begin, nogl::Clock::global_now_ns());
+
+    if (export_trace)
+    {
+      export_trace = false;
+      nogl::Profiler::ExportChromeTrace("trace.json");
+      nogl::Logger::Begin() << "Exported trace.json." << nogl::Logger::End();
+    }
+
+    // Over budget we lose resolution instead of sleeping, minions are idle here so the cameras can change.
+    if (scaler.Update(work_time, clock.target_frame_time))
     {
-      nogl::Thread::Sleep(5); // For now rest for the CPU is more important
+      scene.UpdateCameras(scaler.target());
     }
+    clock.SleepRemainder();
+    animation_time += clock.frame_time / 1000.0f;
 
 
     // Displaying FPS on title
@@ -113,7 +223,7 @@ int main()
     if (title_set_time >= 3000)
     {
       title_set_time = 0;
-      sprintf(title, "NOGL - %ums", avg_frame_time);
+      sprintf(title, "NOGL - %.2fms - %u%%", avg_frame_time, static_cast<unsigned>(scaler.scale() * 100));
       ctx.set_title(title);
       avg_frame_time = clock.frame_time;
     }
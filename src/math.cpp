@@ -2,15 +2,166 @@
 
 namespace nogl
 {
+  // For `M4x4::Inverse()`, every XMM is a 2x2 matrix [a,b,c,d] meaning [[a,b],[c,d]].
+  // `a` x `b`
+  static inline XMM<float> Mat2Multiply(const XMM<float>& a, const XMM<float>& b)
+  {
+    return a * b.Shuffle(0,3,0,3) + a.Shuffle(1,0,3,2) * b.Shuffle(2,1,2,1);
+  }
+  // adjugate(`a`) x `b`
+  static inline XMM<float> Mat2AdjugateMultiply(const XMM<float>& a, const XMM<float>& b)
+  {
+    return a.Shuffle(3,3,0,0) * b - a.Shuffle(1,1,2,2) * b.Shuffle(2,3,0,1);
+  }
+  // `a` x adjugate(`b`)
+  static inline XMM<float> Mat2MultiplyAdjugate(const XMM<float>& a, const XMM<float>& b)
+  {
+    return a * b.Shuffle(3,0,3,0) - a.Shuffle(1,0,3,2) * b.Shuffle(2,1,2,1);
+  }
+
+  M4x4 M4x4::Identity() noexcept
+  {
+    M4x4 m;
+    m.p_[0][0] = m.p_[1][1] = m.p_[2][2] = m.p_[3][3] = 1;
+    return m;
+  }
+
+  M4x4 M4x4::Compose(const V4& translation, const Q4& rotation, const V4& scale) noexcept
+  {
+    const float* q = rotation.p_;
+    float x2 = q[0] + q[0], y2 = q[1] + q[1], z2 = q[2] + q[2];
+    float xx = q[0] * x2, yy = q[1] * y2, zz = q[2] * z2;
+    float xy = q[0] * y2, xz = q[0] * z2, yz = q[1] * z2;
+    float wx = q[3] * x2, wy = q[3] * y2, wz = q[3] * z2;
+
+    // The rotation matrix columns, each scaled by its own scale component.
+    M4x4 m;
+    (XMM<float>(1 - (yy + zz), xy + wz, xz - wy, 0) * XMM<float>(scale.p_[0])).Store(m.p_[0]);
+    (XMM<float>(xy - wz, 1 - (xx + zz), yz + wx, 0) * XMM<float>(scale.p_[1])).Store(m.p_[1]);
+    (XMM<float>(xz + wy, yz - wx, 1 - (xx + yy), 0) * XMM<float>(scale.p_[2])).Store(m.p_[2]);
+    XMM<float>(translation.p_).Blend(XMM<float>(1.0f), 0b1000).Store(m.p_[3]);
+    return m;
+  }
+
+  M4x4 M4x4::operator *(const M4x4& b) const noexcept
+  {
+    // Column j of the result is `*this` applied on column j of `b`, so the sum of our columns times the components of b's column.
+    XMM<float> c0(p_[0]), c1(p_[1]), c2(p_[2]), c3(p_[3]);
+    M4x4 r;
+    for (unsigned j = 0; j < 4; ++j)
+    {
+      XMM<float> res = c0 * XMM<float>(b.p_[j][0]) + c1 * XMM<float>(b.p_[j][1]) + c2 * XMM<float>(b.p_[j][2]) + c3 * XMM<float>(b.p_[j][3]);
+      res.Store(r.p_[j]);
+    }
+    return r;
+  }
+
+  M4x4 M4x4::Transposed() const noexcept
+  {
+    XMM<float> c0(p_[0]), c1(p_[1]), c2(p_[2]), c3(p_[3]);
+    XMM<float>::Transpose(c0, c1, c2, c3);
+
+    M4x4 r;
+    c0.Store(r.p_[0]);
+    c1.Store(r.p_[1]);
+    c2.Store(r.p_[2]);
+    c3.Store(r.p_[3]);
+    return r;
+  }
+
+  M4x4 M4x4::InverseAffine() const noexcept
+  {
+    // For the 3x3 part with columns a, b, c the inverse's rows are (b x c), (c x a), (a x b), all divided by the determinant a.(b x c).
+    XMM<float> a(p_[0]), b(p_[1]), c(p_[2]);
+    XMM<float> r0 = b.CrossProduct(c), r1 = c.CrossProduct(a), r2 = a.CrossProduct(b);
+    XMM<float> inv_det = XMM<float>(1.0f) / a.DotProduct(r0, 0b0111).Shuffle(0,0,0,0);
+
+    r0 *= inv_det;
+    r1 *= inv_det;
+    r2 *= inv_det;
+    // The cross products leave W as 0, so the last row is 0 for now.
+    XMM<float> r3;
+    r3.ZeroOut();
+    XMM<float>::Transpose(r0, r1, r2, r3);
+
+    // The translation is undone after the rotation and scale are, so it is -(inverse 3x3 x translation).
+    XMM<float> t(p_[3]);
+    XMM<float> inv_t = -(r0 * t.Shuffle(0,0,0,0) + r1 * t.Shuffle(1,1,1,1) + r2 * t.Shuffle(2,2,2,2));
+
+    M4x4 m;
+    r0.Store(m.p_[0]);
+    r1.Store(m.p_[1]);
+    r2.Store(m.p_[2]);
+    inv_t.Blend(XMM<float>(1.0f), 0b1000).Store(m.p_[3]);
+    return m;
+  }
+
+  M4x4 M4x4::Inverse() const noexcept
+  {
+    // Blockwise inversion with 2x2 sub matrices, M = [[A,B],[C,D]].
+    // The algorithm is written for rows, but inverse(transpose(M)) = transpose(inverse(M)), so running it on our columns gives the columns of the inverse.
+    XMM<float> c0(p_[0]), c1(p_[1]), c2(p_[2]), c3(p_[3]);
+
+    XMM<float> A = c0.Shuffle(c1, 0,1,0,1);
+    XMM<float> B = c0.Shuffle(c1, 2,3,2,3);
+    XMM<float> C = c2.Shuffle(c3, 0,1,0,1);
+    XMM<float> D = c2.Shuffle(c3, 2,3,2,3);
+
+    // [|A|,|B|,|C|,|D|]
+    XMM<float> det_sub = c0.Shuffle(c2, 0,2,0,2) * c1.Shuffle(c3, 1,3,1,3) - c0.Shuffle(c2, 1,3,1,3) * c1.Shuffle(c3, 0,2,0,2);
+    XMM<float> det_a = det_sub.Shuffle(0,0,0,0);
+    XMM<float> det_b = det_sub.Shuffle(1,1,1,1);
+    XMM<float> det_c = det_sub.Shuffle(2,2,2,2);
+    XMM<float> det_d = det_sub.Shuffle(3,3,3,3);
+
+    // With # being the adjugate, inverse(M) = 1/|M| * [[X,Y],[Z,W]]
+    XMM<float> d_c = Mat2AdjugateMultiply(D, C);
+    XMM<float> a_b = Mat2AdjugateMultiply(A, B);
+    // X# = |D|A - B(D#C), W# = |A|D - C(A#B)
+    XMM<float> x_ = det_d * A - Mat2Multiply(B, d_c);
+    XMM<float> w_ = det_a * D - Mat2Multiply(C, a_b);
+    // Y# = |B|C - D(A#B)#, Z# = |C|B - A(D#C)#
+    XMM<float> y_ = det_b * C - Mat2MultiplyAdjugate(D, a_b);
+    XMM<float> z_ = det_c * B - Mat2MultiplyAdjugate(A, d_c);
+
+    // |M| = |A||D| + |B||C| - tr((A#B)(D#C))
+    XMM<float> tr = a_b * d_c.Shuffle(0,2,1,3);
+    tr += tr.Shuffle(1,0,3,2);
+    tr += tr.Shuffle(2,3,0,1);
+    XMM<float> det_m = det_a * det_d + det_b * det_c - tr;
+
+    // The signs of the adjugate are folded in here.
+    XMM<float> inv_det_m = XMM<float>(1.0f, -1.0f, -1.0f, 1.0f) / det_m;
+    x_ *= inv_det_m;
+    y_ *= inv_det_m;
+    z_ *= inv_det_m;
+    w_ *= inv_det_m;
+
+    // The adjugate's swaps are done with the shuffle that puts the blocks back together.
+    M4x4 m;
+    x_.Shuffle(y_, 3,1,3,1).Store(m.p_[0]);
+    x_.Shuffle(y_, 2,0,2,0).Store(m.p_[1]);
+    z_.Shuffle(w_, 3,1,3,1).Store(m.p_[2]);
+    z_.Shuffle(w_, 2,0,2,0).Store(m.p_[3]);
+    return m;
+  }
+
   void V4::Normalize(int mask) noexcept
   {
     // Load the vector to begin calculating the inverse magnitude
     XMM<float> vec_128(p_);
-    
-    XMM<float> inv_mag_128 = vec_128.DotProduct(vec_128, mask).ISquareRoot();
 
+    // `_mm_dp_ps()` wants its mask as an immediate, and `mask` is not one, so the components left out are zeroed instead.
+    XMM<float> masked = vec_128 & XMM<int32_t>(
+      mask & 0b0001 ? -1 : 0, mask & 0b0010 ? -1 : 0, mask & 0b0100 ? -1 : 0, mask & 0b1000 ? -1 : 0
+    ).AsFloats();
     // Reload it into the register but this time for all its components.
-    inv_mag_128 = inv_mag_128.Shuffle(0,0,0,0);
+    XMM<float> mag_squared_128 = masked.DotProduct(masked).Shuffle(0,0,0,0);
+
+    // One Newton-Raphson step, y * (1.5 - 0.5 * x * y * y), ~12 bits to ~22.
+    XMM<float> inv_mag_128 = mag_squared_128.ISquareRoot();
+    inv_mag_128 = inv_mag_128 * (XMM<float>(1.5f) - XMM<float>(0.5f) * mag_squared_128 * inv_mag_128 * inv_mag_128);
+
     // Finally the moment we were all waiting for
     vec_128 *= inv_mag_128;
     vec_128.Store(p_);
@@ -20,99 +171,190 @@ namespace nogl
   {
     n_ = n;
 
-    // To fit the 256 alignment.
-    unsigned extras = n % (kAlign / sizeof (V4));
+    // To fit the alignment, and so the widest kernels can overrun the last vector.
+    unsigned capacity = (n + kBatch - 1) / kBatch * kBatch;
     
     buffer_ = std::unique_ptr<V4[]>(
-      new (std::align_val_t(kAlign)) V4[n + extras]
+      new (std::align_val_t(kAlign)) V4[capacity]
     );
   }
 
   void VOV4::DivideByW(VOV4& output, unsigned from, unsigned to)
   {
-    for (unsigned vec = from; vec < to; vec += (kAlign / sizeof(V4)))
-    {
-      const V4* in_ptr = buffer_.get() + vec;
-      V4* out_ptr = output.buffer_.get() + vec;
-      
-      // Load the 2 vectors into the register
-      YMM<float> ab(in_ptr->p_);
-
-      // Load the w components all over the 2 parts of the register
-      XMM<float> a = in_ptr[0].p_[3];
-      XMM<float> b = in_ptr[1].p_[3];
-      YMM<float> w(a,b);
-
-      ab /= w;
-      ab.Store(out_ptr->p_);
-    }
+    Simd::kernels().divide_by_w(output.buffer_.get()->p_, buffer_.get()->p_, from, to);
   }
   
   void VOV4::Multiply(VOV4& output, const M4x4& m, unsigned from, unsigned to) noexcept
   {
-    // We do the same thing in V4 but 2 for 1 essentially
-    // NOTE: We jump 2 vectors ofc, not 1, but just hu.
-    for (unsigned vec = from; vec < to; vec += (kAlign / sizeof(V4)))
-    {
-      const V4* in_ptr = buffer_.get() + vec;
-      V4* out_ptr = output.buffer_.get() + vec;
+    Simd::kernels().multiply(output.buffer_.get()->p_, buffer_.get()->p_, m.p_[0], from, to);
+  }
+
+  void VOV4::Project(VOV4& output, uint8_t* outcodes, const M4x4& m, float width, float height, unsigned from, unsigned to) const noexcept
+  {
+    Simd::kernels().project(output.buffer_.get()->p_, outcodes, buffer_.get()->p_, m.p_[0], width, height, from, to);
+  }
 
-      YMM<float> res;
-      res.ZeroOut();
+  void VOV4::Add(VOV4& output, const V4& v, unsigned from, unsigned to)
+  {
+    Simd::kernels().add(output.buffer_.get()->p_, buffer_.get()->p_, v.p_, from, to);
+  }
+
+  void VOV4::AddScaled(VOV4& output, const VOV4& v, float s, unsigned from, unsigned to) const noexcept
+  {
+    Simd::kernels().add_scaled(output.buffer_.get()->p_, buffer_.get()->p_, v.buffer_.get()->p_, s, from, to);
+  }
+
+  void VOV4::ScatterAddScaled(const unsigned* indices, const VOV4& v, float s, unsigned from, unsigned to) noexcept
+  {
+    Simd::kernels().scatter_add_scaled(buffer_.get()->p_, indices, v.buffer_.get()->p_, s, from, to);
+  }
+
+  void VOV4::Rotate(VOV4& output, const Q4& q, unsigned from, unsigned to)
+  {
+    Simd::kernels().rotate(output.buffer_.get()->p_, buffer_.get()->p_, q.p_, from, to);
+  }
+
+  void VOV4::Normalize(VOV4& output, Precision precision, unsigned from, unsigned to) const noexcept
+  {
+    Simd::kernels().normalize(output.buffer_.get()->p_, buffer_.get()->p_, precision == Precision::kPrecise, from, to);
+  }
 
-      for (unsigned i = 0; i < 4; ++i)
+  void VOV4::MultiplyNormals(VOV4& output, const M4x4& m, Precision precision, unsigned from, unsigned to) const noexcept
+  {
+    Simd::kernels().multiply_normals(output.buffer_.get()->p_, buffer_.get()->p_, m.p_[0], precision == Precision::kPrecise, from, to);
+  }
+
+  void VOV4::DotProduct(float* out, const VOV4& b, unsigned from, unsigned to) const noexcept
+  {
+    Simd::kernels().dot(out, buffer_.get()->p_, b.buffer_.get()->p_, from, to);
+  }
+
+  void VOV4::DotProduct(float* out, const V4& v, unsigned from, unsigned to) const noexcept
+  {
+    Simd::kernels().dot_vector(out, buffer_.get()->p_, v.p_, from, to);
+  }
+
+  void VOV4::CrossProduct(VOV4& output, const VOV4& b, unsigned from, unsigned to) const noexcept
+  {
+    Simd::kernels().cross(output.buffer_.get()->p_, buffer_.get()->p_, b.buffer_.get()->p_, from, to);
+  }
+
+  void VOV4::Slerp(VOV4& output, const VOV4& b, const float* t, unsigned from, unsigned to) const noexcept
+  {
+    Simd::kernels().slerp(output.buffer_.get()->p_, buffer_.get()->p_, b.buffer_.get()->p_, t, from, to);
+  }
+
+  void VOV2::Reallocate(unsigned n)
+  {
+    n_ = n;
+
+    // Zeroed like `SOV4`, and padded like `VOV4` so XMM copies can overrun the last vector.
+    unsigned capacity = (n + kBatch - 1) / kBatch * kBatch;
+    buffer_ = std::unique_ptr<float[]>(
+      new (std::align_val_t(kAlign)) float[capacity * 2]()
+    );
+  }
+
+  void SOVH::Reallocate(unsigned n, unsigned components)
+  {
+    n_ = n;
+    components_ = components;
+    capacity_ = (n + kBatch - 1) / kBatch * kBatch;
+
+    // Zeroed like `SOV4`, a zero half is a zero float.
+    buffer_ = std::unique_ptr<uint16_t[]>(
+      new (std::align_val_t(kAlign)) uint16_t[capacity_ * components_]()
+    );
+  }
+
+  void SOVH::operator =(const VOV4& vov) noexcept
+  {
+    Simd::kernels().sovh_from_vov4(buffer_.get(), capacity_, components_, vov.buffer_.get()->p_, std::min(n_, vov.n_));
+  }
+
+  void SOVH::CopyTo(VOV4& vov) const noexcept
+  {
+    Simd::kernels().sovh_to_vov4(vov.buffer_.get()->p_, buffer_.get(), capacity_, components_, std::min(n_, vov.n_));
+  }
+
+  void SOVH::Multiply(VOV4& output, const M4x4& m, unsigned from, unsigned to) const noexcept
+  {
+    Simd::kernels().sovh_multiply(output.buffer_.get()->p_, buffer_.get(), capacity_, components_, m.p_[0], from, to);
+  }
+
+  void SOVQ::Reallocate(unsigned n)
+  {
+    n_ = n;
+    capacity_ = (n + kBatch - 1) / kBatch * kBatch;
+
+    buffer_ = std::unique_ptr<int16_t[]>(
+      new (std::align_val_t(kAlign)) int16_t[capacity_ * 3]()
+    );
+  }
+
+  M4x4 SOVQ::Quantize(const VOV4& vov)
+  {
+    Reallocate(vov.n());
+
+    float center[3] = {0,0,0}, step[3] = {0,0,0};
+    for (unsigned c = 0; c < 3 && n_ > 0; ++c)
+    {
+      float min = vov[0][c], max = vov[0][c];
+      for (unsigned vec = 1; vec < n_; ++vec)
       {
-        // Load the matrix column into both 128 parts of the AVX
-        // __m128 col = _mm_load_ps(m.p_[i]);
-        // __m256 cols = reinterpret_cast<__m256>(
-        //   _mm256_broadcastsi128_si256(reinterpret_cast<__m128i>(col))
-        // );
-        YMM<float> cols;
-        cols.Broadcast4Floats(m.p_[i]);
-
-        // a is the i-th components COPIED all over from in_ptr[0] and b is same but for in_ptr[1], example [X1,X1,X1,X1 , X0,X0,X0,X0]
-        XMM<float> a(in_ptr[0].p_[i]);
-        XMM<float> b(in_ptr[1].p_[i]);
-        YMM<float> ab(a,b);
-
-        ab *= cols;
-        res += ab;
+        min = std::min(min, vov[vec][c]);
+        max = std::max(max, vov[vec][c]);
       }
 
-      res.Store(out_ptr->p_);
+      // -32767..32767 spans the box, symmetric so the center is exactly 0.
+      center[c] = (min + max) / 2;
+      step[c] = (max - min) / 2 / 32767;
+      for (unsigned vec = 0; vec < n_; ++vec)
+      {
+        // A flat box(everything on a plane) has a step of 0, it's all the center then.
+        float q = step[c] > 0 ? __builtin_roundf((vov[vec][c] - center[c]) / step[c]) : 0;
+        stream(c)[vec] = static_cast<int16_t>(std::clamp(q, -32767.0f, 32767.0f));
+      }
     }
+
+    const float dequantization[4*4] = {
+      step[0], 0, 0, center[0],
+      0, step[1], 0, center[1],
+      0, 0, step[2], center[2],
+      0, 0, 0, 1,
+    };
+    return M4x4(dequantization);
   }
 
-  void VOV4::Add(VOV4& output, const V4& v, unsigned from, unsigned to)
+  void SOVQ::Project(VOV4& output, uint8_t* outcodes, const M4x4& m, float width, float height, unsigned from, unsigned to) const noexcept
   {
-    for (unsigned vec = from; vec < to; vec += (kAlign / sizeof(V4)))
-    {
-      const V4* in_ptr = buffer_.get() + vec;
-      V4* out_ptr = output.buffer_.get() + vec;
-
-      YMM<float> ab(in_ptr->p_);
+    Simd::kernels().sovq_project(output.buffer_.get()->p_, outcodes, buffer_.get(), capacity_, m.p_[0], width, height, from, to);
+  }
 
-      YMM<float> cd;
-      cd.Broadcast4Floats(v.p_);
+  void SOV4::Reallocate(unsigned n)
+  {
+    n_ = n;
+    capacity_ = (n + kBatch - 1) / kBatch * kBatch;
 
-      ab += cd;
-      ab.Store(out_ptr->p_);
-    }
+    // Zeroed so the padding never holds garbage(denormals or NaNs slow everything down).
+    buffer_ = std::unique_ptr<float[]>(
+      new (std::align_val_t(kAlign)) float[capacity_ * 4]()
+    );
   }
 
-  void VOV4::Rotate(VOV4& output, const Q4& q, unsigned from, unsigned to)
+  void SOV4::operator =(const VOV4& vov) noexcept
   {
-    YMM<float> q256;
-    q256.Broadcast4Floats(q.p_);
-    for (unsigned vec = from; vec < to; vec += (kAlign / sizeof(V4)))
-    {
-      const V4* in_ptr = buffer_.get() + vec;
-      V4* out_ptr = output.buffer_.get() + vec;
+    Simd::kernels().sov4_from_vov4(buffer_.get(), capacity_, vov.buffer_.get()->p_, std::min(n_, vov.n_));
+  }
 
-      YMM<float> ab(in_ptr->p_);
+  void SOV4::CopyTo(VOV4& vov) const noexcept
+  {
+    Simd::kernels().sov4_to_vov4(vov.buffer_.get()->p_, buffer_.get(), capacity_, std::min(n_, vov.n_));
+  }
 
-      ab = ab.QVSandwich(q256);
-      ab.Store(out_ptr->p_);
-    }
+  void SOV4::Multiply(SOV4& output, const M4x4& m, unsigned from, unsigned to) const noexcept
+  {
+    // NOTE: Both must have the same capacity, the streams are at the same offsets.
+    Simd::kernels().sov4_multiply(output.buffer_.get(), buffer_.get(), capacity_, m.p_[0], from, to);
   }
 }
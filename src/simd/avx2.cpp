@@ -0,0 +1,717 @@
+// The AVX2 kernels, this file alone is compiled with -mavx2 -mfma -mf16c. 8 wide.
+#include "Simd.hpp"
+#include "math.hpp"
+#include "YMM.hpp"
+
+#include <cmath>
+
+namespace nogl
+{
+  // Loads 8 consecutive vectors from `f`(32 floats, aligned to 256 bits) and transposes them, so `soa[c]` holds component `c` of all 8.
+  static inline void LoadTransposed(const float* f, YMM<float> soa[4])
+  {
+    // Each lane is a vector: [v0|v4], [v1|v5], [v2|v6], [v3|v7]
+    YMM<float> r0, r1, r2, r3;
+    r0.Load4Floats(f + 0*4, f + 4*4);
+    r1.Load4Floats(f + 1*4, f + 5*4);
+    r2.Load4Floats(f + 2*4, f + 6*4);
+    r3.Load4Floats(f + 3*4, f + 7*4);
+
+    // The classic 4x4 transpose, done in both lanes at once: [x0,x1,y0,y1], [z0,z1,w0,w1], [x2,x3,y2,y3], [z2,z3,w2,w3]
+    YMM<float> t0 = r0.UnpackLow(r1), t1 = r0.UnpackHigh(r1);
+    YMM<float> t2 = r2.UnpackLow(r3), t3 = r2.UnpackHigh(r3);
+
+    soa[0] = t0.Shuffle(t2, 0,1,0,1);
+    soa[1] = t0.Shuffle(t2, 2,3,2,3);
+    soa[2] = t1.Shuffle(t3, 0,1,0,1);
+    soa[3] = t1.Shuffle(t3, 2,3,2,3);
+  }
+
+  // Reverse of `LoadTransposed()`, stores 8 vectors into `f`.
+  static inline void StoreTransposed(const YMM<float> soa[4], float* f)
+  {
+    // [x0,y0,x1,y1], [x2,y2,x3,y3], [z0,w0,z1,w1], [z2,w2,z3,w3] in both lanes.
+    YMM<float> t0 = soa[0].UnpackLow(soa[1]), t1 = soa[0].UnpackHigh(soa[1]);
+    YMM<float> t2 = soa[2].UnpackLow(soa[3]), t3 = soa[2].UnpackHigh(soa[3]);
+
+    // [v0|v4], [v1|v5], [v2|v6], [v3|v7]
+    YMM<float> r0 = t0.Shuffle(t2, 0,1,0,1), r1 = t0.Shuffle(t2, 2,3,2,3);
+    YMM<float> r2 = t1.Shuffle(t3, 0,1,0,1), r3 = t1.Shuffle(t3, 2,3,2,3);
+
+    // Now pair up the lanes so every store is 2 consecutive vectors.
+    r0.PermuteLanes(r1, 0, 2).Store(f + 0*4);
+    r2.PermuteLanes(r3, 0, 2).Store(f + 2*4);
+    r0.PermuteLanes(r1, 1, 3).Store(f + 4*4);
+    r2.PermuteLanes(r3, 1, 3).Store(f + 6*4);
+  }
+
+  // `soa` x `m`, the matrix columns are broadcast, 16 registers is everything there is, so they are reloaded every time, L1 hits anyway.
+  static inline void MultiplyTransposed(const YMM<float> in[4], const float* m, YMM<float> out[4])
+  {
+    for (unsigned j = 0; j < 4; ++j)
+    {
+      out[j] = in[0] * YMM<float>(m[0*4 + j]);
+      for (unsigned i = 1; i < 4; ++i)
+      {
+        out[j] = in[i].MultiplyAdd(YMM<float>(m[i*4 + j]), out[j]);
+      }
+    }
+  }
+
+  static void Multiply(float* out, const float* in, const float* m, unsigned from, unsigned to)
+  {
+    // We do the same thing in V4 but 2 for 1 essentially
+    for (unsigned vec = from; vec < to; vec += 2)
+    {
+      const float* in_ptr = in + vec * 4;
+
+      YMM<float> res;
+      res.ZeroOut();
+
+      for (unsigned i = 0; i < 4; ++i)
+      {
+        // Load the matrix column into both 128 parts of the AVX
+        YMM<float> cols;
+        cols.Broadcast4Floats(m + i * 4);
+
+        // a is the i-th components COPIED all over from in_ptr[0] and b is same but for in_ptr[1], example [X1,X1,X1,X1 , X0,X0,X0,X0]
+        XMM<float> a = in_ptr[i], b = in_ptr[4 + i];
+        YMM<float> ab(a, b);
+        res = ab.MultiplyAdd(cols, res);
+      }
+
+      res.Store(out + vec * 4);
+    }
+  }
+
+  static void DivideByW(float* out, const float* in, unsigned from, unsigned to)
+  {
+    for (unsigned vec = from; vec < to; vec += 2)
+    {
+      const float* in_ptr = in + vec * 4;
+
+      // Load the 2 vectors into the register
+      YMM<float> ab(in_ptr);
+      // Load the w components all over the 2 parts of the register
+      XMM<float> a = in_ptr[3], b = in_ptr[4 + 3];
+      YMM<float> w(a, b);
+
+      ab /= w;
+      ab.Store(out + vec * 4);
+    }
+  }
+
+  static void Add(float* out, const float* in, const float* v, unsigned from, unsigned to)
+  {
+    YMM<float> cd;
+    cd.Broadcast4Floats(v);
+    for (unsigned vec = from; vec < to; vec += 2)
+    {
+      (YMM<float>(in + vec * 4) + cd).Store(out + vec * 4);
+    }
+  }
+
+  static void AddScaled(float* out, const float* in, const float* v, float s, unsigned from, unsigned to)
+  {
+    YMM<float> s256(s);
+    for (unsigned vec = from; vec < to; vec += 2)
+    {
+      YMM<float>(v + vec * 4).MultiplyAdd(s256, YMM<float>(in + vec * 4)).Store(out + vec * 4);
+    }
+  }
+
+  static void Rotate(float* out, const float* in, const float* q, unsigned from, unsigned to)
+  {
+    YMM<float> q256;
+    q256.Broadcast4Floats(q);
+    for (unsigned vec = from; vec < to; vec += 2)
+    {
+      YMM<float>(in + vec * 4).QVSandwich(q256).Store(out + vec * 4);
+    }
+  }
+
+  // The rest of `Project()` once the vectors are in clip space, `clip[c]` is component `c` of 8 vectors. Writes their outcodes, and stores them projected to `out`.
+  static inline void ProjectTransposed(const YMM<float> clip[4], float width, float height, float* out, uint8_t* outcodes)
+  {
+    const YMM<float> zero = 0.0f, two = 2.0f, width_256 = width, height_256 = height;
+
+    const YMM<float>& x = clip[0], & y = clip[1], & z = clip[2], & w = clip[3];
+
+    // Outcodes are done before the divide, where the planes are just comparisons with w. The viewport is baked into the matrix, so x is 0..width*w.
+    YMM<float> codes =
+      (x.LessThan(zero) & YMM<float>(static_cast<float>(VOV4::kOutLeft))) +
+      (x.GreaterThan(w * width_256) & YMM<float>(static_cast<float>(VOV4::kOutRight))) +
+      (y.LessThan(zero) & YMM<float>(static_cast<float>(VOV4::kOutTop))) +
+      (y.GreaterThan(w * height_256) & YMM<float>(static_cast<float>(VOV4::kOutBottom))) +
+      (z.LessThan(-w) & YMM<float>(static_cast<float>(VOV4::kOutNear))) +
+      (z.GreaterThan(w) & YMM<float>(static_cast<float>(VOV4::kOutFar)));
+    codes.StoreAsBytes(outcodes);
+
+    // Approximate reciprocal is 12 bits, one Newton-Raphson step brings it to ~22 for a fraction of a real division.
+    YMM<float> inv_w = w.Reciprocal();
+    inv_w = inv_w * (two - w * inv_w);
+
+    // [x/w, y/w, z/w, 1/w], the last one is kept for perspective correct interpolation.
+    YMM<float> projected[4] = {x * inv_w, y * inv_w, z * inv_w, inv_w};
+    StoreTransposed(projected, out);
+  }
+
+  static void Project(float* out, uint8_t* outcodes, const float* in, const float* m, float width, float height, unsigned from, unsigned to)
+  {
+    for (unsigned vec = from; vec < to; vec += 8)
+    {
+      YMM<float> soa[4];
+      LoadTransposed(in + vec * 4, soa);
+
+      // Clip space, clip[i] is the i-th component of 8 vectors.
+      YMM<float> clip[4];
+      MultiplyTransposed(soa, m, clip);
+      ProjectTransposed(clip, width, height, out + vec * 4, outcodes + vec);
+    }
+  }
+
+  static void SOVQProject(float* out, uint8_t* outcodes, const int16_t* in, unsigned capacity, const float* m, float width, float height, unsigned from, unsigned to)
+  {
+    for (unsigned vec = from; vec < to; vec += 8)
+    {
+      // The integers are converted as they are, the dequantization is in `m`.
+      YMM<float> soa[4];
+      for (unsigned c = 0; c < 3; ++c)
+      {
+        soa[c] = YMM<int32_t>::LoadWidened(in + c * capacity + vec).ToFloats();
+      }
+      soa[3] = 1.0f;
+
+      YMM<float> clip[4];
+      MultiplyTransposed(soa, m, clip);
+      ProjectTransposed(clip, width, height, out + vec * 4, outcodes + vec);
+    }
+  }
+
+  // See the SSE4.1 version, 8 boxes at a time.
+  static void CullBoxes(uint8_t* visible, const float* centers, const float* extents, unsigned capacity, const float* planes, unsigned n)
+  {
+    const YMM<float> zero = 0.0f, one = 1.0f;
+
+    for (unsigned box = 0; box < n; box += 8)
+    {
+      YMM<float> c[3], e[3];
+      for (unsigned i = 0; i < 3; ++i)
+      {
+        c[i] = YMM<float>(centers + i * capacity + box);
+        e[i] = YMM<float>(extents + i * capacity + box);
+      }
+
+      YMM<float> nearest;
+      for (unsigned p = 0; p < 6; ++p)
+      {
+        const float* plane = planes + p * 4;
+        YMM<float> distance = c[2].MultiplyAdd(plane[2], c[1].MultiplyAdd(plane[1], c[0].MultiplyAdd(plane[0], plane[3])));
+        YMM<float> reach = e[2].MultiplyAdd(std::abs(plane[2]), e[1].MultiplyAdd(std::abs(plane[1]), e[0] * YMM<float>(std::abs(plane[0]))));
+        nearest = p == 0 ? distance + reach : nearest.Min(distance + reach);
+      }
+      (zero.LessOrEqual(nearest) & one).StoreAsBytes(visible + box);
+    }
+  }
+
+  // See the SSE4.1 version, ~12 bits raw, ~22 `refine`d, and zero gives 0.
+  static inline YMM<float> InverseLength(const YMM<float>& x, bool refine)
+  {
+    YMM<float> y = x.ISquareRoot();
+    if (refine)
+    {
+      y = y * (YMM<float>(1.5f) - YMM<float>(0.5f) * x * y * y);
+    }
+    return y & x.GreaterThan(YMM<float>(0.0f));
+  }
+
+  // Normalizes the x, y and z of `soa`, w is left alone.
+  static inline void NormalizeTransposed(YMM<float> soa[4], bool refine)
+  {
+    YMM<float> length_squared = soa[0] * soa[0];
+    length_squared = soa[1].MultiplyAdd(soa[1], length_squared);
+    length_squared = soa[2].MultiplyAdd(soa[2], length_squared);
+
+    YMM<float> inv_length = InverseLength(length_squared, refine);
+    for (unsigned c = 0; c < 3; ++c)
+    {
+      soa[c] *= inv_length;
+    }
+  }
+
+  static void Normalize(float* out, const float* in, bool refine, unsigned from, unsigned to)
+  {
+    for (unsigned vec = from; vec < to; vec += 8)
+    {
+      YMM<float> soa[4];
+      LoadTransposed(in + vec * 4, soa);
+      NormalizeTransposed(soa, refine);
+      StoreTransposed(soa, out + vec * 4);
+    }
+  }
+
+  static void MultiplyNormals(float* out, const float* in, const float* m, bool refine, unsigned from, unsigned to)
+  {
+    for (unsigned vec = from; vec < to; vec += 8)
+    {
+      YMM<float> soa[4], res[4];
+      LoadTransposed(in + vec * 4, soa);
+
+      // Only the upper 3x3, directions are not translated, and w is kept.
+      for (unsigned j = 0; j < 3; ++j)
+      {
+        res[j] = soa[0] * YMM<float>(m[0*4 + j]);
+        res[j] = soa[1].MultiplyAdd(YMM<float>(m[1*4 + j]), res[j]);
+        res[j] = soa[2].MultiplyAdd(YMM<float>(m[2*4 + j]), res[j]);
+      }
+      res[3] = soa[3];
+
+      NormalizeTransposed(res, refine);
+      StoreTransposed(res, out + vec * 4);
+    }
+  }
+
+  static void Skin(float* out_positions, float* out_normals, const float* positions, const float* normals, const uint16_t* joints, const float* weights, unsigned capacity, const float* matrices, unsigned from, unsigned to)
+  {
+    for (unsigned vec = from; vec < to; vec += 8)
+    {
+      // The blended matrix of each of the 8 vertices, SoA, `m[col*3 + row]`. The last rows are [0,0,0,1] for every joint so they are skipped.
+      YMM<float> m[12];
+      for (unsigned k = 0; k < 4; ++k)
+      {
+        // Every vertex has its own joint, so each element is gathered from 8 matrices at once, 16 floats apart.
+        YMM<int32_t> offsets = YMM<int32_t>::LoadWidened(joints + k * capacity + vec) << 4;
+        YMM<float> weight(weights + k * capacity + vec);
+        for (unsigned e = 0; e < 12; ++e)
+        {
+          YMM<float> element = YMM<float>::Gather(matrices + e / 3 * 4 + e % 3, offsets);
+          m[e] = k == 0 ? element * weight : element.MultiplyAdd(weight, m[e]);
+        }
+      }
+
+      YMM<float> soa[4], res[4];
+      LoadTransposed(positions + vec * 4, soa);
+      for (unsigned j = 0; j < 3; ++j)
+      {
+        res[j] = soa[0].MultiplyAdd(m[0*3 + j], m[3*3 + j]);
+        res[j] = soa[1].MultiplyAdd(m[1*3 + j], res[j]);
+        res[j] = soa[2].MultiplyAdd(m[2*3 + j], res[j]);
+      }
+      res[3] = 1.0f;
+      StoreTransposed(res, out_positions + vec * 4);
+
+      if (normals != nullptr)
+      {
+        LoadTransposed(normals + vec * 4, soa);
+        for (unsigned j = 0; j < 3; ++j)
+        {
+          res[j] = soa[0] * m[0*3 + j];
+          res[j] = soa[1].MultiplyAdd(m[1*3 + j], res[j]);
+          res[j] = soa[2].MultiplyAdd(m[2*3 + j], res[j]);
+        }
+        res[3] = soa[3];
+        NormalizeTransposed(res, true);
+        StoreTransposed(res, out_normals + vec * 4);
+      }
+    }
+  }
+
+  static void Dot(float* out, const float* a, const float* b, unsigned from, unsigned to)
+  {
+    for (unsigned vec = from; vec < to; vec += 8)
+    {
+      YMM<float> sa[4], sb[4];
+      LoadTransposed(a + vec * 4, sa);
+      LoadTransposed(b + vec * 4, sb);
+      sa[2].MultiplyAdd(sb[2], sa[1].MultiplyAdd(sb[1], sa[0] * sb[0])).StoreUnaligned(out + vec);
+    }
+  }
+
+  static void DotVector(float* out, const float* a, const float* v, unsigned from, unsigned to)
+  {
+    const YMM<float> vx = v[0], vy = v[1], vz = v[2];
+    for (unsigned vec = from; vec < to; vec += 8)
+    {
+      YMM<float> sa[4];
+      LoadTransposed(a + vec * 4, sa);
+      sa[2].MultiplyAdd(vz, sa[1].MultiplyAdd(vy, sa[0] * vx)).StoreUnaligned(out + vec);
+    }
+  }
+
+  static void Cross(float* out, const float* a, const float* b, unsigned from, unsigned to)
+  {
+    for (unsigned vec = from; vec < to; vec += 8)
+    {
+      YMM<float> sa[4], sb[4];
+      LoadTransposed(a + vec * 4, sa);
+      LoadTransposed(b + vec * 4, sb);
+
+      YMM<float> res[4] = {
+        sa[1] * sb[2] - sa[2] * sb[1],
+        sa[2] * sb[0] - sa[0] * sb[2],
+        sa[0] * sb[1] - sa[1] * sb[0],
+        0.0f,
+      };
+      StoreTransposed(res, out + vec * 4);
+    }
+  }
+
+  // See the SSE4.1 version.
+  static inline YMM<float> CorrectSlerpT(const YMM<float>& t, const YMM<float>& d)
+  {
+    YMM<float> a = d.MultiplyAdd(d.MultiplyAdd(d.MultiplyAdd(-1.43519f, 3.55645f), -3.2452f), 1.0904f);
+    YMM<float> b = d.MultiplyAdd(d.MultiplyAdd(0.215638f, -1.06021f), 0.848013f);
+    YMM<float> centered = t - YMM<float>(0.5f);
+    YMM<float> k = (centered * centered).MultiplyAdd(a, b);
+    return (t * centered * (t - YMM<float>(1.0f))).MultiplyAdd(k, t);
+  }
+
+  static void Slerp(float* out, const float* a, const float* b, const float* t, unsigned from, unsigned to)
+  {
+    for (unsigned vec = from; vec < to; vec += 8)
+    {
+      YMM<float> sa[4], sb[4];
+      LoadTransposed(a + vec * 4, sa);
+      LoadTransposed(b + vec * 4, sb);
+
+      // `q` and `-q` are the same rotation, the one closer to `a` is the shorter arc.
+      YMM<float> dot = sa[0] * sb[0];
+      for (unsigned c = 1; c < 4; ++c)
+      {
+        dot = sa[c].MultiplyAdd(sb[c], dot);
+      }
+      YMM<float> sign = (dot.LessThan(0.0f) & YMM<float>(-2.0f)) + YMM<float>(1.0f);
+      YMM<float> t_b = CorrectSlerpT(YMM<float>(t + vec), dot * sign);
+      YMM<float> t_a = YMM<float>(1.0f) - t_b;
+      t_b *= sign;
+
+      YMM<float> res[4];
+      for (unsigned c = 0; c < 4; ++c)
+      {
+        res[c] = sb[c].MultiplyAdd(t_b, sa[c] * t_a);
+      }
+      YMM<float> length_squared = res[0] * res[0];
+      for (unsigned c = 1; c < 4; ++c)
+      {
+        length_squared = res[c].MultiplyAdd(res[c], length_squared);
+      }
+      YMM<float> inv_length = InverseLength(length_squared, true);
+      for (unsigned c = 0; c < 4; ++c)
+      {
+        res[c] *= inv_length;
+      }
+      StoreTransposed(res, out + vec * 4);
+    }
+  }
+
+  static void SOV4FromVOV4(float* streams, unsigned capacity, const float* vov, unsigned n)
+  {
+    const unsigned batches_end = n / 8 * 8;
+    for (unsigned vec = 0; vec < batches_end; vec += 8)
+    {
+      YMM<float> soa[4];
+      LoadTransposed(vov + vec * 4, soa);
+      for (unsigned c = 0; c < 4; ++c)
+      {
+        soa[c].Store(streams + c * capacity + vec);
+      }
+    }
+
+    for (unsigned vec = batches_end; vec < n; ++vec)
+    {
+      for (unsigned c = 0; c < 4; ++c)
+      {
+        streams[c * capacity + vec] = vov[vec * 4 + c];
+      }
+    }
+  }
+
+  static void SOV4ToVOV4(float* vov, const float* streams, unsigned capacity, unsigned n)
+  {
+    const unsigned batches_end = n / 8 * 8;
+    for (unsigned vec = 0; vec < batches_end; vec += 8)
+    {
+      YMM<float> soa[4];
+      for (unsigned c = 0; c < 4; ++c)
+      {
+        soa[c] = YMM<float>(streams + c * capacity + vec);
+      }
+      StoreTransposed(soa, vov + vec * 4);
+    }
+
+    for (unsigned vec = batches_end; vec < n; ++vec)
+    {
+      for (unsigned c = 0; c < 4; ++c)
+      {
+        vov[vec * 4 + c] = streams[c * capacity + vec];
+      }
+    }
+  }
+
+  static void SOV4Multiply(float* out, const float* in, unsigned capacity, const float* m, unsigned from, unsigned to)
+  {
+    for (unsigned vec = from; vec < to; vec += 8)
+    {
+      YMM<float> soa[4];
+      for (unsigned c = 0; c < 4; ++c)
+      {
+        soa[c] = YMM<float>(in + c * capacity + vec);
+      }
+
+      // Everything is loaded before anything is stored, so `out` can be `in`.
+      YMM<float> res[4];
+      MultiplyTransposed(soa, m, res);
+      for (unsigned c = 0; c < 4; ++c)
+      {
+        res[c].Store(out + c * capacity + vec);
+      }
+    }
+  }
+
+  static void SOVHFromVOV4(uint16_t* streams, unsigned capacity, unsigned components, const float* vov, unsigned n)
+  {
+    const unsigned batches_end = n / 8 * 8;
+    for (unsigned vec = 0; vec < batches_end; vec += 8)
+    {
+      YMM<float> soa[4];
+      LoadTransposed(vov + vec * 4, soa);
+      for (unsigned c = 0; c < components; ++c)
+      {
+        soa[c].StoreAsHalves(streams + c * capacity + vec);
+      }
+    }
+
+    for (unsigned vec = batches_end; vec < n; ++vec)
+    {
+      for (unsigned c = 0; c < components; ++c)
+      {
+        streams[c * capacity + vec] = _cvtss_sh(vov[vec * 4 + c], _MM_FROUND_TO_NEAREST_INT);
+      }
+    }
+  }
+
+  // The missing components are 0, the rest are converted from the streams by F16C.
+  static inline void LoadHalvesTransposed(const uint16_t* in, unsigned capacity, unsigned components, unsigned vec, YMM<float> soa[4])
+  {
+    for (unsigned c = 0; c < 4; ++c)
+    {
+      if (c < components)
+      {
+        soa[c] = YMM<float>::LoadHalves(in + c * capacity + vec);
+      }
+      else
+      {
+        soa[c].ZeroOut();
+      }
+    }
+  }
+
+  static void SOVHToVOV4(float* vov, const uint16_t* streams, unsigned capacity, unsigned components, unsigned n)
+  {
+    // Both sides are padded to `VOV4::kBatch`, so the last batch can go whole.
+    for (unsigned vec = 0; vec < n; vec += 8)
+    {
+      YMM<float> soa[4];
+      LoadHalvesTransposed(streams, capacity, components, vec, soa);
+      StoreTransposed(soa, vov + vec * 4);
+    }
+  }
+
+  static void SOVHMultiply(float* out, const uint16_t* in, unsigned capacity, unsigned components, const float* m, unsigned from, unsigned to)
+  {
+    for (unsigned vec = from; vec < to; vec += 8)
+    {
+      YMM<float> soa[4], res[4];
+      LoadHalvesTransposed(in, capacity, components, vec, soa);
+      MultiplyTransposed(soa, m, res);
+      StoreTransposed(res, out + vec * 4);
+    }
+  }
+
+  static void Fill32(uint32_t* dst, uint32_t value, unsigned n)
+  {
+    __m256i v = _mm256_set1_epi32(value);
+    unsigned i = 0;
+    for (; i + 8 <= n; i += 8)
+    {
+      _mm256_storeu_si256(reinterpret_cast<__m256i*>(dst + i), v);
+    }
+    for (; i < n; ++i)
+    {
+      dst[i] = value;
+    }
+  }
+
+  static void FillFloat(float* dst, float value, unsigned n)
+  {
+    YMM<float> v = value;
+    unsigned i = 0;
+    for (; i + 8 <= n; i += 8)
+    {
+      v.StoreUnaligned(dst + i);
+    }
+    for (; i < n; ++i)
+    {
+      dst[i] = value;
+    }
+  }
+
+  static void RasterRow(uint32_t* color, float* z, unsigned n, const int f[3], const int step[3], float depth, uint32_t bgrx)
+  {
+    const YMM<int32_t> lanes(0, 1, 2, 3, 4, 5, 6, 7);
+    // The edge functions of the 8 pixels, and how much they move for the next 8.
+    YMM<int32_t> f0 = YMM<int32_t>(f[0]) + lanes * YMM<int32_t>(step[0]);
+    YMM<int32_t> f1 = YMM<int32_t>(f[1]) + lanes * YMM<int32_t>(step[1]);
+    YMM<int32_t> f2 = YMM<int32_t>(f[2]) + lanes * YMM<int32_t>(step[2]);
+    const YMM<int32_t> step0 = step[0] * 8, step1 = step[1] * 8, step2 = step[2] * 8;
+
+    const YMM<int32_t> color_256 = static_cast<int32_t>(bgrx);
+    const YMM<float> depth_256 = depth;
+
+    for (unsigned x = 0; x < n; x += 8)
+    {
+      // Inside if no edge function is negative, so if the sign bit of none of them is set.
+      // Past the end of the row must not even be read, it could be past the end of the buffer.
+      YMM<int32_t> inside = (f0 | f1 | f2).GreaterThan(-1) & YMM<int32_t>(n - x).GreaterThan(lanes);
+
+      if (z != nullptr && !inside.IsZero())
+      {
+        YMM<float> old_z = YMM<float>::LoadMasked(z + x, inside);
+        inside = inside & depth_256.LessOrEqual(old_z).AsIntegers();
+        depth_256.StoreMasked(z + x, inside);
+      }
+      color_256.StoreMasked(reinterpret_cast<int32_t*>(color + x), inside);
+
+      f0 += step0;
+      f1 += step1;
+      f2 += step2;
+    }
+  }
+
+  static void RasterRowTextured(uint32_t* color, float* z, unsigned n, const int f[3], const int step[3], const float linear[4], const float linear_step[4], const uint32_t* texels, unsigned texture_width, unsigned texture_height)
+  {
+    const YMM<int32_t> lanes(0, 1, 2, 3, 4, 5, 6, 7);
+    YMM<int32_t> f0 = YMM<int32_t>(f[0]) + lanes * YMM<int32_t>(step[0]);
+    YMM<int32_t> f1 = YMM<int32_t>(f[1]) + lanes * YMM<int32_t>(step[1]);
+    YMM<int32_t> f2 = YMM<int32_t>(f[2]) + lanes * YMM<int32_t>(step[2]);
+    const YMM<int32_t> step0 = step[0] * 8, step1 = step[1] * 8, step2 = step[2] * 8;
+
+    // z, 1/w, u/w and v/w of the 8 pixels.
+    const YMM<float> lanes_f = lanes.ToFloats();
+    YMM<float> depth = YMM<float>(linear_step[0]).MultiplyAdd(lanes_f, linear[0]);
+    YMM<float> inv_w = YMM<float>(linear_step[1]).MultiplyAdd(lanes_f, linear[1]);
+    YMM<float> u_w = YMM<float>(linear_step[2]).MultiplyAdd(lanes_f, linear[2]);
+    YMM<float> v_w = YMM<float>(linear_step[3]).MultiplyAdd(lanes_f, linear[3]);
+    const YMM<float> depth_step = linear_step[0] * 8, inv_w_step = linear_step[1] * 8, u_w_step = linear_step[2] * 8, v_w_step = linear_step[3] * 8;
+
+    const YMM<float> width_f = static_cast<float>(texture_width), height_f = static_cast<float>(texture_height);
+    const YMM<int32_t> width_i = texture_width, last_x = texture_width - 1, last_y = texture_height - 1;
+    const YMM<int32_t> bgr_mask = 0x00FFFFFF;
+
+    for (unsigned x = 0; x < n; x += 8)
+    {
+      // Like `RasterRow()`, nothing past the end of the row is read.
+      YMM<int32_t> inside = (f0 | f1 | f2).GreaterThan(-1) & YMM<int32_t>(n - x).GreaterThan(lanes);
+
+      if (z != nullptr && !inside.IsZero())
+      {
+        YMM<float> old_z = YMM<float>::LoadMasked(z + x, inside);
+        inside = inside & depth.LessOrEqual(old_z).AsIntegers();
+      }
+
+      if (!inside.IsZero())
+      {
+        YMM<float> w = YMM<float>(1.0f) / inv_w;
+        YMM<float> u = u_w * w, v = v_w * w;
+        // Repeating, only the fraction matters. Pixels outside the triangle can get NaNs and infinities here, those convert to INT_MIN, hence clamping both ends before the gather.
+        YMM<int32_t> tx = ((u - u.Floor()) * width_f).ToIntegers().Max(0).Min(last_x);
+        YMM<int32_t> ty = ((v - v.Floor()) * height_f).ToIntegers().Max(0).Min(last_y);
+        YMM<int32_t> texel = YMM<int32_t>::Gather(reinterpret_cast<const int32_t*>(texels), tx + ty * width_i) & bgr_mask;
+
+        if (z != nullptr)
+        {
+          depth.StoreMasked(z + x, inside);
+        }
+        texel.StoreMasked(reinterpret_cast<int32_t*>(color + x), inside);
+      }
+
+      f0 += step0;
+      f1 += step1;
+      f2 += step2;
+      depth += depth_step;
+      inv_w += inv_w_step;
+      u_w += u_w_step;
+      v_w += v_w_step;
+    }
+  }
+
+  static void BlendRow(uint8_t* dst, const uint8_t* src, unsigned n)
+  {
+    // Broadcasts every pixel's alpha into all 4 of its 16 bit components, 0x80 gives 0.
+    alignas(32) static constexpr uint8_t kAlphaShuffle[32] = {
+      6,0x80,6,0x80,6,0x80,6,0x80, 14,0x80,14,0x80,14,0x80,14,0x80,
+      6,0x80,6,0x80,6,0x80,6,0x80, 14,0x80,14,0x80,14,0x80,14,0x80};
+    const YMM<uint8_t> alpha_shuffle(kAlphaShuffle);
+    const YMM<uint16_t> max = 255;
+
+    unsigned i = 0;
+    for (; i + 8 <= n; i += 8)
+    {
+      YMM<uint8_t> s, d;
+      s.LoadUnaligned(src + i * 4);
+      d.LoadUnaligned(dst + i * 4);
+
+      // 16 bit components, 4 pixels each, the unpacks work per 128 bit lane, but they are undone by the pack the same way.
+      YMM<uint16_t> s_lo = YMM<uint16_t>::UnpackBytesLow(s), s_hi = YMM<uint16_t>::UnpackBytesHigh(s);
+      YMM<uint16_t> d_lo = YMM<uint16_t>::UnpackBytesLow(d), d_hi = YMM<uint16_t>::UnpackBytesHigh(d);
+      YMM<uint16_t> a_lo = s_lo.ShuffleBytes(alpha_shuffle), a_hi = s_hi.ShuffleBytes(alpha_shuffle);
+
+      YMM<uint16_t> r_lo = (s_lo * a_lo + d_lo * (max - a_lo)).Divide255();
+      YMM<uint16_t> r_hi = (s_hi * a_hi + d_hi * (max - a_hi)).Divide255();
+
+      // Keep the X of `dst`, the 4th component of every pixel.
+      r_lo = r_lo.Blend(d_lo, 0b1000'1000);
+      r_hi = r_hi.Blend(d_hi, 0b1000'1000);
+      r_lo.PackUnsigned(r_hi).StoreUnaligned(dst + i * 4);
+    }
+
+    for (; i < n; ++i)
+    {
+      for (unsigned j = 0; j < 3; j++)
+      {
+        dst[i*4 + j] = ((unsigned)src[i*4 + j] * src[i*4 + 3] + (unsigned)dst[i*4 + j] * ((unsigned)255 - src[i*4 + 3])) / 255;
+      }
+    }
+  }
+
+  const Simd::Kernels Simd::kAVX2Kernels = {
+    .multiply = Multiply,
+    .divide_by_w = DivideByW,
+    .add = Add,
+    .add_scaled = AddScaled,
+    // Nothing to gain over a vector per XMM, it's all scattered.
+    .scatter_add_scaled = nullptr,
+    .rotate = Rotate,
+    .project = Project,
+    .normalize = Normalize,
+    .multiply_normals = MultiplyNormals,
+    .dot = Dot,
+    .dot_vector = DotVector,
+    .cross = Cross,
+    .slerp = Slerp,
+    .sov4_from_vov4 = SOV4FromVOV4,
+    .sov4_to_vov4 = SOV4ToVOV4,
+    .sov4_multiply = SOV4Multiply,
+    .sovh_from_vov4 = SOVHFromVOV4,
+    .sovh_to_vov4 = SOVHToVOV4,
+    .sovh_multiply = SOVHMultiply,
+    .sovq_project = SOVQProject,
+    .cull_boxes = CullBoxes,
+    .skin = Skin,
+    .fill32 = Fill32,
+    .fill_float = FillFloat,
+    .raster_row = RasterRow,
+    .raster_row_textured = RasterRowTextured,
+    .blend_row = BlendRow,
+  };
+}
@@ -0,0 +1,334 @@
+// The AVX-512(F, BW, DQ and VL) kernels, this file alone is compiled with them. 16 wide.
+// Only the hot kernels are here, the rest fall back to AVX2.
+#include "Simd.hpp"
+#include "math.hpp"
+#include "ZMM.hpp"
+
+namespace nogl
+{
+  // See `LoadTransposed()`, first pairs of ZMMs(4 vectors each) are split into x/y and z/w halves of 8 vectors, then the halves are joined.
+  static constexpr int32_t kXYIndices[16] = {0,4,8,12, 16,20,24,28, 1,5,9,13, 17,21,25,29};
+  static constexpr int32_t kZWIndices[16] = {2,6,10,14, 18,22,26,30, 3,7,11,15, 19,23,27,31};
+  static constexpr int32_t kLowHalvesIndices[16] = {0,1,2,3,4,5,6,7, 16,17,18,19,20,21,22,23};
+  static constexpr int32_t kHighHalvesIndices[16] = {8,9,10,11,12,13,14,15, 24,25,26,27,28,29,30,31};
+  // See `StoreTransposed()`
+  static constexpr int32_t kInterleaveLowIndices[16] = {0,16,1,17, 2,18,3,19, 4,20,5,21, 6,22,7,23};
+  static constexpr int32_t kInterleaveHighIndices[16] = {8,24,9,25, 10,26,11,27, 12,28,13,29, 14,30,15,31};
+  static constexpr int32_t kPairsLowIndices[16] = {0,1,16,17, 2,3,18,19, 4,5,20,21, 6,7,22,23};
+  static constexpr int32_t kPairsHighIndices[16] = {8,9,24,25, 10,11,26,27, 12,13,28,29, 14,15,30,31};
+
+  // Loads 16 consecutive vectors from `f`(64 floats, aligned to 512 bits) and transposes them, so `soa[c]` holds component `c` of all 16.
+  static inline void LoadTransposed(const float* f, ZMM<float> soa[4])
+  {
+    ZMM<float> r0(f + 0*16), r1(f + 1*16), r2(f + 2*16), r3(f + 3*16);
+
+    // [x0-x7, y0-y7], [z0-z7, w0-w7], same for 8-15
+    ZMM<float> xy0 = r0.PermuteTwo(r1, kXYIndices), zw0 = r0.PermuteTwo(r1, kZWIndices);
+    ZMM<float> xy1 = r2.PermuteTwo(r3, kXYIndices), zw1 = r2.PermuteTwo(r3, kZWIndices);
+
+    soa[0] = xy0.PermuteTwo(xy1, kLowHalvesIndices);
+    soa[1] = xy0.PermuteTwo(xy1, kHighHalvesIndices);
+    soa[2] = zw0.PermuteTwo(zw1, kLowHalvesIndices);
+    soa[3] = zw0.PermuteTwo(zw1, kHighHalvesIndices);
+  }
+
+  // Reverse of `LoadTransposed()`, stores 16 vectors into `f`.
+  static inline void StoreTransposed(const ZMM<float> soa[4], float* f)
+  {
+    // [x0,y0,x1,y1...x7,y7], same for 8-15 and for z/w.
+    ZMM<float> xy0 = soa[0].PermuteTwo(soa[1], kInterleaveLowIndices), xy1 = soa[0].PermuteTwo(soa[1], kInterleaveHighIndices);
+    ZMM<float> zw0 = soa[2].PermuteTwo(soa[3], kInterleaveLowIndices), zw1 = soa[2].PermuteTwo(soa[3], kInterleaveHighIndices);
+
+    xy0.PermuteTwo(zw0, kPairsLowIndices).Store(f + 0*16);
+    xy0.PermuteTwo(zw0, kPairsHighIndices).Store(f + 1*16);
+    xy1.PermuteTwo(zw1, kPairsLowIndices).Store(f + 2*16);
+    xy1.PermuteTwo(zw1, kPairsHighIndices).Store(f + 3*16);
+  }
+
+  static inline void MultiplyTransposed(const ZMM<float> in[4], const float* m, ZMM<float> out[4])
+  {
+    for (unsigned j = 0; j < 4; ++j)
+    {
+      out[j] = in[0] * ZMM<float>(m[0*4 + j]);
+      for (unsigned i = 1; i < 4; ++i)
+      {
+        out[j] = in[i].MultiplyAdd(ZMM<float>(m[i*4 + j]), out[j]);
+      }
+    }
+  }
+
+  static void Multiply(float* out, const float* in, const float* m, unsigned from, unsigned to)
+  {
+    // Transposing both ways is still cheaper than broadcasting every component of every vector.
+    for (unsigned vec = from; vec < to; vec += 16)
+    {
+      ZMM<float> soa[4], res[4];
+      LoadTransposed(in + vec * 4, soa);
+      MultiplyTransposed(soa, m, res);
+      StoreTransposed(res, out + vec * 4);
+    }
+  }
+
+  // The rest of `Project()` once the vectors are in clip space, `clip[c]` is component `c` of 16 vectors. Writes their outcodes, and stores them projected to `out`.
+  static inline void ProjectTransposed(const ZMM<float> clip[4], float width, float height, float* out, uint8_t* outcodes)
+  {
+    const ZMM<float> zero = 0.0f, two = 2.0f, width_512 = width, height_512 = height;
+
+    const ZMM<float>& x = clip[0], & y = clip[1], & z = clip[2], & w = clip[3];
+
+    // See the AVX2 version, here the comparisons give mask registers, which directly pick the bytes.
+    __m128i codes = _mm_maskz_mov_epi8(x.LessThan(zero), _mm_set1_epi8(VOV4::kOutLeft));
+    codes = _mm_or_si128(codes, _mm_maskz_mov_epi8(x.GreaterThan(w * width_512), _mm_set1_epi8(VOV4::kOutRight)));
+    codes = _mm_or_si128(codes, _mm_maskz_mov_epi8(y.LessThan(zero), _mm_set1_epi8(VOV4::kOutTop)));
+    codes = _mm_or_si128(codes, _mm_maskz_mov_epi8(y.GreaterThan(w * height_512), _mm_set1_epi8(VOV4::kOutBottom)));
+    codes = _mm_or_si128(codes, _mm_maskz_mov_epi8(z.LessThan(-w), _mm_set1_epi8(VOV4::kOutNear)));
+    codes = _mm_or_si128(codes, _mm_maskz_mov_epi8(z.GreaterThan(w), _mm_set1_epi8(VOV4::kOutFar)));
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(outcodes), codes);
+
+    // 14 bits, after the Newton-Raphson step ~24.
+    ZMM<float> inv_w = w.Reciprocal();
+    inv_w = inv_w * (two - w * inv_w);
+
+    ZMM<float> projected[4] = {x * inv_w, y * inv_w, z * inv_w, inv_w};
+    StoreTransposed(projected, out);
+  }
+
+  static void Project(float* out, uint8_t* outcodes, const float* in, const float* m, float width, float height, unsigned from, unsigned to)
+  {
+    for (unsigned vec = from; vec < to; vec += 16)
+    {
+      ZMM<float> soa[4];
+      LoadTransposed(in + vec * 4, soa);
+
+      ZMM<float> clip[4];
+      MultiplyTransposed(soa, m, clip);
+      ProjectTransposed(clip, width, height, out + vec * 4, outcodes + vec);
+    }
+  }
+
+  static void SOVQProject(float* out, uint8_t* outcodes, const int16_t* in, unsigned capacity, const float* m, float width, float height, unsigned from, unsigned to)
+  {
+    for (unsigned vec = from; vec < to; vec += 16)
+    {
+      // The integers are converted as they are, the dequantization is in `m`.
+      ZMM<float> soa[4];
+      for (unsigned c = 0; c < 3; ++c)
+      {
+        soa[c] = ZMM<float>::LoadIntegers(in + c * capacity + vec);
+      }
+      soa[3] = 1.0f;
+
+      ZMM<float> clip[4];
+      MultiplyTransposed(soa, m, clip);
+      ProjectTransposed(clip, width, height, out + vec * 4, outcodes + vec);
+    }
+  }
+
+  // See the SSE4.1 version, ~14 bits raw, ~24 `refine`d, and zero gives 0.
+  static inline ZMM<float> InverseLength(const ZMM<float>& x, bool refine)
+  {
+    ZMM<float> y = x.ISquareRoot();
+    if (refine)
+    {
+      y = y * (ZMM<float>(1.5f) - ZMM<float>(0.5f) * x * y * y);
+    }
+    return y.ZeroMasked(x.GreaterThan(ZMM<float>(0.0f)));
+  }
+
+  // Normalizes the x, y and z of `soa`, w is left alone.
+  static inline void NormalizeTransposed(ZMM<float> soa[4], bool refine)
+  {
+    ZMM<float> length_squared = soa[0] * soa[0];
+    length_squared = soa[1].MultiplyAdd(soa[1], length_squared);
+    length_squared = soa[2].MultiplyAdd(soa[2], length_squared);
+
+    ZMM<float> inv_length = InverseLength(length_squared, refine);
+    for (unsigned c = 0; c < 3; ++c)
+    {
+      soa[c] *= inv_length;
+    }
+  }
+
+  static void Normalize(float* out, const float* in, bool refine, unsigned from, unsigned to)
+  {
+    for (unsigned vec = from; vec < to; vec += 16)
+    {
+      ZMM<float> soa[4];
+      LoadTransposed(in + vec * 4, soa);
+      NormalizeTransposed(soa, refine);
+      StoreTransposed(soa, out + vec * 4);
+    }
+  }
+
+  static void MultiplyNormals(float* out, const float* in, const float* m, bool refine, unsigned from, unsigned to)
+  {
+    for (unsigned vec = from; vec < to; vec += 16)
+    {
+      ZMM<float> soa[4], res[4];
+      LoadTransposed(in + vec * 4, soa);
+
+      // Only the upper 3x3, directions are not translated, and w is kept.
+      for (unsigned j = 0; j < 3; ++j)
+      {
+        res[j] = soa[0] * ZMM<float>(m[0*4 + j]);
+        res[j] = soa[1].MultiplyAdd(ZMM<float>(m[1*4 + j]), res[j]);
+        res[j] = soa[2].MultiplyAdd(ZMM<float>(m[2*4 + j]), res[j]);
+      }
+      res[3] = soa[3];
+
+      NormalizeTransposed(res, refine);
+      StoreTransposed(res, out + vec * 4);
+    }
+  }
+
+  static void SOV4Multiply(float* out, const float* in, unsigned capacity, const float* m, unsigned from, unsigned to)
+  {
+    for (unsigned vec = from; vec < to; vec += 16)
+    {
+      ZMM<float> soa[4];
+      for (unsigned c = 0; c < 4; ++c)
+      {
+        soa[c] = ZMM<float>(in + c * capacity + vec);
+      }
+
+      ZMM<float> res[4];
+      MultiplyTransposed(soa, m, res);
+      for (unsigned c = 0; c < 4; ++c)
+      {
+        res[c].Store(out + c * capacity + vec);
+      }
+    }
+  }
+
+  static void SOVHMultiply(float* out, const uint16_t* in, unsigned capacity, unsigned components, const float* m, unsigned from, unsigned to)
+  {
+    for (unsigned vec = from; vec < to; vec += 16)
+    {
+      ZMM<float> soa[4], res[4];
+      for (unsigned c = 0; c < 4; ++c)
+      {
+        if (c < components)
+        {
+          soa[c] = ZMM<float>::LoadHalves(in + c * capacity + vec);
+        }
+        else
+        {
+          soa[c].ZeroOut();
+        }
+      }
+      MultiplyTransposed(soa, m, res);
+      StoreTransposed(res, out + vec * 4);
+    }
+  }
+
+  // The mask of the first `n` of 16 components.
+  static inline __mmask16 FirstN(unsigned n)
+  {
+    return n >= 16 ? 0xFFFF : (1u << n) - 1;
+  }
+
+  static void Fill32(uint32_t* dst, uint32_t value, unsigned n)
+  {
+    __m512i v = _mm512_set1_epi32(value);
+    for (unsigned i = 0; i < n; i += 16)
+    {
+      _mm512_mask_storeu_epi32(dst + i, FirstN(n - i), v);
+    }
+  }
+
+  static void FillFloat(float* dst, float value, unsigned n)
+  {
+    ZMM<float> v = value;
+    for (unsigned i = 0; i < n; i += 16)
+    {
+      v.StoreMasked(dst + i, FirstN(n - i));
+    }
+  }
+
+  static void RasterRow(uint32_t* color, float* z, unsigned n, const int f[3], const int step[3], float depth, uint32_t bgrx)
+  {
+    const __m512i lanes = _mm512_setr_epi32(0,1,2,3,4,5,6,7,8,9,10,11,12,13,14,15);
+    __m512i f0 = _mm512_add_epi32(_mm512_set1_epi32(f[0]), _mm512_mullo_epi32(lanes, _mm512_set1_epi32(step[0])));
+    __m512i f1 = _mm512_add_epi32(_mm512_set1_epi32(f[1]), _mm512_mullo_epi32(lanes, _mm512_set1_epi32(step[1])));
+    __m512i f2 = _mm512_add_epi32(_mm512_set1_epi32(f[2]), _mm512_mullo_epi32(lanes, _mm512_set1_epi32(step[2])));
+    const __m512i step0 = _mm512_set1_epi32(step[0] * 16), step1 = _mm512_set1_epi32(step[1] * 16), step2 = _mm512_set1_epi32(step[2] * 16);
+
+    const __m512i color_512 = _mm512_set1_epi32(bgrx);
+    const __m512 depth_512 = _mm512_set1_ps(depth);
+
+    for (unsigned x = 0; x < n; x += 16)
+    {
+      __mmask16 inside = _mm512_mask_cmpge_epi32_mask(FirstN(n - x), _mm512_or_si512(f0, _mm512_or_si512(f1, f2)), _mm512_setzero_si512());
+
+      if (z != nullptr && inside)
+      {
+        // Masked out components are not even read, no faults past the end.
+        __m512 old_z = _mm512_maskz_loadu_ps(inside, z + x);
+        inside = _mm512_mask_cmp_ps_mask(inside, depth_512, old_z, _CMP_LE_OQ);
+        _mm512_mask_storeu_ps(z + x, inside, depth_512);
+      }
+      _mm512_mask_storeu_epi32(color + x, inside, color_512);
+
+      f0 = _mm512_add_epi32(f0, step0);
+      f1 = _mm512_add_epi32(f1, step1);
+      f2 = _mm512_add_epi32(f2, step2);
+    }
+  }
+
+  static void BlendRow(uint8_t* dst, const uint8_t* src, unsigned n)
+  {
+    // 8 pixels at a time, as 16 bit components in a ZMM.
+    // Broadcasts every pixel's alpha(the 4th component) into all 4 of its components.
+    // `_mm512_set_epi16()` goes from the last component to the first.
+    const __m512i alpha_indices = _mm512_set_epi16(
+      31,31,31,31, 27,27,27,27, 23,23,23,23, 19,19,19,19,
+      15,15,15,15, 11,11,11,11, 7,7,7,7, 3,3,3,3);
+    const __m512i max = _mm512_set1_epi16(255);
+
+    for (unsigned i = 0; i < n; i += 8)
+    {
+      __mmask8 pixels = FirstN(n - i);
+      __m512i s = _mm512_cvtepu8_epi16(_mm256_maskz_loadu_epi32(pixels, src + i * 4));
+      __m512i d = _mm512_cvtepu8_epi16(_mm256_maskz_loadu_epi32(pixels, dst + i * 4));
+      __m512i a = _mm512_permutexvar_epi16(alpha_indices, s);
+
+      __m512i r = _mm512_add_epi16(_mm512_mullo_epi16(s, a), _mm512_mullo_epi16(d, _mm512_sub_epi16(max, a)));
+      // Exact `x / 255`(truncated), like the AVX2 version.
+      r = _mm512_srli_epi16(_mm512_add_epi16(_mm512_add_epi16(r, _mm512_set1_epi16(1)), _mm512_srli_epi16(r, 8)), 8);
+
+      // Store just the BGR bytes of the pixels we have, X is left alone.
+      __mmask32 bytes = _cvtu32_mask32(0x77777777u & ((1ull << ((n - i) >= 8 ? 32 : (n - i) * 4)) - 1));
+      _mm512_mask_cvtepi16_storeu_epi8(dst + i * 4, bytes, r);
+    }
+  }
+
+  const Simd::Kernels Simd::kAVX512Kernels = {
+    .multiply = Multiply,
+    .divide_by_w = nullptr,
+    .add = nullptr,
+    .add_scaled = nullptr,
+    .scatter_add_scaled = nullptr,
+    .rotate = nullptr,
+    .project = Project,
+    .normalize = Normalize,
+    .multiply_normals = MultiplyNormals,
+    .dot = nullptr,
+    .dot_vector = nullptr,
+    .cross = nullptr,
+    .slerp = nullptr,
+    .sov4_from_vov4 = nullptr,
+    .sov4_to_vov4 = nullptr,
+    .sov4_multiply = SOV4Multiply,
+    .sovh_from_vov4 = nullptr,
+    .sovh_to_vov4 = nullptr,
+    .sovh_multiply = SOVHMultiply,
+    .sovq_project = SOVQProject,
+    .cull_boxes = nullptr,
+    .skin = nullptr,
+    .fill32 = Fill32,
+    .fill_float = FillFloat,
+    .raster_row = RasterRow,
+    .raster_row_textured = nullptr,
+    .blend_row = BlendRow,
+  };
+}
@@ -0,0 +1,741 @@
+// The SSE4.1 kernels, the fallback that runs everywhere, compiled with the base flags. 4 wide.
+#include "Simd.hpp"
+#include "math.hpp"
+
+#include <bit>
+#include <cmath>
+
+namespace nogl
+{
+  // Loads 4 consecutive vectors from `f` and transposes them, so `soa[c]` holds component `c` of all 4.
+  static inline void LoadTransposed(const float* f, XMM<float> soa[4])
+  {
+    soa[0] = XMM<float>(f + 0*4);
+    soa[1] = XMM<float>(f + 1*4);
+    soa[2] = XMM<float>(f + 2*4);
+    soa[3] = XMM<float>(f + 3*4);
+    XMM<float>::Transpose(soa[0], soa[1], soa[2], soa[3]);
+  }
+
+  // Reverse of `LoadTransposed()`, stores 4 vectors into `f`.
+  static inline void StoreTransposed(XMM<float> soa[4], float* f)
+  {
+    XMM<float>::Transpose(soa[0], soa[1], soa[2], soa[3]);
+    for (unsigned i = 0; i < 4; ++i)
+    {
+      soa[i].Store(f + i*4);
+    }
+  }
+
+  static inline void MultiplyTransposed(const XMM<float> in[4], const float* m, XMM<float> out[4])
+  {
+    for (unsigned j = 0; j < 4; ++j)
+    {
+      out[j] = in[0] * XMM<float>(m[0*4 + j]);
+      for (unsigned i = 1; i < 4; ++i)
+      {
+        out[j] += in[i] * XMM<float>(m[i*4 + j]);
+      }
+    }
+  }
+
+  static void Multiply(float* out, const float* in, const float* m, unsigned from, unsigned to)
+  {
+    for (unsigned vec = from; vec < to; ++vec)
+    {
+      const float* in_ptr = in + vec * 4;
+
+      // Same as `V4::operator *=(const M4x4&)`
+      XMM<float> res = XMM<float>(in_ptr[0]) * XMM<float>(m);
+      for (unsigned i = 1; i < 4; ++i)
+      {
+        res += XMM<float>(in_ptr[i]) * XMM<float>(m + i * 4);
+      }
+      res.Store(out + vec * 4);
+    }
+  }
+
+  static void DivideByW(float* out, const float* in, unsigned from, unsigned to)
+  {
+    for (unsigned vec = from; vec < to; ++vec)
+    {
+      (XMM<float>(in + vec * 4) / XMM<float>(in[vec * 4 + 3])).Store(out + vec * 4);
+    }
+  }
+
+  static void Add(float* out, const float* in, const float* v, unsigned from, unsigned to)
+  {
+    XMM<float> v128(v);
+    for (unsigned vec = from; vec < to; ++vec)
+    {
+      (XMM<float>(in + vec * 4) + v128).Store(out + vec * 4);
+    }
+  }
+
+  static void AddScaled(float* out, const float* in, const float* v, float s, unsigned from, unsigned to)
+  {
+    XMM<float> s128(s);
+    for (unsigned vec = from; vec < to; ++vec)
+    {
+      (XMM<float>(in + vec * 4) + XMM<float>(v + vec * 4) * s128).Store(out + vec * 4);
+    }
+  }
+
+  static void ScatterAddScaled(float* out, const unsigned* indices, const float* v, float s, unsigned from, unsigned to)
+  {
+    XMM<float> s128(s);
+    for (unsigned i = from; i < to; ++i)
+    {
+      float* o = out + indices[i] * 4;
+      (XMM<float>(o) + XMM<float>(v + i * 4) * s128).Store(o);
+    }
+  }
+
+  static void Rotate(float* out, const float* in, const float* q, unsigned from, unsigned to)
+  {
+    XMM<float> q128(q);
+    for (unsigned vec = from; vec < to; ++vec)
+    {
+      XMM<float>(in + vec * 4).QVSandwich(q128).Store(out + vec * 4);
+    }
+  }
+
+  // The rest of `Project()` once the vectors are in clip space, `clip[c]` is component `c` of 4 vectors. Writes their outcodes, and stores them projected to `out`.
+  static inline void ProjectTransposed(const XMM<float> clip[4], float width, float height, float* out, uint8_t* outcodes)
+  {
+    const XMM<float> zero = 0.0f, two = 2.0f, width_128 = width, height_128 = height;
+
+    const XMM<float>& x = clip[0], & y = clip[1], & z = clip[2], & w = clip[3];
+
+    // See the AVX2 version.
+    XMM<float> codes =
+      (x.LessThan(zero) & XMM<float>(static_cast<float>(VOV4::kOutLeft))) +
+      (x.GreaterThan(w * width_128) & XMM<float>(static_cast<float>(VOV4::kOutRight))) +
+      (y.LessThan(zero) & XMM<float>(static_cast<float>(VOV4::kOutTop))) +
+      (y.GreaterThan(w * height_128) & XMM<float>(static_cast<float>(VOV4::kOutBottom))) +
+      (z.LessThan(-w) & XMM<float>(static_cast<float>(VOV4::kOutNear))) +
+      (z.GreaterThan(w) & XMM<float>(static_cast<float>(VOV4::kOutFar)));
+    codes.StoreAsBytes(outcodes);
+
+    XMM<float> inv_w = w.Reciprocal();
+    inv_w = inv_w * (two - w * inv_w);
+
+    XMM<float> projected[4] = {x * inv_w, y * inv_w, z * inv_w, inv_w};
+    StoreTransposed(projected, out);
+  }
+
+  static void Project(float* out, uint8_t* outcodes, const float* in, const float* m, float width, float height, unsigned from, unsigned to)
+  {
+    for (unsigned vec = from; vec < to; vec += 4)
+    {
+      XMM<float> soa[4];
+      LoadTransposed(in + vec * 4, soa);
+
+      XMM<float> clip[4];
+      MultiplyTransposed(soa, m, clip);
+      ProjectTransposed(clip, width, height, out + vec * 4, outcodes + vec);
+    }
+  }
+
+  static void SOVQProject(float* out, uint8_t* outcodes, const int16_t* in, unsigned capacity, const float* m, float width, float height, unsigned from, unsigned to)
+  {
+    for (unsigned vec = from; vec < to; vec += 4)
+    {
+      // The integers are converted as they are, the dequantization is in `m`.
+      XMM<float> soa[4];
+      for (unsigned c = 0; c < 3; ++c)
+      {
+        soa[c] = XMM<int32_t>::LoadWidened(in + c * capacity + vec).ToFloats();
+      }
+      soa[3] = 1.0f;
+
+      XMM<float> clip[4];
+      MultiplyTransposed(soa, m, clip);
+      ProjectTransposed(clip, width, height, out + vec * 4, outcodes + vec);
+    }
+  }
+
+  static void CullBoxes(uint8_t* visible, const float* centers, const float* extents, unsigned capacity, const float* planes, unsigned n)
+  {
+    const XMM<float> zero = 0.0f, one = 1.0f;
+
+    for (unsigned box = 0; box < n; box += 4)
+    {
+      XMM<float> c[3], e[3];
+      for (unsigned i = 0; i < 3; ++i)
+      {
+        c[i] = XMM<float>(centers + i * capacity + box);
+        e[i] = XMM<float>(extents + i * capacity + box);
+      }
+
+      // Signed distance of the center plus how far the box reaches along the normal, negative for any plane means it's all outside.
+      // The smallest over all planes is all that matters.
+      XMM<float> nearest;
+      for (unsigned p = 0; p < 6; ++p)
+      {
+        const float* plane = planes + p * 4;
+        XMM<float> distance = c[0] * XMM<float>(plane[0]) + c[1] * XMM<float>(plane[1]) + c[2] * XMM<float>(plane[2]) + XMM<float>(plane[3]);
+        XMM<float> reach = e[0] * XMM<float>(std::abs(plane[0])) + e[1] * XMM<float>(std::abs(plane[1])) + e[2] * XMM<float>(std::abs(plane[2]));
+        nearest = p == 0 ? distance + reach : nearest.Min(distance + reach);
+      }
+      (zero.LessOrEqual(nearest) & one).StoreAsBytes(visible + box);
+    }
+  }
+
+  // 1/sqrt(`x`), `refine`d by a Newton-Raphson step(y * (1.5 - 0.5 * x * y * y)) from ~12 bits to ~22.
+  // Zero gives 0 instead of infinity, so zero vectors stay zero vectors instead of becoming NaNs.
+  static inline XMM<float> InverseLength(const XMM<float>& x, bool refine)
+  {
+    XMM<float> y = x.ISquareRoot();
+    if (refine)
+    {
+      y = y * (XMM<float>(1.5f) - XMM<float>(0.5f) * x * y * y);
+    }
+    return y & x.GreaterThan(XMM<float>(0.0f));
+  }
+
+  // Normalizes the x, y and z of `soa`, w is left alone.
+  static inline void NormalizeTransposed(XMM<float> soa[4], bool refine)
+  {
+    XMM<float> inv_length = InverseLength(soa[0] * soa[0] + soa[1] * soa[1] + soa[2] * soa[2], refine);
+    for (unsigned c = 0; c < 3; ++c)
+    {
+      soa[c] *= inv_length;
+    }
+  }
+
+  static void Normalize(float* out, const float* in, bool refine, unsigned from, unsigned to)
+  {
+    for (unsigned vec = from; vec < to; vec += 4)
+    {
+      XMM<float> soa[4];
+      LoadTransposed(in + vec * 4, soa);
+      NormalizeTransposed(soa, refine);
+      StoreTransposed(soa, out + vec * 4);
+    }
+  }
+
+  static void MultiplyNormals(float* out, const float* in, const float* m, bool refine, unsigned from, unsigned to)
+  {
+    for (unsigned vec = from; vec < to; vec += 4)
+    {
+      XMM<float> soa[4], res[4];
+      LoadTransposed(in + vec * 4, soa);
+
+      // Only the upper 3x3, directions are not translated, and w is kept.
+      for (unsigned j = 0; j < 3; ++j)
+      {
+        res[j] = soa[0] * XMM<float>(m[0*4 + j]) + soa[1] * XMM<float>(m[1*4 + j]) + soa[2] * XMM<float>(m[2*4 + j]);
+      }
+      res[3] = soa[3];
+
+      NormalizeTransposed(res, refine);
+      StoreTransposed(res, out + vec * 4);
+    }
+  }
+
+  // No gathers here, so a vertex at a time, its 4 joint matrices blended column by column and then applied like any other matrix.
+  static void Skin(float* out_positions, float* out_normals, const float* positions, const float* normals, const uint16_t* joints, const float* weights, unsigned capacity, const float* matrices, unsigned from, unsigned to)
+  {
+    for (unsigned vec = from; vec < to; ++vec)
+    {
+      XMM<float> m[4];
+      for (unsigned k = 0; k < 4; ++k)
+      {
+        const float* joint = matrices + joints[k * capacity + vec] * 16;
+        XMM<float> weight(weights[k * capacity + vec]);
+        for (unsigned i = 0; i < 4; ++i)
+        {
+          m[i] = k == 0 ? XMM<float>(joint + i * 4) * weight : m[i] + XMM<float>(joint + i * 4) * weight;
+        }
+      }
+
+      const float* p = positions + vec * 4;
+      XMM<float> res = m[3] + XMM<float>(p[0]) * m[0] + XMM<float>(p[1]) * m[1] + XMM<float>(p[2]) * m[2];
+      res.Store(out_positions + vec * 4);
+      // The weights may not add up to exactly 1.
+      out_positions[vec * 4 + 3] = 1.0f;
+
+      if (normals != nullptr)
+      {
+        const float* n = normals + vec * 4;
+        res = XMM<float>(n[0]) * m[0] + XMM<float>(n[1]) * m[1] + XMM<float>(n[2]) * m[2];
+        res *= InverseLength(XMM<float>(res.DotProduct(res, 0b0111).x()), true);
+        res.Store(out_normals + vec * 4);
+        out_normals[vec * 4 + 3] = n[3];
+      }
+    }
+  }
+
+  static void Dot(float* out, const float* a, const float* b, unsigned from, unsigned to)
+  {
+    for (unsigned vec = from; vec < to; vec += 4)
+    {
+      XMM<float> sa[4], sb[4];
+      LoadTransposed(a + vec * 4, sa);
+      LoadTransposed(b + vec * 4, sb);
+      (sa[0] * sb[0] + sa[1] * sb[1] + sa[2] * sb[2]).StoreUnaligned(out + vec);
+    }
+  }
+
+  static void DotVector(float* out, const float* a, const float* v, unsigned from, unsigned to)
+  {
+    const XMM<float> vx = v[0], vy = v[1], vz = v[2];
+    for (unsigned vec = from; vec < to; vec += 4)
+    {
+      XMM<float> sa[4];
+      LoadTransposed(a + vec * 4, sa);
+      (sa[0] * vx + sa[1] * vy + sa[2] * vz).StoreUnaligned(out + vec);
+    }
+  }
+
+  static void Cross(float* out, const float* a, const float* b, unsigned from, unsigned to)
+  {
+    for (unsigned vec = from; vec < to; vec += 4)
+    {
+      XMM<float> sa[4], sb[4];
+      LoadTransposed(a + vec * 4, sa);
+      LoadTransposed(b + vec * 4, sb);
+
+      XMM<float> res[4] = {
+        sa[1] * sb[2] - sa[2] * sb[1],
+        sa[2] * sb[0] - sa[0] * sb[2],
+        sa[0] * sb[1] - sa[1] * sb[0],
+        0.0f,
+      };
+      StoreTransposed(res, out + vec * 4);
+    }
+  }
+
+  // nlerp, with `t` bent so the rotation goes at the even speed of a real slerp, no trigonometry needed.
+  // The correction is a polynomial fit in `t` and the cosine of the angle `d`(from Kapoulkine's "Approximating slerp").
+  static inline XMM<float> CorrectSlerpT(const XMM<float>& t, const XMM<float>& d)
+  {
+    XMM<float> a = XMM<float>(1.0904f) + d * (XMM<float>(-3.2452f) + d * (XMM<float>(3.55645f) - d * XMM<float>(1.43519f)));
+    XMM<float> b = XMM<float>(0.848013f) + d * (XMM<float>(-1.06021f) + d * XMM<float>(0.215638f));
+    XMM<float> centered = t - XMM<float>(0.5f);
+    XMM<float> k = a * centered * centered + b;
+    return t + t * centered * (t - XMM<float>(1.0f)) * k;
+  }
+
+  static void Slerp(float* out, const float* a, const float* b, const float* t, unsigned from, unsigned to)
+  {
+    for (unsigned vec = from; vec < to; vec += 4)
+    {
+      XMM<float> sa[4], sb[4];
+      LoadTransposed(a + vec * 4, sa);
+      LoadTransposed(b + vec * 4, sb);
+
+      // `q` and `-q` are the same rotation, the one closer to `a` is the shorter arc.
+      XMM<float> dot = sa[0] * sb[0] + sa[1] * sb[1] + sa[2] * sb[2] + sa[3] * sb[3];
+      XMM<float> sign = (dot.LessThan(XMM<float>(0.0f)) & XMM<float>(-2.0f)) + XMM<float>(1.0f);
+      XMM<float> t_b = CorrectSlerpT(XMM<float>(t + vec), dot * sign);
+      XMM<float> t_a = XMM<float>(1.0f) - t_b;
+      t_b *= sign;
+
+      XMM<float> res[4];
+      for (unsigned c = 0; c < 4; ++c)
+      {
+        res[c] = sa[c] * t_a + sb[c] * t_b;
+      }
+      XMM<float> inv_length = InverseLength(res[0] * res[0] + res[1] * res[1] + res[2] * res[2] + res[3] * res[3], true);
+      for (unsigned c = 0; c < 4; ++c)
+      {
+        res[c] *= inv_length;
+      }
+      StoreTransposed(res, out + vec * 4);
+    }
+  }
+
+  static void SOV4FromVOV4(float* streams, unsigned capacity, const float* vov, unsigned n)
+  {
+    const unsigned batches_end = n / 4 * 4;
+    for (unsigned vec = 0; vec < batches_end; vec += 4)
+    {
+      XMM<float> soa[4];
+      LoadTransposed(vov + vec * 4, soa);
+      for (unsigned c = 0; c < 4; ++c)
+      {
+        soa[c].Store(streams + c * capacity + vec);
+      }
+    }
+
+    for (unsigned vec = batches_end; vec < n; ++vec)
+    {
+      for (unsigned c = 0; c < 4; ++c)
+      {
+        streams[c * capacity + vec] = vov[vec * 4 + c];
+      }
+    }
+  }
+
+  static void SOV4ToVOV4(float* vov, const float* streams, unsigned capacity, unsigned n)
+  {
+    const unsigned batches_end = n / 4 * 4;
+    for (unsigned vec = 0; vec < batches_end; vec += 4)
+    {
+      XMM<float> soa[4];
+      for (unsigned c = 0; c < 4; ++c)
+      {
+        soa[c] = XMM<float>(streams + c * capacity + vec);
+      }
+      StoreTransposed(soa, vov + vec * 4);
+    }
+
+    for (unsigned vec = batches_end; vec < n; ++vec)
+    {
+      for (unsigned c = 0; c < 4; ++c)
+      {
+        vov[vec * 4 + c] = streams[c * capacity + vec];
+      }
+    }
+  }
+
+  static void SOV4Multiply(float* out, const float* in, unsigned capacity, const float* m, unsigned from, unsigned to)
+  {
+    for (unsigned vec = from; vec < to; vec += 4)
+    {
+      XMM<float> soa[4];
+      for (unsigned c = 0; c < 4; ++c)
+      {
+        soa[c] = XMM<float>(in + c * capacity + vec);
+      }
+
+      XMM<float> res[4];
+      MultiplyTransposed(soa, m, res);
+      for (unsigned c = 0; c < 4; ++c)
+      {
+        res[c].Store(out + c * capacity + vec);
+      }
+    }
+  }
+
+  // Rounds `f` to the nearest half precision float(ties to even). No F16C here, so it's bit fiddling, only done when loading so scalar is fine.
+  static inline uint16_t FloatToHalf(float f)
+  {
+    uint32_t bits = std::bit_cast<uint32_t>(f);
+    const uint16_t sign = (bits >> 16) & 0x8000;
+    bits &= 0x7FFFFFFF;
+
+    // Too big for a half(65520 and up round to infinity), infinities and NaNs.
+    if (bits >= (127 + 16) << 23)
+    {
+      return sign | (bits > 0x7F800000 ? 0x7E00 : 0x7C00);
+    }
+    // Below 2^-14 it's a denormal half, adding 0.5 makes the float unit do the shifting and the rounding.
+    if (bits < (127 - 14) << 23)
+    {
+      return sign | (std::bit_cast<uint32_t>(std::bit_cast<float>(bits) + 0.5f) - std::bit_cast<uint32_t>(0.5f));
+    }
+    // Rebias the exponent and round the 13 dropped mantissa bits, the odd bit breaks ties to even.
+    bits += ((15 - 127) << 23) + 0xFFF + ((bits >> 13) & 1);
+    return sign | (bits >> 13);
+  }
+
+  // Converts 4 half precision floats from `h`, the reverse of `FloatToHalf()` but 4 at a time.
+  static inline XMM<float> LoadHalves(const uint16_t* h)
+  {
+    const XMM<int32_t> half = XMM<int32_t>::LoadWidened(h);
+    const XMM<int32_t> exponent_mask = 0x7C00 << 13;
+
+    // Exponent and mantissa in the float's place, and the exponent rebiased.
+    XMM<int32_t> bits = (half & XMM<int32_t>(0x7FFF)) << 13;
+    XMM<int32_t> exponent = bits & exponent_mask;
+    bits += XMM<int32_t>((127 - 15) << 23);
+    // Infinities and NaNs need the exponent all the way up.
+    bits += exponent.Equal(exponent_mask) & XMM<int32_t>((128 - 16) << 23);
+    // Zeros and denormals, bump the exponent to 2^-14's and take 2^-14 away as a float, that normalizes them.
+    XMM<int32_t> denormals = ((bits + XMM<int32_t>(1 << 23)).AsFloats() - XMM<float>(std::bit_cast<float>((127 - 14) << 23))).AsIntegers();
+    bits = bits.BlendMasked(denormals, exponent.Equal(XMM<int32_t>(0)));
+
+    return (bits | ((half & XMM<int32_t>(0x8000)) << 16)).AsFloats();
+  }
+
+  static void SOVHFromVOV4(uint16_t* streams, unsigned capacity, unsigned components, const float* vov, unsigned n)
+  {
+    for (unsigned vec = 0; vec < n; ++vec)
+    {
+      for (unsigned c = 0; c < components; ++c)
+      {
+        streams[c * capacity + vec] = FloatToHalf(vov[vec * 4 + c]);
+      }
+    }
+  }
+
+  // The missing components of `in` are 0, the rest are converted from the streams.
+  static inline void LoadHalvesTransposed(const uint16_t* in, unsigned capacity, unsigned components, unsigned vec, XMM<float> soa[4])
+  {
+    for (unsigned c = 0; c < 4; ++c)
+    {
+      if (c < components)
+      {
+        soa[c] = LoadHalves(in + c * capacity + vec);
+      }
+      else
+      {
+        soa[c].ZeroOut();
+      }
+    }
+  }
+
+  static void SOVHToVOV4(float* vov, const uint16_t* streams, unsigned capacity, unsigned components, unsigned n)
+  {
+    // Both sides are padded to `VOV4::kBatch`, so the last batch can go whole.
+    for (unsigned vec = 0; vec < n; vec += 4)
+    {
+      XMM<float> soa[4];
+      LoadHalvesTransposed(streams, capacity, components, vec, soa);
+      StoreTransposed(soa, vov + vec * 4);
+    }
+  }
+
+  static void SOVHMultiply(float* out, const uint16_t* in, unsigned capacity, unsigned components, const float* m, unsigned from, unsigned to)
+  {
+    for (unsigned vec = from; vec < to; vec += 4)
+    {
+      XMM<float> soa[4], res[4];
+      LoadHalvesTransposed(in, capacity, components, vec, soa);
+      MultiplyTransposed(soa, m, res);
+      StoreTransposed(res, out + vec * 4);
+    }
+  }
+
+  static void Fill32(uint32_t* dst, uint32_t value, unsigned n)
+  {
+    __m128i v = _mm_set1_epi32(value);
+    unsigned i = 0;
+    for (; i + 4 <= n; i += 4)
+    {
+      _mm_storeu_si128(reinterpret_cast<__m128i*>(dst + i), v);
+    }
+    for (; i < n; ++i)
+    {
+      dst[i] = value;
+    }
+  }
+
+  static void FillFloat(float* dst, float value, unsigned n)
+  {
+    XMM<float> v = value;
+    unsigned i = 0;
+    for (; i + 4 <= n; i += 4)
+    {
+      v.StoreUnaligned(dst + i);
+    }
+    for (; i < n; ++i)
+    {
+      dst[i] = value;
+    }
+  }
+
+  static void RasterRow(uint32_t* color, float* z, unsigned n, const int f[3], const int step[3], float depth, uint32_t bgrx)
+  {
+    const XMM<int32_t> lanes(0, 1, 2, 3);
+    XMM<int32_t> f0 = XMM<int32_t>(f[0]) + lanes * XMM<int32_t>(step[0]);
+    XMM<int32_t> f1 = XMM<int32_t>(f[1]) + lanes * XMM<int32_t>(step[1]);
+    XMM<int32_t> f2 = XMM<int32_t>(f[2]) + lanes * XMM<int32_t>(step[2]);
+    const XMM<int32_t> step0 = step[0] * 4, step1 = step[1] * 4, step2 = step[2] * 4;
+
+    const XMM<int32_t> color_128 = static_cast<int32_t>(bgrx);
+    const XMM<float> depth_128 = depth;
+
+    // No masked stores here, so whole groups of 4 are blended with what's there, and the rest is done one by one.
+    unsigned x = 0;
+    for (; x + 4 <= n; x += 4)
+    {
+      // Inside if no edge function is negative, so if the sign bit of none of them is set.
+      XMM<int32_t> inside = (f0 | f1 | f2).GreaterThan(-1);
+
+      if (!inside.IsZero())
+      {
+        if (z != nullptr)
+        {
+          XMM<float> old_z;
+          old_z.LoadUnaligned(z + x);
+          inside = inside & depth_128.LessOrEqual(old_z).AsIntegers();
+          old_z.AsIntegers().BlendMasked(depth_128.AsIntegers(), inside).AsFloats().StoreUnaligned(z + x);
+        }
+        int32_t* ptr = reinterpret_cast<int32_t*>(color + x);
+        XMM<int32_t> old_color;
+        old_color.LoadUnaligned(ptr);
+        old_color.BlendMasked(color_128, inside).StoreUnaligned(ptr);
+      }
+
+      f0 += step0;
+      f1 += step1;
+      f2 += step2;
+    }
+
+    int fx0 = f0.x(), fx1 = f1.x(), fx2 = f2.x();
+    for (; x < n; ++x, fx0 += step[0], fx1 += step[1], fx2 += step[2])
+    {
+      if ((fx0 >= 0 && fx1 >= 0 && fx2 >= 0) && (z == nullptr || depth <= z[x]))
+      {
+        color[x] = bgrx;
+        if (z != nullptr)
+        {
+          z[x] = depth;
+        }
+      }
+    }
+  }
+
+  static void RasterRowTextured(uint32_t* color, float* z, unsigned n, const int f[3], const int step[3], const float linear[4], const float linear_step[4], const uint32_t* texels, unsigned texture_width, unsigned texture_height)
+  {
+    const XMM<int32_t> lanes(0, 1, 2, 3);
+    XMM<int32_t> f0 = XMM<int32_t>(f[0]) + lanes * XMM<int32_t>(step[0]);
+    XMM<int32_t> f1 = XMM<int32_t>(f[1]) + lanes * XMM<int32_t>(step[1]);
+    XMM<int32_t> f2 = XMM<int32_t>(f[2]) + lanes * XMM<int32_t>(step[2]);
+    const XMM<int32_t> step0 = step[0] * 4, step1 = step[1] * 4, step2 = step[2] * 4;
+
+    // z, 1/w, u/w and v/w of the 4 pixels.
+    const XMM<float> lanes_f = lanes.ToFloats();
+    XMM<float> depth = XMM<float>(linear[0]) + lanes_f * XMM<float>(linear_step[0]);
+    XMM<float> inv_w = XMM<float>(linear[1]) + lanes_f * XMM<float>(linear_step[1]);
+    XMM<float> u_w = XMM<float>(linear[2]) + lanes_f * XMM<float>(linear_step[2]);
+    XMM<float> v_w = XMM<float>(linear[3]) + lanes_f * XMM<float>(linear_step[3]);
+    const XMM<float> depth_step = linear_step[0] * 4, inv_w_step = linear_step[1] * 4, u_w_step = linear_step[2] * 4, v_w_step = linear_step[3] * 4;
+
+    const XMM<float> width_f = static_cast<float>(texture_width), height_f = static_cast<float>(texture_height);
+    const XMM<int32_t> width_i = texture_width, last_x = texture_width - 1, last_y = texture_height - 1;
+    const XMM<int32_t> bgr_mask = 0x00FFFFFF;
+
+    // 4 pixels at `c` and `zp`(may be `nullptr`), only the `inside` ones are drawn.
+    auto shade = [&](uint32_t* c, float* zp, XMM<int32_t> inside)
+    {
+      XMM<float> old_z = 0.0f;
+      if (zp != nullptr)
+      {
+        old_z.LoadUnaligned(zp);
+        inside = inside & depth.LessOrEqual(old_z).AsIntegers();
+      }
+      if (inside.IsZero())
+      {
+        return;
+      }
+
+      XMM<float> w = XMM<float>(1.0f) / inv_w;
+      XMM<float> u = u_w * w, v = v_w * w;
+      // Repeating, only the fraction matters. Pixels outside the triangle can get NaNs and infinities here, those convert to INT_MIN, hence clamping both ends before the gather.
+      XMM<int32_t> tx = ((u - u.Floor()) * width_f).ToIntegers().Max(0).Min(last_x);
+      XMM<int32_t> ty = ((v - v.Floor()) * height_f).ToIntegers().Max(0).Min(last_y);
+      XMM<int32_t> texel = XMM<int32_t>::Gather(reinterpret_cast<const int32_t*>(texels), tx + ty * width_i) & bgr_mask;
+
+      if (zp != nullptr)
+      {
+        old_z.AsIntegers().BlendMasked(depth.AsIntegers(), inside).AsFloats().StoreUnaligned(zp);
+      }
+      int32_t* ptr = reinterpret_cast<int32_t*>(c);
+      XMM<int32_t> old_color;
+      old_color.LoadUnaligned(ptr);
+      old_color.BlendMasked(texel, inside).StoreUnaligned(ptr);
+    };
+
+    for (unsigned x = 0; x < n; x += 4)
+    {
+      // Inside if no edge function is negative, so if the sign bit of none of them is set.
+      XMM<int32_t> inside = (f0 | f1 | f2).GreaterThan(-1);
+
+      if (x + 4 <= n)
+      {
+        shade(color + x, z == nullptr ? nullptr : z + x, inside);
+      }
+      else
+      {
+        // The last few go through a copy, nothing past `n` is touched, and the lanes past it are not inside.
+        unsigned tail = n - x;
+        uint32_t color_tail[4] = {};
+        float z_tail[4] = {};
+        memcpy(color_tail, color + x, tail * sizeof (uint32_t));
+        if (z != nullptr)
+        {
+          memcpy(z_tail, z + x, tail * sizeof (float));
+        }
+        shade(color_tail, z == nullptr ? nullptr : z_tail, inside & XMM<int32_t>(tail).GreaterThan(lanes));
+        memcpy(color + x, color_tail, tail * sizeof (uint32_t));
+        if (z != nullptr)
+        {
+          memcpy(z + x, z_tail, tail * sizeof (float));
+        }
+      }
+
+      f0 += step0;
+      f1 += step1;
+      f2 += step2;
+      depth += depth_step;
+      inv_w += inv_w_step;
+      u_w += u_w_step;
+      v_w += v_w_step;
+    }
+  }
+
+  // Exact `x / 255`(truncated) for 16 bit `x` up to 255*255, without a division.
+  static inline __m128i Divide255(__m128i x)
+  {
+    return _mm_srli_epi16(_mm_add_epi16(_mm_add_epi16(x, _mm_set1_epi16(1)), _mm_srli_epi16(x, 8)), 8);
+  }
+
+  static void BlendRow(uint8_t* dst, const uint8_t* src, unsigned n)
+  {
+    // Broadcasts every pixel's alpha into all 4 of its 16 bit components.
+    const __m128i alpha_shuffle = _mm_setr_epi8(6,-1,6,-1,6,-1,6,-1, 14,-1,14,-1,14,-1,14,-1);
+    const __m128i x_mask = _mm_set1_epi32(0xFF000000);
+    const __m128i max = _mm_set1_epi16(255);
+
+    unsigned i = 0;
+    for (; i + 4 <= n; i += 4)
+    {
+      __m128i s = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + i * 4));
+      __m128i d = _mm_loadu_si128(reinterpret_cast<const __m128i*>(dst + i * 4));
+
+      __m128i zero = _mm_setzero_si128();
+      __m128i s_lo = _mm_unpacklo_epi8(s, zero), s_hi = _mm_unpackhi_epi8(s, zero);
+      __m128i d_lo = _mm_unpacklo_epi8(d, zero), d_hi = _mm_unpackhi_epi8(d, zero);
+      __m128i a_lo = _mm_shuffle_epi8(s_lo, alpha_shuffle), a_hi = _mm_shuffle_epi8(s_hi, alpha_shuffle);
+
+      __m128i r_lo = Divide255(_mm_add_epi16(_mm_mullo_epi16(s_lo, a_lo), _mm_mullo_epi16(d_lo, _mm_sub_epi16(max, a_lo))));
+      __m128i r_hi = Divide255(_mm_add_epi16(_mm_mullo_epi16(s_hi, a_hi), _mm_mullo_epi16(d_hi, _mm_sub_epi16(max, a_hi))));
+
+      __m128i r = _mm_blendv_epi8(_mm_packus_epi16(r_lo, r_hi), d, x_mask);
+      _mm_storeu_si128(reinterpret_cast<__m128i*>(dst + i * 4), r);
+    }
+
+    for (; i < n; ++i)
+    {
+      for (unsigned j = 0; j < 3; j++)
+      {
+        dst[i*4 + j] = ((unsigned)src[i*4 + j] * src[i*4 + 3] + (unsigned)dst[i*4 + j] * ((unsigned)255 - src[i*4 + 3])) / 255;
+      }
+    }
+  }
+
+  const Simd::Kernels Simd::kSSE4Kernels = {
+    .multiply = Multiply,
+    .divide_by_w = DivideByW,
+    .add = Add,
+    .add_scaled = AddScaled,
+    .scatter_add_scaled = ScatterAddScaled,
+    .rotate = Rotate,
+    .project = Project,
+    .normalize = Normalize,
+    .multiply_normals = MultiplyNormals,
+    .dot = Dot,
+    .dot_vector = DotVector,
+    .cross = Cross,
+    .slerp = Slerp,
+    .sov4_from_vov4 = SOV4FromVOV4,
+    .sov4_to_vov4 = SOV4ToVOV4,
+    .sov4_multiply = SOV4Multiply,
+    .sovh_from_vov4 = SOVHFromVOV4,
+    .sovh_to_vov4 = SOVHToVOV4,
+    .sovh_multiply = SOVHMultiply,
+    .sovq_project = SOVQProject,
+    .cull_boxes = CullBoxes,
+    .skin = Skin,
+    .fill32 = Fill32,
+    .fill_float = FillFloat,
+    .raster_row = RasterRow,
+    .raster_row_textured = RasterRowTextured,
+    .blend_row = BlendRow,
+  };
+}
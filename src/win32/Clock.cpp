@@ -13,4 +13,22 @@ namespace nogl
     return (t.QuadPart * 1000) / freq.QuadPart;
     // return GetTickCount64();
   }
+
+  unsigned long long Clock::global_now_ns()
+  {
+    // The frequency is fixed at boot, no need to query it every time.
+    static const long long freq = [] {
+      LARGE_INTEGER f;
+      QueryPerformanceFrequency(&f);
+      return f.QuadPart;
+    }();
+
+    LARGE_INTEGER t;
+    QueryPerformanceCounter(&t);
+
+    // Split to avoid overflowing when multiplying by a billion.
+    unsigned long long seconds = t.QuadPart / freq;
+    unsigned long long remainder = t.QuadPart % freq;
+    return seconds * 1'000'000'000 + (remainder * 1'000'000'000) / freq;
+  }
 }
@@ -19,8 +19,11 @@ namespace nogl
   constexpr wchar_t kClassName[] = L"NOGL CLASS";
   constexpr DWORD kStyle = WS_OVERLAPPED | WS_CAPTION | WS_SYSMENU | WS_MINIMIZEBOX;
 
-  Context::Context(unsigned _width, unsigned _height) : width_(_width), height_(_height)
+  Context::Context(unsigned _width, unsigned _height)
   {
+    width_ = _width;
+    height_ = _height;
+
     HINSTANCE hinstance = GetModuleHandleW(nullptr);
 
     contexts_n_mutex.Lock();
@@ -106,10 +109,7 @@ namespace nogl
 
     ShowWindow(hwnd_, SW_SHOWNORMAL);
 
-    // Allocate aligned to __m256
-    zdata_ = std::unique_ptr<float[]>(
-      new (std::align_val_t(sizeof (__m256))) float[width_ * height_]
-    );
+    AllocateZ();
   }
 
   Context::~Context()
@@ -180,6 +180,8 @@ namespace nogl
 
         case WM_KEYDOWN:
         event_.type = Event::Type::kPress;
+        // The virtual-key code, the same as the uppercase ASCII for letters and digits.
+        event_.press.code = static_cast<int>(msg_.wParam);
         HandleEvent();
         break;
 
@@ -68,9 +68,7 @@ namespace nogl
       throw SystemException("Failed to convert to BGRA format.");
     }
 
-    data_ = std::unique_ptr<uint8_t[]>(
-      new (std::align_val_t(8)) unsigned char[width_ * height_ * bpp]
-    );
+    Allocate(bpp);
 
     hr = converter->CopyPixels(
       nullptr,